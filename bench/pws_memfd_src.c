@@ -0,0 +1,386 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Test source: a PipeWire video node that allocates its own MemFd buffers
+ * and fills them with synthetic H.264 access units (SPS/PPS + IDR, then P
+ * frames) or raw NV12/I420 pictures, stamping each with a CLOCK_MONOTONIC
+ * spa_meta_header PTS. Run it next to a pwstream consumer to exercise
+ * fd-backed buffer negotiation and export without a camera.
+ *
+ * frame_size is the IDR payload; P frames carry a quarter of it. Raw frames
+ * are always width * height * 3 / 2.
+ *
+ * usage: pws_memfd_src [fps] [frame_size] [gop] [h264|nv12|i420] [width] [height]
+ */
+
+/***** HEADER FILE *****/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE		/* memfd_create */
+#endif
+#include "pwstream.h"
+#include "pipewire/pipewire.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+/***** MACROS *****/
+#define SRC_DEF_FPS		25
+#define SRC_DEF_FRAME_SIZE	(64 * 1024)
+#define SRC_DEF_GOP		30
+#define SRC_BUFFER_SIZE		(512 * 1024)
+#define SRC_NUM_BUFFERS		8
+
+/***** Structure Declaration *****/
+
+struct src_data
+{
+    struct pw_main_loop *loop;
+    struct spa_source *timer;
+    struct pw_stream *stream;
+    struct spa_hook listener;
+    u32 fps;
+    u32 frame_size;
+    u32 gop;
+    u32 format;			// SPA_VIDEO_FORMAT_ENCODED for H.264
+    u32 width;
+    u32 height;
+    u32 buffer_size;
+    u64 seq;
+};
+
+/***** Global Variable Declaration *****/
+
+static struct src_data *src_running;
+
+/***** Function Definition *****/
+
+static u32 src_PutNal( u8 *out, const u8 *header, u32 header_len, u32 payload )
+{
+    out[0] = 0; out[1] = 0; out[2] = 0; out[3] = 1;
+    memcpy( out + 4, header, header_len );
+
+    /* No zero bytes, so the payload never forms a start code */
+    memset( out + 4 + header_len, 0xA5, payload );
+
+    return 4 + header_len + payload;
+}
+
+/* nal_ref_idc 1, as produced by the RPi encoder. The slice header bytes are
+ * first_mb_in_slice 0, slice_type 7 (I) or 5 (P), pic_parameter_set_id 0. */
+static u32 src_BuildFrame( struct src_data *data, u8 *out, u32 maxsize )
+{
+    static const u8 sps[] = { 0x27, 0x64, 0x00, 0x28, 0xAC, 0x2B, 0x40 };
+    static const u8 pps[] = { 0x28, 0xEE, 0x3C, 0xB0 };
+    static const u8 idr[] = { 0x25, 0x88, 0x80 };
+    static const u8 p[] = { 0x21, 0x9A };
+    u32 payload = data->frame_size;
+    u32 pos = 0;
+
+    if( payload + 64 > maxsize )
+        payload = maxsize - 64;
+
+    if( 0 == ( data->seq % data->gop ) )
+    {
+        pos += src_PutNal( out + pos, sps, sizeof(sps), 0 );
+        pos += src_PutNal( out + pos, pps, sizeof(pps), 0 );
+        pos += src_PutNal( out + pos, idr, sizeof(idr), payload );
+    }
+    else
+    {
+        pos += src_PutNal( out + pos, p, sizeof(p), payload / 4 );
+    }
+
+    return pos;
+}
+
+/* Luma and chroma change every frame so a consumer copy is never a no-op */
+static u32 src_BuildRawFrame( struct src_data *data, u8 *out, u32 maxsize )
+{
+    u32 luma = data->width * data->height;
+
+    if( luma + luma / 2 > maxsize )
+        return 0;
+
+    memset( out, (int)( data->seq & 0xFF ), luma );
+    memset( out + luma, 0x80, luma / 2 );
+
+    return luma + luma / 2;
+}
+
+static void src_OnProcess( void *userdata )
+{
+    struct src_data *data = (struct src_data *)userdata;
+    struct pw_buffer *b = NULL;
+    struct spa_data *d = NULL;
+    struct spa_meta_header *header = NULL;
+    struct timespec ts;
+
+    if( NULL == ( b = pw_stream_dequeue_buffer( data->stream ) ) )
+        return;
+
+    d = &b->buffer->datas[0];
+
+    if( NULL == d->data )
+    {
+        pw_stream_queue_buffer( data->stream, b );
+        return;
+    }
+
+    d->chunk->offset = 0;
+
+    if( SPA_VIDEO_FORMAT_ENCODED == data->format )
+    {
+        d->chunk->stride = 0;
+        d->chunk->size = src_BuildFrame( data, (u8*)d->data, d->maxsize );
+    }
+    else
+    {
+        d->chunk->stride = (int32_t)data->width;
+        d->chunk->size = src_BuildRawFrame( data, (u8*)d->data, d->maxsize );
+    }
+
+    header = (struct spa_meta_header *)spa_buffer_find_meta_data( b->buffer, SPA_META_Header, sizeof(*header) );
+
+    if( NULL != header )
+    {
+        clock_gettime( CLOCK_MONOTONIC, &ts );
+        header->pts = (int64_t)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+        header->flags = 0;
+        header->seq = data->seq;
+        header->dts_offset = 0;
+    }
+
+    data->seq++;
+
+    pw_stream_queue_buffer( data->stream, b );
+}
+
+static void src_OnTimeout( void *userdata, uint64_t expirations )
+{
+    struct src_data *data = (struct src_data *)userdata;
+
+    pw_stream_trigger_process( data->stream );
+}
+
+static void src_OnStateChanged( void *userdata, enum pw_stream_state old,
+                                enum pw_stream_state state, const char *error )
+{
+    struct src_data *data = (struct src_data *)userdata;
+    struct timespec value = { 0, 0 };
+    struct timespec interval = { 0, 0 };
+
+    printf( "{\"state\":\"%s\"}\n", pw_stream_state_as_string( state ) );
+
+    if( PW_STREAM_STATE_STREAMING == state )
+    {
+        value.tv_nsec = 1;
+        interval.tv_sec = 0;
+        interval.tv_nsec = 1000000000L / data->fps;
+    }
+
+    pw_loop_update_timer( pw_main_loop_get_loop( data->loop ), data->timer, &value, &interval, false );
+}
+
+static void src_OnParamChanged( void *userdata, uint32_t id, const struct spa_pod *param )
+{
+    struct src_data *data = (struct src_data *)userdata;
+    uint8_t buffer[1024];
+    struct spa_pod_builder b = SPA_POD_BUILDER_INIT( buffer, sizeof(buffer) );
+    const struct spa_pod *params[2];
+
+    if( ( NULL == param ) || ( SPA_PARAM_Format != id ) )
+        return;
+
+    params[0] = spa_pod_builder_add_object( &b,
+                SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+                SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int( SRC_NUM_BUFFERS, 2, 64 ),
+                SPA_PARAM_BUFFERS_blocks, SPA_POD_Int( 1 ),
+                SPA_PARAM_BUFFERS_size, SPA_POD_Int( data->buffer_size ),
+                SPA_PARAM_BUFFERS_stride, SPA_POD_Int( 0 ),
+                SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int( 1 << SPA_DATA_MemFd ) );
+
+    params[1] = spa_pod_builder_add_object( &b,
+                SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+                SPA_PARAM_META_type, SPA_POD_Id( SPA_META_Header ),
+                SPA_PARAM_META_size, SPA_POD_Int( sizeof(struct spa_meta_header) ) );
+
+    pw_stream_update_params( data->stream, params, 2 );
+}
+
+static void src_OnAddBuffer( void *userdata, struct pw_buffer *pwbuf )
+{
+    struct spa_data *d = &pwbuf->buffer->datas[0];
+    int fd = -1;
+
+    /* Before allocation type holds the mask of acceptable types */
+    if( 0 == ( d->type & ( 1 << SPA_DATA_MemFd ) ) )
+    {
+        fprintf( stderr, "consumer does not accept MemFd buffers\n" );
+        return;
+    }
+
+    fd = memfd_create( "pws-memfd-src", MFD_CLOEXEC | MFD_ALLOW_SEALING );
+
+    if( ( fd < 0 ) || ( ftruncate( fd, d->maxsize ) < 0 ) )
+    {
+        perror( "memfd" );
+        if( fd >= 0 )
+            close( fd );
+        return;
+    }
+
+    d->type = SPA_DATA_MemFd;
+    d->flags = SPA_DATA_FLAG_READWRITE;
+    d->fd = fd;
+    d->mapoffset = 0;
+    d->data = mmap( NULL, d->maxsize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+    if( MAP_FAILED == d->data )
+    {
+        perror( "mmap" );
+        d->data = NULL;
+    }
+}
+
+static void src_OnRemoveBuffer( void *userdata, struct pw_buffer *pwbuf )
+{
+    struct spa_data *d = &pwbuf->buffer->datas[0];
+
+    if( NULL != d->data )
+        munmap( d->data, d->maxsize );
+
+    if( d->fd >= 0 )
+        close( (int)d->fd );
+
+    d->data = NULL;
+    d->fd = -1;
+}
+
+static const struct pw_stream_events src_stream_events = {
+        PW_VERSION_STREAM_EVENTS,
+        .state_changed = src_OnStateChanged,
+        .param_changed = src_OnParamChanged,
+        .add_buffer = src_OnAddBuffer,
+        .remove_buffer = src_OnRemoveBuffer,
+        .process = src_OnProcess,
+};
+
+static void src_OnSignal( int sig )
+{
+    if( NULL != src_running )
+        pw_main_loop_quit( src_running->loop );
+}
+
+int main( int argc, char *argv[] )
+{
+    struct src_data data;
+    uint8_t buffer[1024];
+    struct spa_pod_builder b = SPA_POD_BUILDER_INIT( buffer, sizeof(buffer) );
+    const struct spa_pod *params[1];
+
+    memset( &data, 0, sizeof(data) );
+
+    data.fps = ( argc > 1 ) ? (u32)atoi( argv[1] ) : SRC_DEF_FPS;
+    data.frame_size = ( argc > 2 ) ? (u32)atoi( argv[2] ) : SRC_DEF_FRAME_SIZE;
+    data.gop = ( argc > 3 ) ? (u32)atoi( argv[3] ) : SRC_DEF_GOP;
+    data.format = SPA_VIDEO_FORMAT_ENCODED;
+    data.width = ( argc > 5 ) ? (u32)atoi( argv[5] ) : PWS_DEF_FRAME_WIDTH;
+    data.height = ( argc > 6 ) ? (u32)atoi( argv[6] ) : PWS_DEF_FRAME_HEIGHT;
+
+    if( ( argc > 4 ) && ( 0 == strcmp( argv[4], "nv12" ) ) )
+        data.format = SPA_VIDEO_FORMAT_NV12;
+    else if( ( argc > 4 ) && ( 0 == strcmp( argv[4], "i420" ) ) )
+        data.format = SPA_VIDEO_FORMAT_I420;
+
+    if( ( 0 == data.width ) || ( 0 == data.height ) )
+    {
+        data.width = PWS_DEF_FRAME_WIDTH;
+        data.height = PWS_DEF_FRAME_HEIGHT;
+    }
+
+    /* An IDR with its parameter sets, or one raw picture */
+    data.buffer_size = SRC_BUFFER_SIZE;
+
+    if( data.frame_size + 64 > data.buffer_size )
+        data.buffer_size = data.frame_size + 64;
+
+    if( ( SPA_VIDEO_FORMAT_ENCODED != data.format ) && ( data.width * data.height * 3 / 2 > data.buffer_size ) )
+        data.buffer_size = data.width * data.height * 3 / 2;
+
+    if( 0 == data.fps )
+        data.fps = SRC_DEF_FPS;
+
+    if( 0 == data.gop )
+        data.gop = SRC_DEF_GOP;
+
+    pw_init( &argc, &argv );
+
+    data.loop = pw_main_loop_new( NULL );
+
+    if( NULL == data.loop )
+        return 1;
+
+    src_running = &data;
+    signal( SIGINT, src_OnSignal );
+    signal( SIGTERM, src_OnSignal );
+
+    data.timer = pw_loop_add_timer( pw_main_loop_get_loop( data.loop ), src_OnTimeout, &data );
+
+    data.stream = pw_stream_new_simple( pw_main_loop_get_loop( data.loop ),
+                                        "pws-memfd-src",
+                                        pw_properties_new(
+                                            PW_KEY_MEDIA_CLASS, "Video/Source",
+                                            PW_KEY_MEDIA_TYPE, PWS_DEF_MEDIA_TYPE,
+                                            PW_KEY_MEDIA_CATEGORY, "Source",
+                                            PW_KEY_MEDIA_ROLE, PWS_DEF_MEDIA_ROLE,
+                                            NULL ),
+                                        &src_stream_events,
+                                        &data );
+
+    params[0] = spa_pod_builder_add_object( &b,
+                    SPA_TYPE_OBJECT_Format,   SPA_PARAM_EnumFormat,
+                    SPA_FORMAT_mediaType,     SPA_POD_Id( SPA_MEDIA_TYPE_video ),
+                    SPA_FORMAT_mediaSubtype,  SPA_POD_Id( ( SPA_VIDEO_FORMAT_ENCODED == data.format ) ?
+                                                          SPA_MEDIA_SUBTYPE_h264 : SPA_MEDIA_SUBTYPE_raw ),
+                    SPA_FORMAT_VIDEO_format,  SPA_POD_Id( data.format ),
+                    SPA_FORMAT_VIDEO_size,    SPA_POD_Rectangle( &SPA_RECTANGLE( data.width, data.height ) ),
+                    SPA_FORMAT_VIDEO_framerate, SPA_POD_Fraction( &SPA_FRACTION( data.fps, 1 ) ) );
+
+    if( ( NULL == data.stream ) ||
+        ( pw_stream_connect( data.stream, PW_DIRECTION_OUTPUT, PW_ID_ANY,
+                             PW_STREAM_FLAG_DRIVER | PW_STREAM_FLAG_ALLOC_BUFFERS,
+                             params, 1 ) < 0 ) )
+    {
+        fprintf( stderr, "failed to create the source stream\n" );
+        return 1;
+    }
+
+    pw_main_loop_run( data.loop );
+
+    pw_stream_destroy( data.stream );
+    pw_loop_destroy_source( pw_main_loop_get_loop( data.loop ), data.timer );
+    pw_main_loop_destroy( data.loop );
+    pw_deinit();
+
+    return 0;
+}
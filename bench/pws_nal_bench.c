@@ -0,0 +1,264 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Microbenchmark: pws_H264IndexFrame against the legacy Framedata[4] peek.
+ *
+ * Builds a synthetic GOP of Annex-B access units (SPS/PPS/SEI + IDR, then P
+ * frames, optionally with a leading AUD) and reports, per method, the cost per
+ * frame and how many frames were classified correctly.
+ *
+ * usage: pws_nal_bench [iterations] [idr_size] [p_size] [gop]
+ */
+
+/***** HEADER FILE *****/
+#include "pws_h264.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/***** MACROS *****/
+#define BENCH_DEF_ITERATIONS	2000
+#define BENCH_DEF_IDR_SIZE	(96 * 1024)
+#define BENCH_DEF_P_SIZE	(12 * 1024)
+#define BENCH_DEF_GOP		30
+
+/***** Structure Declaration *****/
+
+struct bench_frame
+{
+    u8 *data;
+    u32 size;
+    u32 pic_type;
+};
+
+struct bench_bitwriter
+{
+    u8 *data;
+    u32 pos;
+    u32 bit;
+};
+
+/***** Global Variable Declaration *****/
+
+static u32 bench_seed = 0x12345678;
+
+/***** Function Definition *****/
+
+static u32 bench_Rand( void )
+{
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 17;
+    bench_seed ^= bench_seed << 5;
+    return bench_seed;
+}
+
+static void bench_PutBit( struct bench_bitwriter *bw, u32 bit )
+{
+    if( 0 == bw->bit )
+        bw->data[bw->pos] = 0;
+
+    bw->data[bw->pos] |= (u8)( bit << ( 7 - bw->bit ) );
+
+    if( 8 == ++bw->bit )
+    {
+        bw->bit = 0;
+        bw->pos++;
+    }
+}
+
+static void bench_PutUe( struct bench_bitwriter *bw, u32 val )
+{
+    u32 code = val + 1;
+    int bits = 32 - __builtin_clz( code );
+    int i = 0;
+
+    for( i = 0; i < bits - 1; i++ )
+        bench_PutBit( bw, 0 );
+
+    for( i = bits - 1; i >= 0; i-- )
+        bench_PutBit( bw, ( code >> i ) & 1 );
+}
+
+/* Append a NAL with a 4-byte start code. Slices get a real slice header;
+ * the payload looks like entropy-coded data with occasional emulation
+ * prevention sequences so the scanner sees zero bytes. */
+static u32 bench_PutNal( u8 *out, u8 header, int slice_type, u32 payload )
+{
+    struct bench_bitwriter bw = { out + 5, 0, 0 };
+    u32 pos = 0;
+    u32 i = 0;
+
+    out[0] = 0; out[1] = 0; out[2] = 0; out[3] = 1;
+    out[4] = header;
+
+    if( slice_type >= 0 )
+    {
+        bench_PutUe( &bw, 0 );                  /* first_mb_in_slice */
+        bench_PutUe( &bw, (u32)slice_type );    /* slice_type */
+        bench_PutUe( &bw, 0 );                  /* pic_parameter_set_id */
+        bench_PutBit( &bw, 1 );
+
+        while( 0 != bw.bit )
+            bench_PutBit( &bw, 0 );
+    }
+
+    pos = 5 + bw.pos;
+
+    for( i = 0; i < payload; i++ )
+    {
+        if( 0 == ( bench_Rand() % 180 ) )
+        {
+            out[pos++] = 0; out[pos++] = 0; out[pos++] = 3;
+            i += 2;
+        }
+        else
+        {
+            out[pos++] = (u8)( 1 + bench_Rand() % 255 );
+        }
+    }
+
+    return pos;
+}
+
+static void bench_BuildFrame( struct bench_frame *frame, bool idr, bool aud, u32 size )
+{
+    u32 pos = 0;
+
+    frame->data = (u8*)malloc( size + 256 );
+
+    if( true == aud )
+        pos += bench_PutNal( frame->data + pos, 0x09, -1, 1 );
+
+    if( true == idr )
+    {
+        /* nal_ref_idc 1, as produced by the RPi encoder */
+        pos += bench_PutNal( frame->data + pos, 0x27, -1, 12 );
+        pos += bench_PutNal( frame->data + pos, 0x28, -1, 4 );
+        pos += bench_PutNal( frame->data + pos, 0x06, -1, 24 );
+        pos += bench_PutNal( frame->data + pos, 0x25, 7, size );
+        frame->pic_type = PWS_PIC_TYPE_IDR_FRAME;
+    }
+    else
+    {
+        pos += bench_PutNal( frame->data + pos, 0x21, 5, size );
+        frame->pic_type = PWS_PIC_TYPE_P_FRAME;
+    }
+
+    frame->size = pos;
+}
+
+/* The classification pwstream used before the NAL walker */
+static u32 bench_LegacyPictureType( const u8 *Framedata )
+{
+    if( ( 0X27 == Framedata[4] ) || ( 0X28 == Framedata[4] ) )
+        return PWS_PIC_TYPE_IDR_FRAME;
+    else if( 0X25 == Framedata[4] )
+        return PWS_PIC_TYPE_I_FRAME;
+    else if( 0X21 == Framedata[4] )
+        return PWS_PIC_TYPE_P_FRAME;
+
+    return PWS_PIC_TYPE_INVALID;
+}
+
+static double bench_Now( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void bench_Run( const char *set, struct bench_frame *frames, u32 nframes, u32 iterations )
+{
+    pws_nalIndex index;
+    volatile u32 sink = 0;
+    u64 bytes = 0;
+    u32 correct_legacy = 0;
+    u32 correct_nal = 0;
+    u32 i = 0;
+    u32 it = 0;
+    double start = 0;
+    double legacy_ns = 0;
+    double nal_ns = 0;
+
+    for( i = 0; i < nframes; i++ )
+    {
+        bytes += frames[i].size;
+        correct_legacy += ( bench_LegacyPictureType( frames[i].data ) == frames[i].pic_type );
+        correct_nal += ( pws_H264IndexFrame( frames[i].data, frames[i].size, &index ) == frames[i].pic_type );
+    }
+
+    start = bench_Now();
+    for( it = 0; it < iterations; it++ )
+        for( i = 0; i < nframes; i++ )
+            sink += bench_LegacyPictureType( frames[i].data );
+    legacy_ns = ( bench_Now() - start ) / ( (double)iterations * nframes );
+
+    start = bench_Now();
+    for( it = 0; it < iterations; it++ )
+        for( i = 0; i < nframes; i++ )
+            sink += pws_H264IndexFrame( frames[i].data, frames[i].size, &index );
+    nal_ns = ( bench_Now() - start ) / ( (double)iterations * nframes );
+
+    printf( "{\"set\":\"%s\",\"method\":\"legacy_peek\",\"ns_per_frame\":%.1f,\"correct\":%u,\"frames\":%u}\n",
+            set, legacy_ns, correct_legacy, nframes );
+    printf( "{\"set\":\"%s\",\"method\":\"nal_walk\",\"ns_per_frame\":%.1f,\"mb_per_s\":%.1f,\"correct\":%u,\"frames\":%u}\n",
+            set, nal_ns, ( (double)bytes / nframes ) / nal_ns * 1e3, correct_nal, nframes );
+}
+
+int main( int argc, char *argv[] )
+{
+    u32 iterations = ( argc > 1 ) ? (u32)atoi( argv[1] ) : BENCH_DEF_ITERATIONS;
+    u32 idr_size = ( argc > 2 ) ? (u32)atoi( argv[2] ) : BENCH_DEF_IDR_SIZE;
+    u32 p_size = ( argc > 3 ) ? (u32)atoi( argv[3] ) : BENCH_DEF_P_SIZE;
+    u32 gop = ( argc > 4 ) ? (u32)atoi( argv[4] ) : BENCH_DEF_GOP;
+    struct bench_frame *plain = NULL;
+    struct bench_frame *withaud = NULL;
+    u32 i = 0;
+
+    if( 0 == gop )
+        gop = BENCH_DEF_GOP;
+
+    plain = (struct bench_frame *)calloc( gop, sizeof(struct bench_frame) );
+    withaud = (struct bench_frame *)calloc( gop, sizeof(struct bench_frame) );
+
+    if( ( NULL == plain ) || ( NULL == withaud ) )
+        return 1;
+
+    for( i = 0; i < gop; i++ )
+    {
+        bench_BuildFrame( &plain[i], 0 == i, false, ( 0 == i ) ? idr_size : p_size );
+        bench_BuildFrame( &withaud[i], 0 == i, true, ( 0 == i ) ? idr_size : p_size );
+    }
+
+    bench_Run( "plain", plain, gop, iterations );
+    bench_Run( "aud_prefixed", withaud, gop, iterations );
+
+    for( i = 0; i < gop; i++ )
+    {
+        free( plain[i].data );
+        free( withaud[i].data );
+    }
+
+    free( plain );
+    free( withaud );
+
+    return 0;
+}
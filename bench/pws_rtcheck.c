@@ -0,0 +1,230 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* LD_PRELOAD checker for the real-time rules of the process callback. In a
+ * library configured with -DPWS_RT_DEBUG=ON, pws_OnProcess calls
+ * pws_RtCheckEnter/pws_RtCheckLeave; this library defines them and counts
+ * every allocating, locking or sleeping call made in between. trylock is
+ * allowed. Each call found is printed; PWS_RTCHECK_ABORT=1 aborts on the
+ * first one instead, so a test run fails at the offending stack. A JSON
+ * summary goes to stderr at exit:
+ *
+ *   LD_PRELOAD=./libpws_rtcheck.so ./pws_stream_bench -m latest -t 10
+ */
+
+/***** HEADER FILE *****/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE		/* RTLD_NEXT */
+#endif
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/***** MACROS *****/
+#define RT_FORWARD(name)	static __typeof__(name) *rt_next_##name
+
+/***** Global Variable Declaration *****/
+
+extern void *__libc_malloc( size_t size );
+extern void *__libc_calloc( size_t nmemb, size_t size );
+extern void *__libc_realloc( void *ptr, size_t size );
+extern void *__libc_memalign( size_t alignment, size_t size );
+extern void __libc_free( void *ptr );
+
+static __thread unsigned int rt_depth;
+static unsigned long long rt_sections;
+static unsigned long long rt_violations;
+static int rt_abort;
+
+RT_FORWARD(pthread_mutex_lock);
+RT_FORWARD(pthread_mutex_timedlock);
+RT_FORWARD(pthread_rwlock_rdlock);
+RT_FORWARD(pthread_rwlock_wrlock);
+RT_FORWARD(pthread_cond_wait);
+RT_FORWARD(pthread_cond_timedwait);
+RT_FORWARD(nanosleep);
+RT_FORWARD(clock_nanosleep);
+RT_FORWARD(usleep);
+
+/***** Function Definition *****/
+
+/* {{{ rt_Violation() */
+static void rt_Violation( const char *call )
+{
+    static const char prefix[] = "pws_rtcheck: ";
+    static const char suffix[] = " in the process callback\n";
+
+    __atomic_add_fetch( &rt_violations, 1, __ATOMIC_RELAXED );
+
+    /* write() only: anything else could allocate or lock */
+    write( STDERR_FILENO, prefix, sizeof(prefix) - 1 );
+    write( STDERR_FILENO, call, strlen( call ) );
+    write( STDERR_FILENO, suffix, sizeof(suffix) - 1 );
+
+    if( rt_abort )
+        abort();
+}
+/* }}} */
+
+#define RT_CHECK(call)		do { if( 0 != rt_depth ) rt_Violation( call ); } while( 0 )
+
+/* {{{ rt_Init() */
+__attribute__((constructor)) static void rt_Init( void )
+{
+    const char *value = getenv( "PWS_RTCHECK_ABORT" );
+
+    rt_abort = ( ( NULL != value ) && ( 0 != strcmp( value, "0" ) ) );
+
+    /* Resolved up front so a first call inside a section does not show up
+     * as dlsym's own allocations */
+    rt_next_pthread_mutex_lock = dlsym( RTLD_NEXT, "pthread_mutex_lock" );
+    rt_next_pthread_mutex_timedlock = dlsym( RTLD_NEXT, "pthread_mutex_timedlock" );
+    rt_next_pthread_rwlock_rdlock = dlsym( RTLD_NEXT, "pthread_rwlock_rdlock" );
+    rt_next_pthread_rwlock_wrlock = dlsym( RTLD_NEXT, "pthread_rwlock_wrlock" );
+    rt_next_pthread_cond_wait = dlsym( RTLD_NEXT, "pthread_cond_wait" );
+    rt_next_pthread_cond_timedwait = dlsym( RTLD_NEXT, "pthread_cond_timedwait" );
+    rt_next_nanosleep = dlsym( RTLD_NEXT, "nanosleep" );
+    rt_next_clock_nanosleep = dlsym( RTLD_NEXT, "clock_nanosleep" );
+    rt_next_usleep = dlsym( RTLD_NEXT, "usleep" );
+}
+/* }}} */
+
+/* {{{ rt_Report() */
+__attribute__((destructor)) static void rt_Report( void )
+{
+    fprintf( stderr, "{\"rtcheck_sections\":%llu,\"rtcheck_violations\":%llu}\n",
+             __atomic_load_n( &rt_sections, __ATOMIC_RELAXED ),
+             __atomic_load_n( &rt_violations, __ATOMIC_RELAXED ) );
+}
+/* }}} */
+
+/* {{{ pws_RtCheckEnter() */
+void pws_RtCheckEnter( void )
+{
+    if( 0 == rt_depth++ )
+        __atomic_add_fetch( &rt_sections, 1, __ATOMIC_RELAXED );
+}
+/* }}} */
+
+/* {{{ pws_RtCheckLeave() */
+void pws_RtCheckLeave( void )
+{
+    rt_depth--;
+}
+/* }}} */
+
+void *malloc( size_t size )
+{
+    RT_CHECK( "malloc" );
+    return __libc_malloc( size );
+}
+
+void *calloc( size_t nmemb, size_t size )
+{
+    RT_CHECK( "calloc" );
+    return __libc_calloc( nmemb, size );
+}
+
+void *realloc( void *ptr, size_t size )
+{
+    RT_CHECK( "realloc" );
+    return __libc_realloc( ptr, size );
+}
+
+void free( void *ptr )
+{
+    if( NULL != ptr )
+        RT_CHECK( "free" );
+    __libc_free( ptr );
+}
+
+int posix_memalign( void **memptr, size_t alignment, size_t size )
+{
+    void *ptr = NULL;
+
+    RT_CHECK( "posix_memalign" );
+
+    ptr = __libc_memalign( alignment, size );
+
+    if( NULL == ptr )
+        return ENOMEM;
+
+    *memptr = ptr;
+    return 0;
+}
+
+int pthread_mutex_lock( pthread_mutex_t *mutex )
+{
+    RT_CHECK( "pthread_mutex_lock" );
+    return rt_next_pthread_mutex_lock( mutex );
+}
+
+int pthread_mutex_timedlock( pthread_mutex_t *mutex, const struct timespec *abstime )
+{
+    RT_CHECK( "pthread_mutex_timedlock" );
+    return rt_next_pthread_mutex_timedlock( mutex, abstime );
+}
+
+int pthread_rwlock_rdlock( pthread_rwlock_t *rwlock )
+{
+    RT_CHECK( "pthread_rwlock_rdlock" );
+    return rt_next_pthread_rwlock_rdlock( rwlock );
+}
+
+int pthread_rwlock_wrlock( pthread_rwlock_t *rwlock )
+{
+    RT_CHECK( "pthread_rwlock_wrlock" );
+    return rt_next_pthread_rwlock_wrlock( rwlock );
+}
+
+int pthread_cond_wait( pthread_cond_t *cond, pthread_mutex_t *mutex )
+{
+    RT_CHECK( "pthread_cond_wait" );
+    return rt_next_pthread_cond_wait( cond, mutex );
+}
+
+int pthread_cond_timedwait( pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *abstime )
+{
+    RT_CHECK( "pthread_cond_timedwait" );
+    return rt_next_pthread_cond_timedwait( cond, mutex, abstime );
+}
+
+int nanosleep( const struct timespec *req, struct timespec *rem )
+{
+    RT_CHECK( "nanosleep" );
+    return rt_next_nanosleep( req, rem );
+}
+
+int clock_nanosleep( clockid_t clockid, int flags, const struct timespec *req, struct timespec *rem )
+{
+    RT_CHECK( "clock_nanosleep" );
+    return rt_next_clock_nanosleep( clockid, flags, req, rem );
+}
+
+int usleep( useconds_t usec )
+{
+    RT_CHECK( "usleep" );
+    return rt_next_usleep( usec );
+}
@@ -0,0 +1,188 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Shared-memory export on one box. "export" opens a pwstream consumer that
+ * exports its frames on a Unix socket and discards its own copies; "read"
+ * attaches through pws_shmreader and prints a line per second. With
+ * pws_memfd_src as the producer, start one exporter and any number of
+ * readers:
+ *
+ *   pws_memfd_src &
+ *   pws_shm_cat export /tmp/pws.sock &
+ *   pws_shm_cat read /tmp/pws.sock
+ */
+
+/***** HEADER FILE *****/
+#include "pwstream.h"
+#include "pws_shmreader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+
+/***** MACROS *****/
+#define CAT_POLL_MS		100
+#define CAT_REPORT_NS		1000000000ULL
+
+/***** Function Definition *****/
+
+static volatile sig_atomic_t cat_running = 1;
+
+/* {{{ cat_OnSignal() */
+static void cat_OnSignal( int sig )
+{
+    cat_running = 0;
+}
+/* }}} */
+
+/* {{{ cat_MonotonicNs() */
+static u64 cat_MonotonicNs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+/* }}} */
+
+/* {{{ cat_Export() */
+static int cat_Export( const char *path )
+{
+    struct pws_data pwsdata;
+    pws_frameInfo frame;
+
+    memset( &pwsdata, 0, sizeof(pwsdata) );
+    memset( &frame, 0, sizeof(frame) );
+
+    pwsdata.streamprop.shmsocket = path;
+
+    if( pws_StreamInit( &pwsdata ) < 0 )
+    {
+        fprintf( stderr, "failed to open the stream\n" );
+        return 1;
+    }
+
+    while( cat_running )
+    {
+        if( PWS_SUCCESS == pws_ReadFrameTimeout( &pwsdata, &frame, CAT_POLL_MS * 1000000ULL ) )
+            pws_FreeFrameBuffer( &pwsdata, &frame );
+    }
+
+    pws_StreamClose( &pwsdata, &frame );
+
+    return 0;
+}
+/* }}} */
+
+/* {{{ cat_Read() */
+static int cat_Read( const char *path )
+{
+    struct pws_shmreader *reader = NULL;
+    struct pollfd pfd;
+    pws_shmFrame frame;
+    uint8_t *buffer = NULL;
+    u64 frames = 0;
+    u64 bytes = 0;
+    u64 latency_ns = 0;
+    u64 report_ns = 0;
+    u64 now_ns = 0;
+    int ret = PWS_SHM_SUCCESS;
+
+    reader = pws_ShmReaderOpen( path, true );
+
+    if( NULL == reader )
+    {
+        fprintf( stderr, "failed to attach to %s\n", path );
+        return 1;
+    }
+
+    buffer = (uint8_t *)malloc( pws_ShmReaderMaxFrameSize( reader ) );
+
+    if( NULL == buffer )
+    {
+        pws_ShmReaderClose( reader );
+        return 1;
+    }
+
+    pfd.fd = pws_ShmReaderGetFd( reader );
+    pfd.events = POLLIN;
+    report_ns = cat_MonotonicNs() + CAT_REPORT_NS;
+
+    while( cat_running && ( PWS_SHM_CLOSED != ret ) )
+    {
+        ret = pws_ShmReaderRead( reader, &frame, buffer, pws_ShmReaderMaxFrameSize( reader ) );
+
+        if( PWS_SHM_SUCCESS == ret )
+        {
+            frames++;
+            bytes += frame.frame_size;
+            latency_ns += cat_MonotonicNs() - frame.receive_ts_ns;
+        }
+        else if( PWS_SHM_FRAME_NOT_READY == ret )
+        {
+            poll( &pfd, 1, CAT_POLL_MS );
+        }
+
+        now_ns = cat_MonotonicNs();
+
+        if( now_ns >= report_ns )
+        {
+            printf( "frames %llu bytes %llu avg latency %llu us dropped %llu\n",
+                    frames, bytes, ( 0 != frames ) ? latency_ns / frames / 1000 : 0,
+                    (u64)pws_ShmReaderDropped( reader ) );
+            fflush( stdout );
+
+            frames = 0;
+            bytes = 0;
+            latency_ns = 0;
+            report_ns = now_ns + CAT_REPORT_NS;
+        }
+    }
+
+    free( buffer );
+    pws_ShmReaderClose( reader );
+
+    return 0;
+}
+/* }}} */
+
+int main( int argc, char *argv[] )
+{
+    if( argc < 3 )
+    {
+        fprintf( stderr, "usage: %s export|read <socket>\n", argv[0] );
+        return 1;
+    }
+
+    signal( SIGINT, cat_OnSignal );
+    signal( SIGTERM, cat_OnSignal );
+
+    if( 0 == strcmp( argv[1], "export" ) )
+        return cat_Export( argv[2] );
+
+    if( 0 == strcmp( argv[1], "read" ) )
+        return cat_Read( argv[2] );
+
+    fprintf( stderr, "usage: %s export|read <socket>\n", argv[0] );
+
+    return 1;
+}
@@ -0,0 +1,479 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Stream benchmark: consumes a pwstream for a fixed time and prints one JSON
+ * line with delivered frames/s, end-to-end latency percentiles, bytes
+ * copied per frame and the drop rate. The consumer sleeps consumer_delay
+ * per frame to model a slow reader.
+ *
+ * Latency is measured from the producer's spa_meta_header PTS, which
+ * pws_memfd_src stamps from CLOCK_MONOTONIC, to the moment the frame is in
+ * the consumer's hands. Without a producer PTS it starts at pwstream's
+ * receive time instead; "latency_from" says which.
+ *
+ * With -o the stream is also recorded to that directory, and the line gains
+ * the recorder's write throughput, write latency and drops.
+ *
+ * "startup_ms" is the cold start: how long pws_StreamInit itself took, and
+ * when the stream connected, negotiated and got its first frame, counted
+ * from the start of pws_StreamInit. Restarting the PipeWire daemon during a
+ * run shows up in "reconnects" and "reconnect_gap_ms".
+ *
+ * Run it against pws_memfd_src, or use run_bench.sh for a full matrix on a
+ * private PipeWire instance.
+ *
+ * usage: pws_stream_bench [-f h264|nv12|i420] [-w width] [-h height] [-r fps]
+ *                         [-b bitrate] [-m copy|zerocopy|reader|latest] [-d consumer_delay_us]
+ *                         [-t seconds] [-q ringdepth] [-o record_dir] [-x annexb|fmp4]
+ */
+
+/***** HEADER FILE *****/
+#include "pwstream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+
+/***** MACROS *****/
+#define BENCH_DEF_SECONDS	10
+#define BENCH_START_TIMEOUT_MS	10000
+#define BENCH_POLL_MS		100
+#define BENCH_MIN_SAMPLES	1024
+
+/***** Structure Declaration *****/
+
+enum bench_mode
+{
+    BENCH_MODE_COPY ,
+    BENCH_MODE_ZEROCOPY ,
+    BENCH_MODE_READER ,
+    BENCH_MODE_LATEST ,
+};
+
+struct bench_config
+{
+    const char *format;
+    u32 width;
+    u32 height;
+    u32 fps;
+    u32 bitrate;
+    enum bench_mode mode;
+    u32 delay_us;
+    u32 seconds;
+    u32 ringdepth;
+    const char *recorddir;
+    PWS_RECORD_FORMAT recordformat;
+};
+
+struct bench_samples
+{
+    u64 *ns;
+    u32 count;
+    u32 capacity;
+    bool producer_ts;
+};
+
+/***** Global Variable Declaration *****/
+
+static volatile sig_atomic_t bench_running = 1;
+static const char *bench_modenames[] = { "copy", "zerocopy", "reader", "latest" };
+
+/***** Function Definition *****/
+
+static void bench_OnSignal( int sig )
+{
+    bench_running = 0;
+}
+
+static u64 bench_MonotonicNs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+
+static int bench_CompareU64( const void *a, const void *b )
+{
+    u64 x = *(const u64 *)a;
+    u64 y = *(const u64 *)b;
+
+    return ( x > y ) - ( x < y );
+}
+
+static void bench_Record( struct bench_samples *samples, const pws_frameInfoExt *ext )
+{
+    u64 now_ns = bench_MonotonicNs();
+    u64 start_ns = ext->receive_ts_ns;
+    u64 *grown = NULL;
+
+    if( 0 != ( ext->flags & PWS_FRAME_TS_FROM_PRODUCER ) )
+    {
+        start_ns = ext->capture_ts_ns;
+        samples->producer_ts = true;
+    }
+
+    if( samples->count == samples->capacity )
+    {
+        grown = (u64 *)realloc( samples->ns, 2 * samples->capacity * sizeof(u64) );
+
+        if( NULL == grown )
+            return;
+
+        samples->ns = grown;
+        samples->capacity *= 2;
+    }
+
+    samples->ns[samples->count++] = ( now_ns > start_ns ) ? now_ns - start_ns : 0;
+}
+
+static u64 bench_Percentile( const struct bench_samples *samples, u32 permille )
+{
+    if( 0 == samples->count )
+        return 0;
+
+    return samples->ns[(u64)( samples->count - 1 ) * permille / 1000];
+}
+
+/* Wait for the next frame and hand it over; the frame is released by
+ * bench_Release after the simulated work */
+static int bench_Take( struct pws_data *pwsdata, struct pws_reader *reader, enum bench_mode mode,
+                       s32 fd, pws_frameInfo *frame, u32 timeout_ms )
+{
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    int ret = PWS_FRAME_NOT_READY;
+
+    /* Latest-frame mode reads through the same call */
+    if( ( BENCH_MODE_COPY == mode ) || ( BENCH_MODE_LATEST == mode ) )
+        return pws_ReadFrameTimeout( pwsdata, frame, (u64)timeout_ms * 1000000ULL );
+
+    if( BENCH_MODE_ZEROCOPY == mode )
+        ret = pws_AcquireFrame( pwsdata, frame );
+    else
+        ret = pws_ReaderRead( reader, frame );
+
+    if( PWS_FRAME_NOT_READY != ret )
+        return ret;
+
+    poll( &pfd, 1, (int)timeout_ms );
+
+    if( BENCH_MODE_ZEROCOPY == mode )
+        return pws_AcquireFrame( pwsdata, frame );
+
+    return pws_ReaderRead( reader, frame );
+}
+
+static void bench_Release( struct pws_data *pwsdata, struct pws_reader *reader, enum bench_mode mode,
+                           pws_frameInfo *frame )
+{
+    if( ( BENCH_MODE_COPY == mode ) || ( BENCH_MODE_LATEST == mode ) )
+        pws_FreeFrameBuffer( pwsdata, frame );
+    else if( BENCH_MODE_ZEROCOPY == mode )
+        pws_ReleaseFrame( pwsdata, frame );
+    else
+        pws_ReaderRelease( reader, frame );
+}
+
+static void bench_Usage( const char *name )
+{
+    fprintf( stderr, "usage: %s [-f h264|nv12|i420] [-w width] [-h height] [-r fps] [-b bitrate]\n"
+                     "       [-m copy|zerocopy|reader|latest] [-d consumer_delay_us] [-t seconds] [-q ringdepth]\n"
+                     "       [-o record_dir] [-x annexb|fmp4]\n",
+             name );
+}
+
+static int bench_ParseArgs( int argc, char *argv[], struct bench_config *config )
+{
+    int opt = 0;
+
+    config->format = "h264";
+    config->width = PWS_DEF_FRAME_WIDTH;
+    config->height = PWS_DEF_FRAME_HEIGHT;
+    config->fps = PWS_DEF_FRAMERATE;
+    config->seconds = BENCH_DEF_SECONDS;
+    config->mode = BENCH_MODE_COPY;
+
+    while( -1 != ( opt = getopt( argc, argv, "f:w:h:r:b:m:d:t:q:o:x:" ) ) )
+    {
+        switch( opt )
+        {
+            case 'f': config->format = optarg; break;
+            case 'w': config->width = (u32)atoi( optarg ); break;
+            case 'h': config->height = (u32)atoi( optarg ); break;
+            case 'r': config->fps = (u32)atoi( optarg ); break;
+            case 'b': config->bitrate = (u32)atoi( optarg ); break;
+            case 'd': config->delay_us = (u32)atoi( optarg ); break;
+            case 't': config->seconds = (u32)atoi( optarg ); break;
+            case 'q': config->ringdepth = (u32)atoi( optarg ); break;
+            case 'o': config->recorddir = optarg; break;
+            case 'x':
+                if( 0 == strcmp( optarg, "fmp4" ) )
+                    config->recordformat = PWS_RECORD_FMP4;
+                else if( 0 != strcmp( optarg, "annexb" ) )
+                    return -1;
+                break;
+            case 'm':
+                if( 0 == strcmp( optarg, "zerocopy" ) )
+                    config->mode = BENCH_MODE_ZEROCOPY;
+                else if( 0 == strcmp( optarg, "reader" ) )
+                    config->mode = BENCH_MODE_READER;
+                else if( 0 == strcmp( optarg, "latest" ) )
+                    config->mode = BENCH_MODE_LATEST;
+                else if( 0 != strcmp( optarg, "copy" ) )
+                    return -1;
+                break;
+            default:
+                return -1;
+        }
+    }
+
+    if( ( 0 != strcmp( config->format, "h264" ) ) && ( 0 != strcmp( config->format, "nv12" ) ) &&
+        ( 0 != strcmp( config->format, "i420" ) ) )
+        return -1;
+
+    return 0;
+}
+
+static void bench_SetStreamProp( const struct bench_config *config, struct pws_prioperties *prop )
+{
+    prop->stream_name = "pws-stream-bench";
+    prop->width = config->width;
+    prop->height = config->height;
+    prop->framerate = config->fps;
+    prop->bitrate = config->bitrate;
+    prop->ringdepth = config->ringdepth;
+    prop->enMsubtypeformat = PWS_MEDIA_SUBTYPE_FORMAT_H264;
+    prop->envideoformat = PWS_VIDEO_FORMAT_ENCODED;
+
+    if( 0 != strcmp( config->format, "h264" ) )
+    {
+        prop->enMsubtypeformat = PWS_MEDIA_SUBTYPE_FORMAT_RAW;
+        prop->envideoformat = ( 0 == strcmp( config->format, "nv12" ) ) ? PWS_VIDEO_FORMAT_NV12 : PWS_VIDEO_FORMAT_I420;
+    }
+
+    if( BENCH_MODE_ZEROCOPY == config->mode )
+        prop->zerocopy = true;
+
+    if( BENCH_MODE_READER == config->mode )
+        prop->maxreaders = 1;
+
+    if( BENCH_MODE_LATEST == config->mode )
+        prop->latestframe = true;
+}
+
+static void bench_Report( const struct bench_config *config, struct bench_samples *samples,
+                          const pws_streamStats *stats, const pws_poolStats *poolstats,
+                          const pws_startupTimes *startup, u64 init_ns, u64 elapsed_ns )
+{
+    u64 lost = stats->frames_dropped + stats->frames_overwritten;
+
+    qsort( samples->ns, samples->count, sizeof(u64), bench_CompareU64 );
+
+    printf( "{\"format\":\"%s\",\"width\":%u,\"height\":%u,\"fps\":%u,\"bitrate\":%u,\"mode\":\"%s\","
+            "\"consumer_delay_us\":%u,\"ringdepth\":%u,\"duration_s\":%.3f,"
+            "\"frames_received\":%llu,\"frames_delivered\":%llu,\"frames_per_s\":%.2f,"
+            "\"latency_from\":\"%s\",\"latency_us\":{\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f},"
+            "\"bytes_copied_per_frame\":%.1f,\"drop_rate\":%.4f,\"frames_lost\":%llu,"
+            "\"dequeue_failures\":%llu,\"pool_peak_bytes\":%llu,\"pool_system_allocs\":%llu",
+            config->format, config->width, config->height, config->fps, config->bitrate,
+            bench_modenames[config->mode], config->delay_us, config->ringdepth, elapsed_ns / 1e9,
+            stats->frames_received, stats->frames_delivered, stats->frames_delivered * 1e9 / elapsed_ns,
+            ( true == samples->producer_ts ) ? "producer_pts" : "receive",
+            bench_Percentile( samples, 500 ) / 1e3, bench_Percentile( samples, 900 ) / 1e3,
+            bench_Percentile( samples, 990 ) / 1e3, bench_Percentile( samples, 999 ) / 1e3,
+            bench_Percentile( samples, 1000 ) / 1e3,
+            ( 0 != stats->frames_received ) ? (double)stats->bytes_copied / stats->frames_received : 0.0,
+            ( 0 != stats->frames_received ) ? (double)lost / stats->frames_received : 0.0,
+            lost, stats->dequeue_failures, poolstats->bytes_peak, poolstats->system_allocs );
+
+    if( NULL != config->recorddir )
+    {
+        printf( ",\"record\":{\"format\":\"%s\",\"frames\":%llu,\"mb_per_s\":%.3f,\"frames_dropped\":%llu,"
+                "\"segments\":%llu,\"write_errors\":%llu,\"writes\":%llu,"
+                "\"write_us\":{\"avg\":%.1f,\"max\":%.1f}}",
+                ( PWS_RECORD_FMP4 == config->recordformat ) ? "fmp4" : "annexb",
+                stats->record_frames, stats->record_bytes * 1e3 / elapsed_ns, stats->record_frames_dropped,
+                stats->record_segments, stats->record_write_errors, stats->record_write_ns.count,
+                ( 0 != stats->record_write_ns.count ) ?
+                    (double)stats->record_write_ns.sum_ns / stats->record_write_ns.count / 1e3 : 0.0,
+                stats->record_write_ns.max_ns / 1e3 );
+    }
+
+    printf( ",\"startup_ms\":{\"init\":%.3f,\"connected\":%.3f,\"negotiated\":%.3f,\"first_frame\":%.3f},"
+            "\"reconnects\":%llu,\"reconnect_gap_ms\":{\"avg\":%.3f,\"max\":%.3f}",
+            init_ns / 1e6, startup->connected_ns / 1e6, startup->negotiated_ns / 1e6,
+            startup->first_frame_ns / 1e6, stats->reconnects,
+            ( 0 != stats->reconnect_gap_ns.count ) ?
+                (double)stats->reconnect_gap_ns.sum_ns / stats->reconnect_gap_ns.count / 1e6 : 0.0,
+            stats->reconnect_gap_ns.max_ns / 1e6 );
+
+    printf( "}\n" );
+    fflush( stdout );
+}
+
+int main( int argc, char *argv[] )
+{
+    struct bench_config config;
+    struct bench_samples samples;
+    struct pws_data pwsdata;
+    struct pws_reader *reader = NULL;
+    pws_frameInfo frame;
+    pws_frameInfoExt ext;
+    pws_streamStats stats;
+    pws_poolStats poolstats;
+    pws_startupTimes startup;
+    u64 init_ns = 0;
+    u64 start_ns = 0;
+    u64 end_ns = 0;
+    s32 fd = -1;
+    int ret = PWS_SUCCESS;
+
+    memset( &config, 0, sizeof(config) );
+    memset( &samples, 0, sizeof(samples) );
+    memset( &pwsdata, 0, sizeof(pwsdata) );
+    memset( &frame, 0, sizeof(frame) );
+
+    if( 0 != bench_ParseArgs( argc, argv, &config ) )
+    {
+        bench_Usage( argv[0] );
+        return 1;
+    }
+
+    samples.capacity = config.fps * config.seconds;
+
+    if( samples.capacity < BENCH_MIN_SAMPLES )
+        samples.capacity = BENCH_MIN_SAMPLES;
+
+    samples.ns = (u64 *)malloc( samples.capacity * sizeof(u64) );
+
+    if( NULL == samples.ns )
+        return 1;
+
+    signal( SIGINT, bench_OnSignal );
+    signal( SIGTERM, bench_OnSignal );
+
+    bench_SetStreamProp( &config, &pwsdata.streamprop );
+
+    init_ns = bench_MonotonicNs();
+    fd = pws_StreamInit( &pwsdata );
+    init_ns = bench_MonotonicNs() - init_ns;
+
+    if( fd < 0 )
+    {
+        printf( "{\"error\":\"stream init failed\"}\n" );
+        return 1;
+    }
+
+    ret = pws_WaitReady( &pwsdata, BENCH_START_TIMEOUT_MS * 1000000ULL );
+
+    if( PWS_SUCCESS != ret )
+    {
+        printf( "{\"error\":\"stream not ready\",\"state\":%d}\n", (int)pws_GetStreamState( &pwsdata ) );
+        pws_StreamClose( &pwsdata, NULL );
+        return 1;
+    }
+
+    if( BENCH_MODE_READER == config.mode )
+    {
+        reader = pws_ReaderOpen( &pwsdata );
+
+        if( NULL == reader )
+        {
+            printf( "{\"error\":\"reader open failed\"}\n" );
+            pws_StreamClose( &pwsdata, NULL );
+            return 1;
+        }
+
+        fd = pws_ReaderGetFd( reader );
+    }
+
+    /* The clock starts at the first frame, once negotiation is over */
+    ret = bench_Take( &pwsdata, reader, config.mode, fd, &frame, BENCH_START_TIMEOUT_MS );
+
+    if( PWS_SUCCESS != ret )
+    {
+        printf( "{\"error\":\"no frames\",\"code\":%d}\n", ret );
+        pws_ReaderClose( reader );
+        pws_StreamClose( &pwsdata, NULL );
+        return 1;
+    }
+
+    bench_Release( &pwsdata, reader, config.mode, &frame );
+
+    if( NULL != config.recorddir )
+    {
+        pws_recordConfig record;
+
+        memset( &record, 0, sizeof(record) );
+        record.directory = config.recorddir;
+        record.enformat = config.recordformat;
+
+        ret = pws_RecordStart( &pwsdata, &record );
+
+        if( PWS_SUCCESS != ret )
+        {
+            printf( "{\"error\":\"record start failed\",\"code\":%d}\n", ret );
+            pws_ReaderClose( reader );
+            pws_StreamClose( &pwsdata, NULL );
+            return 1;
+        }
+    }
+
+    pws_ResetStats( &pwsdata );
+
+    start_ns = bench_MonotonicNs();
+    end_ns = start_ns + (u64)config.seconds * 1000000000ULL;
+
+    while( bench_running && ( bench_MonotonicNs() < end_ns ) )
+    {
+        if( PWS_SUCCESS != bench_Take( &pwsdata, reader, config.mode, fd, &frame, BENCH_POLL_MS ) )
+            continue;
+
+        memset( &ext, 0, sizeof(ext) );
+        ext.size = sizeof(ext);
+
+        if( PWS_SUCCESS == pws_GetFrameInfoExt( &pwsdata, &frame, &ext ) )
+            bench_Record( &samples, &ext );
+
+        if( 0 != config.delay_us )
+            usleep( config.delay_us );
+
+        bench_Release( &pwsdata, reader, config.mode, &frame );
+    }
+
+    /* Waits for the last writes, so the record counters are complete */
+    end_ns = bench_MonotonicNs();
+    pws_RecordStop( &pwsdata );
+
+    pws_GetStats( &pwsdata, &stats );
+    pws_GetPoolStats( &pwsdata, &poolstats );
+    pws_GetStartupTimes( &pwsdata, &startup );
+
+    bench_Report( &config, &samples, &stats, &poolstats, &startup, init_ns, end_ns - start_ns );
+
+    pws_ReaderClose( reader );
+    pws_StreamClose( &pwsdata, NULL );
+    free( samples.ns );
+
+    return 0;
+}
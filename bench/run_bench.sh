@@ -0,0 +1,133 @@
+#!/bin/sh
+##########################################################################
+# If not stated otherwise in this file or this component's LICENSE
+# file the following copyright and licenses apply:
+#
+# Copyright 2022 RDK Management
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+##########################################################################
+#
+# Runs pws_stream_bench against pws_memfd_src over a matrix of formats,
+# resolutions, bitrates, consumer modes and consumer speeds. Each run
+# prints one JSON line, so the output can be diffed or loaded for
+# regression tracking.
+#
+# Everything runs on a private PipeWire daemon and session manager in a
+# temporary runtime directory, so it needs no camera and does not touch
+# the user's PipeWire graph.
+#
+# usage: run_bench.sh [bench_dir] [seconds_per_run] > results.jsonl
+#
+# Override the matrix with the environment:
+#   PWS_BENCH_FORMATS="h264 nv12"  PWS_BENCH_SIZES="640x480 1280x720 1920x1080"
+#   PWS_BENCH_BITRATES="1000000 4000000"  PWS_BENCH_MODES="copy zerocopy reader latest"
+#   PWS_BENCH_DELAYS_US="0 20000 50000"  PWS_BENCH_FPS=30  PWS_BENCH_GOP=30
+
+BENCH_DIR=${1:-$(dirname "$0")}
+SECONDS_PER_RUN=${2:-10}
+
+FORMATS=${PWS_BENCH_FORMATS:-"h264 nv12"}
+SIZES=${PWS_BENCH_SIZES:-"640x480 1280x720 1920x1080"}
+BITRATES=${PWS_BENCH_BITRATES:-"1000000 4000000"}
+MODES=${PWS_BENCH_MODES:-"copy zerocopy reader latest"}
+DELAYS_US=${PWS_BENCH_DELAYS_US:-"0 20000 50000"}
+FPS=${PWS_BENCH_FPS:-30}
+GOP=${PWS_BENCH_GOP:-30}
+
+SESSION_MANAGER=""
+for sm in wireplumber pipewire-media-session; do
+    if command -v "$sm" >/dev/null 2>&1; then
+        SESSION_MANAGER=$sm
+        break
+    fi
+done
+
+if ! command -v pipewire >/dev/null 2>&1 || [ -z "$SESSION_MANAGER" ]; then
+    echo "run_bench.sh: needs pipewire and wireplumber or pipewire-media-session" >&2
+    exit 1
+fi
+
+RUNTIME_DIR=$(mktemp -d "${TMPDIR:-/tmp}/pws-bench.XXXXXX")
+export XDG_RUNTIME_DIR="$RUNTIME_DIR"
+export PIPEWIRE_RUNTIME_DIR="$RUNTIME_DIR"
+unset PIPEWIRE_REMOTE
+
+DAEMON_PID=""
+SM_PID=""
+SRC_PID=""
+
+cleanup()
+{
+    for pid in $SRC_PID $SM_PID $DAEMON_PID; do
+        kill "$pid" 2>/dev/null
+        wait "$pid" 2>/dev/null
+    done
+    rm -rf "$RUNTIME_DIR"
+}
+trap cleanup EXIT INT TERM
+
+pipewire >"$RUNTIME_DIR/pipewire.log" 2>&1 &
+DAEMON_PID=$!
+
+# The daemon is up once its socket exists
+i=0
+while [ ! -S "$RUNTIME_DIR/pipewire-0" ] && [ $i -lt 50 ]; do
+    sleep 0.1
+    i=$((i + 1))
+done
+
+if [ ! -S "$RUNTIME_DIR/pipewire-0" ]; then
+    echo "run_bench.sh: private pipewire did not start, see $RUNTIME_DIR/pipewire.log" >&2
+    exit 1
+fi
+
+"$SESSION_MANAGER" >"$RUNTIME_DIR/session.log" 2>&1 &
+SM_PID=$!
+sleep 1
+
+for format in $FORMATS; do
+    for size in $SIZES; do
+        width=${size%x*}
+        height=${size#*x}
+
+        # Raw frames have a fixed size, so only one bitrate applies
+        if [ "$format" = "h264" ]; then
+            bitrates=$BITRATES
+        else
+            bitrates=0
+        fi
+
+        for bitrate in $bitrates; do
+            # IDR payload such that one IDR and GOP-1 quarter-size P frames
+            # average out to the bitrate
+            frame_size=$((bitrate / 8 / FPS * GOP * 4 / (GOP + 3)))
+            [ "$frame_size" -gt 0 ] || frame_size=1
+
+            "$BENCH_DIR/pws_memfd_src" "$FPS" "$frame_size" "$GOP" "$format" "$width" "$height" \
+                >>"$RUNTIME_DIR/src.log" 2>&1 &
+            SRC_PID=$!
+
+            for mode in $MODES; do
+                for delay in $DELAYS_US; do
+                    "$BENCH_DIR/pws_stream_bench" -f "$format" -w "$width" -h "$height" -r "$FPS" \
+                        -b "$bitrate" -m "$mode" -d "$delay" -t "$SECONDS_PER_RUN"
+                done
+            done
+
+            kill "$SRC_PID" 2>/dev/null
+            wait "$SRC_PID" 2>/dev/null
+            SRC_PID=""
+        done
+    done
+done
@@ -0,0 +1,280 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***** HEADER FILE *****/
+#include "pws_dispatch.h"
+#include "pws_pool.h"
+#include "pws_stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/***** MACROS *****/
+/* Payload offset in a job block, keeps the payload 16-byte aligned */
+#define PWS_DISPATCH_JOB_HEADER		( ( sizeof(struct pws_dispatchjob) + 15 ) & ~(size_t)15 )
+
+/***** Function Definition *****/
+
+/** @description: CLOCK_MONOTONIC in nanoseconds, the clock of receive_ts_ns
+ *  @param[in]: None
+ *  @return: Nanoseconds
+ */
+/* {{{ pws_DispatchNow() */
+static u64 pws_DispatchNow( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+/* }}} */
+
+/** @description: Worker thread: take the oldest waiting frame, run the
+ *                callback on it and free it, until the dispatch stops
+ *  @param[in]: dispatch
+ *  @return: NULL
+ */
+/* {{{ pws_DispatchWorker() */
+static void *pws_DispatchWorker( void *arg )
+{
+    struct pws_dispatch *dispatch = (struct pws_dispatch *)arg;
+    struct pws_dispatchjob *job = NULL;
+
+    pthread_mutex_lock( &dispatch->lock );
+
+    for( ;; )
+    {
+        while( ( false == dispatch->stopping ) && ( dispatch->head == dispatch->tail ) )
+            pthread_cond_wait( &dispatch->cond, &dispatch->lock );
+
+        if( true == dispatch->stopping )
+            break;
+
+        job = dispatch->jobs[dispatch->tail % dispatch->depth];
+        dispatch->jobs[dispatch->tail % dispatch->depth] = NULL;
+        dispatch->tail++;
+
+        pthread_mutex_unlock( &dispatch->lock );
+
+        pws_StatsAdd( &dispatch->stats->frames_delivered, 1 );
+        pws_StatsRecord( &dispatch->stats->latency_ns, pws_DispatchNow() - job->ext.receive_ts_ns );
+
+        dispatch->callback( &job->info, &job->ext, dispatch->userdata );
+
+        pws_PoolFree( dispatch->pool, job );
+
+        pthread_mutex_lock( &dispatch->lock );
+    }
+
+    pthread_mutex_unlock( &dispatch->lock );
+
+    return NULL;
+}
+/* }}} */
+
+/** @description: Stop and join the workers started so far
+ *  @param[in]: dispatch
+ *  @return: None
+ */
+/* {{{ pws_DispatchStop() */
+static void pws_DispatchStop( struct pws_dispatch *dispatch )
+{
+    u32 i = 0;
+
+    pthread_mutex_lock( &dispatch->lock );
+    dispatch->stopping = true;
+    pthread_cond_broadcast( &dispatch->cond );
+    pthread_mutex_unlock( &dispatch->lock );
+
+    for( i = 0; i < dispatch->nworkers; i++ )
+        pthread_join( dispatch->workers[i], NULL );
+
+    dispatch->nworkers = 0;
+}
+/* }}} */
+
+/** @description: Set up a frame callback, starting its workers in worker mode
+ *  @param[in]: callback, userdata - as given to pws_SetFrameCallback
+ *              enmode - inline or worker dispatch
+ *              nworkers - worker threads, at most PWS_MAX_CALLBACK_WORKERS
+ *              depth - frames that may wait for a worker
+ *              stats - stream counters for deliveries and latency
+ *              pool - where job frames are allocated
+ *  @return: Dispatch handle or NULL
+ */
+/* {{{ pws_DispatchCreate() */
+struct pws_dispatch *pws_DispatchCreate( pws_frameCallback callback, void *userdata, PWS_CALLBACK_MODE enmode,
+                                         u32 nworkers, u32 depth, pws_streamStats *stats, struct pws_pool *pool )
+{
+    struct pws_dispatch *dispatch = NULL;
+    u32 i = 0;
+
+    if( ( NULL == callback ) || ( NULL == stats ) || ( NULL == pool ) )
+        return NULL;
+
+    if( ( PWS_CALLBACK_WORKERS == enmode ) &&
+        ( ( 0 == nworkers ) || ( nworkers > PWS_MAX_CALLBACK_WORKERS ) || ( 0 == depth ) ) )
+        return NULL;
+
+    dispatch = (struct pws_dispatch *)calloc( 1, sizeof(struct pws_dispatch) );
+
+    if( NULL == dispatch )
+        return NULL;
+
+    dispatch->callback = callback;
+    dispatch->userdata = userdata;
+    dispatch->enmode = enmode;
+    dispatch->stats = stats;
+    dispatch->pool = pool;
+
+    if( PWS_CALLBACK_WORKERS != enmode )
+        return dispatch;
+
+    dispatch->jobs = (struct pws_dispatchjob **)calloc( depth, sizeof(struct pws_dispatchjob *) );
+
+    if( NULL == dispatch->jobs )
+    {
+        free( dispatch );
+        return NULL;
+    }
+
+    if( pthread_mutex_init( &dispatch->lock, NULL ) != 0 )
+    {
+        free( dispatch->jobs );
+        free( dispatch );
+        return NULL;
+    }
+
+    if( pthread_cond_init( &dispatch->cond, NULL ) != 0 )
+    {
+        pthread_mutex_destroy( &dispatch->lock );
+        free( dispatch->jobs );
+        free( dispatch );
+        return NULL;
+    }
+
+    dispatch->depth = depth;
+
+    for( i = 0; i < nworkers; i++ )
+    {
+        if( pthread_create( &dispatch->workers[i], NULL, pws_DispatchWorker, dispatch ) != 0 )
+        {
+            pws_DispatchDestroy( dispatch );
+            return NULL;
+        }
+
+        dispatch->nworkers++;
+    }
+
+    return dispatch;
+}
+/* }}} */
+
+/** @description: Stop the workers once their current callbacks return and
+ *                discard the frames still waiting
+ *  @param[in]: dispatch
+ *  @return: None
+ */
+/* {{{ pws_DispatchDestroy() */
+void pws_DispatchDestroy( struct pws_dispatch *dispatch )
+{
+    if( NULL == dispatch )
+        return;
+
+    if( PWS_CALLBACK_WORKERS == dispatch->enmode )
+    {
+        pws_DispatchStop( dispatch );
+
+        for( ; dispatch->tail != dispatch->head; dispatch->tail++ )
+            pws_PoolFree( dispatch->pool, dispatch->jobs[dispatch->tail % dispatch->depth] );
+
+        pthread_cond_destroy( &dispatch->cond );
+        pthread_mutex_destroy( &dispatch->lock );
+        free( dispatch->jobs );
+    }
+
+    free( dispatch );
+}
+/* }}} */
+
+/** @description: Fill the pool with enough job blocks of a given frame size
+ *                to cover every frame that may wait for a worker
+ *  @param[in]: dispatch, frame size
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_DispatchPrealloc() */
+int pws_DispatchPrealloc( struct pws_dispatch *dispatch, u32 size )
+{
+    if( ( NULL == dispatch ) || ( PWS_CALLBACK_WORKERS != dispatch->enmode ) || ( 0 == size ) )
+        return PWS_SUCCESS;
+
+    return pws_PoolReserve( dispatch->pool, PWS_DISPATCH_JOB_HEADER + size, dispatch->depth + dispatch->nworkers );
+}
+/* }}} */
+
+/** @description: Allocate a job with room for size bytes of payload
+ *  @param[in]: dispatch, payload size
+ *  @return: Job with info.frame_ptr and info.frame_size set, or NULL
+ */
+/* {{{ pws_DispatchJobCreate() */
+struct pws_dispatchjob *pws_DispatchJobCreate( struct pws_dispatch *dispatch, u32 size )
+{
+    struct pws_dispatchjob *job = NULL;
+
+    job = (struct pws_dispatchjob *)pws_PoolAlloc( dispatch->pool, PWS_DISPATCH_JOB_HEADER + size );
+
+    if( NULL == job )
+        return NULL;
+
+    memset( job, 0, sizeof(struct pws_dispatchjob) );
+
+    job->info.frame_ptr = (u8 *)job + PWS_DISPATCH_JOB_HEADER;
+    job->info.frame_size = size;
+
+    return job;
+}
+/* }}} */
+
+/** @description: Hand a job to the workers, or free it if depth jobs are
+ *                already waiting
+ *  @param[in]: dispatch, job from pws_DispatchJobCreate
+ *  @return: Macro - Success, or Buffer Limit Reached when dropped
+ */
+/* {{{ pws_DispatchQueue() */
+int pws_DispatchQueue( struct pws_dispatch *dispatch, struct pws_dispatchjob *job )
+{
+    pthread_mutex_lock( &dispatch->lock );
+
+    if( dispatch->head - dispatch->tail >= dispatch->depth )
+    {
+        pthread_mutex_unlock( &dispatch->lock );
+        pws_PoolFree( dispatch->pool, job );
+        return PWS_BUFFER_LIMIT_REACHED;
+    }
+
+    dispatch->jobs[dispatch->head % dispatch->depth] = job;
+    dispatch->head++;
+
+    pthread_cond_signal( &dispatch->cond );
+    pthread_mutex_unlock( &dispatch->lock );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
@@ -0,0 +1,80 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PWS_DISPATCH_H
+#define PWS_DISPATCH_H
+
+/***** HEADER FILE *****/
+#include "pwstream.h"
+#include <pthread.h>
+
+/***** MACROS *****/
+#define PWS_MAX_CALLBACK_WORKERS	8
+
+/***** Structure Declaration *****/
+
+struct pws_pool;
+
+/* A frame waiting for a worker. It lives at the start of a pool block with
+ * the payload right after it; info.frame_ptr and the ext plane pointers
+ * point into the payload. */
+struct pws_dispatchjob
+{
+    pws_frameInfo info;
+    pws_frameInfoExt ext;
+};
+
+/* Frame callback registered with pws_SetFrameCallback.
+ *
+ * Inline mode has no state beyond the callback; the process callback calls
+ * it directly. Worker mode keeps a bounded FIFO of copied frames that a
+ * fixed set of threads drain. The process callback only takes the lock to
+ * append a frame and never waits for a worker: when depth frames are already
+ * waiting the new one is dropped. */
+struct pws_dispatch
+{
+    pws_frameCallback callback;
+    void *userdata;
+    PWS_CALLBACK_MODE enmode;
+
+    pws_streamStats *stats;
+    struct pws_pool *pool;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct pws_dispatchjob **jobs;
+    u32 depth;
+    u64 head;
+    u64 tail;
+    bool stopping;
+
+    pthread_t workers[PWS_MAX_CALLBACK_WORKERS];
+    u32 nworkers;
+};
+
+/***** Prototype *****/
+struct pws_dispatch *pws_DispatchCreate( pws_frameCallback callback, void *userdata, PWS_CALLBACK_MODE enmode,
+                                         u32 nworkers, u32 depth, pws_streamStats *stats, struct pws_pool *pool );
+void pws_DispatchDestroy( struct pws_dispatch *dispatch );
+
+int pws_DispatchPrealloc( struct pws_dispatch *dispatch, u32 size );
+struct pws_dispatchjob *pws_DispatchJobCreate( struct pws_dispatch *dispatch, u32 size );
+int pws_DispatchQueue( struct pws_dispatch *dispatch, struct pws_dispatchjob *job );
+
+#endif /* PWS_DISPATCH_H */
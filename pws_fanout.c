@@ -0,0 +1,457 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***** HEADER FILE *****/
+#include "pws_fanout.h"
+#include "pws_pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/***** MACROS *****/
+/* Payload offset in a shared frame block, keeps the payload 16-byte aligned */
+#define PWS_FANOUT_FRAME_HEADER		( ( sizeof(struct pws_sharedframe) + 15 ) & ~(size_t)15 )
+
+/***** Function Definition *****/
+
+/** @description: Drop one reference to a shared frame, returning it to the
+ *                pool with the last one. Called with the fanout lock held
+ *  @param[in]: frame
+ *  @return: Frame to free once unlocked, or NULL
+ */
+/* {{{ pws_FanoutUnref() */
+static struct pws_sharedframe *pws_FanoutUnref( struct pws_sharedframe *frame )
+{
+    if( ( NULL == frame ) || ( 0 != --frame->refcount ) )
+        return NULL;
+
+    return frame;
+}
+/* }}} */
+
+/** @description: Wake a reader waiting on its eventfd. Edge triggered: one
+ *                write until the reader finds the window empty again.
+ *                Called with the fanout lock held
+ *  @param[in]: reader
+ *  @return: None
+ */
+/* {{{ pws_FanoutSignal() */
+static void pws_FanoutSignal( struct pws_reader *reader )
+{
+    u64 count = 1;
+
+    if( true == reader->signaled )
+        return;
+
+    reader->signaled = true;
+    write( reader->notifyfd, &count, sizeof(count) );
+}
+/* }}} */
+
+/** @description: Create an empty fan-out window
+ *  @param[in]: depth - frames kept, the lag a reader may build up
+ *              maxreaders - readers that may be open at once
+ *              pool - where shared frames are allocated
+ *  @return: Fanout handle or NULL
+ */
+/* {{{ pws_FanoutCreate() */
+struct pws_fanout *pws_FanoutCreate( u32 depth, u32 maxreaders, struct pws_pool *pool )
+{
+    struct pws_fanout *fanout = NULL;
+
+    if( ( 0 == depth ) || ( 0 == maxreaders ) || ( NULL == pool ) )
+        return NULL;
+
+    fanout = (struct pws_fanout *)calloc( 1, sizeof(struct pws_fanout) );
+
+    if( NULL == fanout )
+        return NULL;
+
+    fanout->frames = (struct pws_sharedframe **)calloc( depth, sizeof(struct pws_sharedframe *) );
+
+    if( ( NULL == fanout->frames ) || ( pthread_mutex_init( &fanout->lock, NULL ) != 0 ) )
+    {
+        free( fanout->frames );
+        free( fanout );
+        return NULL;
+    }
+
+    fanout->depth = depth;
+    fanout->maxreaders = maxreaders;
+    fanout->pool = pool;
+
+    return fanout;
+}
+/* }}} */
+
+/** @description: Release the window, every reader still open and the frames
+ *                they hold. Frames handed out are invalid afterwards
+ *  @param[in]: fanout
+ *  @return: None
+ */
+/* {{{ pws_FanoutDestroy() */
+void pws_FanoutDestroy( struct pws_fanout *fanout )
+{
+    struct pws_reader *reader = NULL;
+    u32 i = 0;
+
+    if( NULL == fanout )
+        return;
+
+    while( NULL != fanout->readers )
+    {
+        reader = fanout->readers;
+        fanout->readers = reader->next;
+
+        for( i = 0; i < reader->heldcount; i++ )
+            pws_PoolFree( fanout->pool, pws_FanoutUnref( reader->held[i] ) );
+
+        if( -1 != reader->notifyfd )
+            close( reader->notifyfd );
+
+        free( reader );
+    }
+
+    for( i = 0; i < fanout->depth; i++ )
+        pws_PoolFree( fanout->pool, pws_FanoutUnref( fanout->frames[i] ) );
+
+    pthread_mutex_destroy( &fanout->lock );
+    free( fanout->frames );
+    free( fanout );
+}
+/* }}} */
+
+/** @description: Fill the pool with a window's worth of blocks for frames
+ *                of size payload bytes
+ *  @param[in]: fanout, size
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_FanoutPrealloc() */
+int pws_FanoutPrealloc( struct pws_fanout *fanout, u32 size )
+{
+    return pws_PoolReserve( fanout->pool, PWS_FANOUT_FRAME_HEADER + size, fanout->depth );
+}
+/* }}} */
+
+/** @description: Allocate a frame of size payload bytes for publishing. The
+ *                caller owns the only reference until pws_FanoutPublish
+ *  @param[in]: fanout, size
+ *  @return: Frame with info.frame_ptr set, or NULL
+ */
+/* {{{ pws_FanoutFrameCreate() */
+struct pws_sharedframe *pws_FanoutFrameCreate( struct pws_fanout *fanout, u32 size )
+{
+    struct pws_sharedframe *frame = NULL;
+
+    frame = (struct pws_sharedframe *)pws_PoolAlloc( fanout->pool, PWS_FANOUT_FRAME_HEADER + size );
+
+    if( NULL == frame )
+        return NULL;
+
+    /* Only the header is cleared; the payload is copied over */
+    memset( frame, 0, sizeof(struct pws_sharedframe) );
+    frame->refcount = 1;
+    frame->info.frame_ptr = (u8*)frame + PWS_FANOUT_FRAME_HEADER;
+    frame->info.frame_size = size;
+
+    return frame;
+}
+/* }}} */
+
+/** @description: Give back a frame from pws_FanoutFrameCreate that was not
+ *                published
+ *  @param[in]: fanout, frame
+ *  @return: None
+ */
+/* {{{ pws_FanoutFrameDrop() */
+void pws_FanoutFrameDrop( struct pws_fanout *fanout, struct pws_sharedframe *frame )
+{
+    pws_PoolFree( fanout->pool, frame );
+}
+/* }}} */
+
+/** @description: Append a frame to the window and wake the readers. The
+ *                window takes over the caller's reference. Readers left
+ *                behind the window skip ahead to its oldest frame
+ *  @param[in]: fanout, frame
+ *  @return: Frames lost by readers that fell behind, summed over readers
+ */
+/* {{{ pws_FanoutPublish() */
+u32 pws_FanoutPublish( struct pws_fanout *fanout, struct pws_sharedframe *frame )
+{
+    struct pws_sharedframe *evicted = NULL;
+    struct pws_reader *reader = NULL;
+    u64 oldest = 0;
+    u32 lost = 0;
+    u32 index = 0;
+
+    pthread_mutex_lock( &fanout->lock );
+
+    index = (u32)( fanout->head % fanout->depth );
+    evicted = pws_FanoutUnref( fanout->frames[index] );
+    fanout->frames[index] = frame;
+    fanout->head++;
+
+    if( fanout->head > fanout->depth )
+        oldest = fanout->head - fanout->depth;
+
+    for( reader = fanout->readers; NULL != reader; reader = reader->next )
+    {
+        /* Frames it still holds stay valid; only the cursor moves */
+        if( reader->cursor < oldest )
+        {
+            lost += (u32)( oldest - reader->cursor );
+            reader->dropped += oldest - reader->cursor;
+            reader->cursor = oldest;
+            reader->keyframepending = true;
+        }
+
+        pws_FanoutSignal( reader );
+    }
+
+    pthread_mutex_unlock( &fanout->lock );
+
+    pws_PoolFree( fanout->pool, evicted );
+
+    return lost;
+}
+/* }}} */
+
+/** @description: Open a reader. It starts at the newest sync point still in
+ *                the window when keyframestart is set, else at the next
+ *                frame published
+ *  @param[in]: fanout, keyframestart, frames the reader may hold at once
+ *  @return: Reader or NULL when maxreaders are open
+ */
+/* {{{ pws_FanoutAddReader() */
+struct pws_reader *pws_FanoutAddReader( struct pws_fanout *fanout, bool keyframestart, u32 maxheld )
+{
+    struct pws_reader *reader = NULL;
+    u64 seq = 0;
+
+    reader = (struct pws_reader *)calloc( 1, sizeof(struct pws_reader) );
+
+    if( NULL == reader )
+        return NULL;
+
+    reader->fanout = fanout;
+    reader->maxheld = ( ( 0 == maxheld ) || ( maxheld > PWS_MAX_HELD_BUFFERS ) ) ? PWS_MAX_HELD_BUFFERS : maxheld;
+    reader->notifyfd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+    if( -1 == reader->notifyfd )
+    {
+        free( reader );
+        return NULL;
+    }
+
+    pthread_mutex_lock( &fanout->lock );
+
+    if( fanout->nreaders >= fanout->maxreaders )
+    {
+        pthread_mutex_unlock( &fanout->lock );
+        close( reader->notifyfd );
+        free( reader );
+        return NULL;
+    }
+
+    reader->cursor = fanout->head;
+    reader->keyframepending = keyframestart;
+
+    /* Joining mid-GOP: rewind to the last IDR instead of waiting a GOP */
+    for( seq = fanout->head; ( true == keyframestart ) && ( seq > 0 ) && ( fanout->head - seq < fanout->depth ); seq-- )
+    {
+        if( true == fanout->frames[( seq - 1 ) % fanout->depth]->syncpoint )
+        {
+            reader->cursor = seq - 1;
+            reader->keyframepending = false;
+            pws_FanoutSignal( reader );
+            break;
+        }
+    }
+
+    reader->next = fanout->readers;
+    fanout->readers = reader;
+    fanout->nreaders++;
+
+    pthread_mutex_unlock( &fanout->lock );
+
+    return reader;
+}
+/* }}} */
+
+/** @description: Close a reader, releasing the frames it still holds
+ *  @param[in]: reader
+ *  @return: None
+ */
+/* {{{ pws_FanoutRemoveReader() */
+void pws_FanoutRemoveReader( struct pws_reader *reader )
+{
+    struct pws_fanout *fanout = reader->fanout;
+    struct pws_sharedframe *freed[PWS_MAX_HELD_BUFFERS];
+    struct pws_reader **link = NULL;
+    u32 nfreed = 0;
+    u32 i = 0;
+
+    pthread_mutex_lock( &fanout->lock );
+
+    for( link = &fanout->readers; NULL != *link; link = &(*link)->next )
+    {
+        if( *link == reader )
+        {
+            *link = reader->next;
+            fanout->nreaders--;
+            break;
+        }
+    }
+
+    for( i = 0; i < reader->heldcount; i++ )
+    {
+        freed[nfreed] = pws_FanoutUnref( reader->held[i] );
+
+        if( NULL != freed[nfreed] )
+            nfreed++;
+    }
+
+    pthread_mutex_unlock( &fanout->lock );
+
+    for( i = 0; i < nfreed; i++ )
+        pws_PoolFree( fanout->pool, freed[i] );
+
+    close( reader->notifyfd );
+    free( reader );
+}
+/* }}} */
+
+/** @description: Take the reader's next frame. While a keyframe is pending,
+ *                frames ahead of the next sync point are skipped. The frame
+ *                stays valid until pws_FanoutRelease
+ *  @param[in]: reader
+ *  @param[out]: pframe
+ *  @return: Macro - Success, PWS_FRAME_NOT_READY or PWS_BUFFER_LIMIT_REACHED
+ */
+/* {{{ pws_FanoutRead() */
+int pws_FanoutRead( struct pws_reader *reader, struct pws_sharedframe **pframe )
+{
+    struct pws_fanout *fanout = reader->fanout;
+    struct pws_sharedframe *frame = NULL;
+    u64 count = 0;
+
+    pthread_mutex_lock( &fanout->lock );
+
+    if( reader->heldcount >= reader->maxheld )
+    {
+        pthread_mutex_unlock( &fanout->lock );
+        return PWS_BUFFER_LIMIT_REACHED;
+    }
+
+    while( reader->cursor < fanout->head )
+    {
+        frame = fanout->frames[reader->cursor % fanout->depth];
+        reader->cursor++;
+
+        if( ( true == reader->keyframepending ) && ( false == frame->syncpoint ) )
+            continue;
+
+        reader->keyframepending = false;
+        frame->refcount++;
+        reader->held[reader->heldcount++] = frame;
+
+        pthread_mutex_unlock( &fanout->lock );
+
+        *pframe = frame;
+        return PWS_SUCCESS;
+    }
+
+    /* Caught up: re-arm, publish signals again under the same lock */
+    reader->signaled = false;
+    read( reader->notifyfd, &count, sizeof(count) );
+
+    pthread_mutex_unlock( &fanout->lock );
+
+    return PWS_FRAME_NOT_READY;
+}
+/* }}} */
+
+/** @description: Release a frame taken with pws_FanoutRead
+ *  @param[in]: reader, frame_ptr of the frame
+ *  @return: Macro - Success or PWS_INVALID_PARAM if the reader does not hold it
+ */
+/* {{{ pws_FanoutRelease() */
+int pws_FanoutRelease( struct pws_reader *reader, const u8 *frame_ptr )
+{
+    struct pws_fanout *fanout = reader->fanout;
+    struct pws_sharedframe *freed = NULL;
+    u32 i = 0;
+
+    pthread_mutex_lock( &fanout->lock );
+
+    for( i = 0; i < reader->heldcount; i++ )
+    {
+        if( reader->held[i]->info.frame_ptr == frame_ptr )
+            break;
+    }
+
+    if( i == reader->heldcount )
+    {
+        pthread_mutex_unlock( &fanout->lock );
+        return PWS_INVALID_PARAM;
+    }
+
+    freed = pws_FanoutUnref( reader->held[i] );
+    reader->held[i] = reader->held[--reader->heldcount];
+
+    pthread_mutex_unlock( &fanout->lock );
+
+    pws_PoolFree( fanout->pool, freed );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Find the metadata of a frame some reader holds
+ *  @param[in]: fanout, frame_ptr
+ *  @return: Metadata, valid while the frame is held, or NULL
+ */
+/* {{{ pws_FanoutFindMeta() */
+const struct pws_framemeta *pws_FanoutFindMeta( struct pws_fanout *fanout, const u8 *frame_ptr )
+{
+    const struct pws_framemeta *meta = NULL;
+    struct pws_reader *reader = NULL;
+    u32 i = 0;
+
+    pthread_mutex_lock( &fanout->lock );
+
+    for( reader = fanout->readers; ( NULL != reader ) && ( NULL == meta ); reader = reader->next )
+    {
+        for( i = 0; i < reader->heldcount; i++ )
+        {
+            if( reader->held[i]->info.frame_ptr == frame_ptr )
+            {
+                meta = &reader->held[i]->meta;
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock( &fanout->lock );
+
+    return meta;
+}
+/* }}} */
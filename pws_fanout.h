@@ -0,0 +1,101 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PWS_FANOUT_H
+#define PWS_FANOUT_H
+
+/***** HEADER FILE *****/
+#include "pwstream.h"
+#include "pws_ring.h"
+#include <pthread.h>
+
+/***** Structure Declaration *****/
+
+struct pws_pool;
+struct pws_fanout;
+
+/* A frame stored once for every reader. It lives at the start of a pool
+ * block with the payload right after it; info.frame_ptr points at the
+ * payload. The fanout holds one reference while the frame is in its window
+ * and each reader one per frame it has read and not yet released. */
+struct pws_sharedframe
+{
+    u32 refcount;
+    bool syncpoint;
+    pws_frameInfo info;
+    struct pws_framemeta meta;
+};
+
+/* One subscriber. cursor is the sequence number of the next frame to read. */
+struct pws_reader
+{
+    struct pws_fanout *fanout;
+    struct pws_data *pwsdata;
+    struct pws_reader *next;
+
+    u64 cursor;
+    bool keyframepending;
+    u64 dropped;
+
+    s32 notifyfd;
+    bool signaled;
+
+    struct pws_sharedframe *held[PWS_MAX_HELD_BUFFERS];
+    u32 heldcount;
+    u32 maxheld;
+};
+
+/* Broadcast window over the last depth frames.
+ *
+ * The process callback publishes each frame once; readers walk the window
+ * at their own pace. A reader that falls more than depth frames behind is
+ * moved to the oldest frame still in the window and, if keyframe gating is
+ * on, on to the next sync point, so a slow reader never holds back the
+ * others or ingest. Everything is under one mutex that is only held for
+ * pointer and refcount updates; payloads are read outside it. */
+struct pws_fanout
+{
+    pthread_mutex_t lock;
+    struct pws_pool *pool;
+
+    struct pws_sharedframe **frames;
+    u32 depth;
+    u64 head;
+
+    struct pws_reader *readers;
+    u32 nreaders;
+    u32 maxreaders;
+};
+
+/***** Prototype *****/
+struct pws_fanout *pws_FanoutCreate( u32 depth, u32 maxreaders, struct pws_pool *pool );
+void pws_FanoutDestroy( struct pws_fanout *fanout );
+
+int pws_FanoutPrealloc( struct pws_fanout *fanout, u32 size );
+struct pws_sharedframe *pws_FanoutFrameCreate( struct pws_fanout *fanout, u32 size );
+void pws_FanoutFrameDrop( struct pws_fanout *fanout, struct pws_sharedframe *frame );
+u32 pws_FanoutPublish( struct pws_fanout *fanout, struct pws_sharedframe *frame );
+
+struct pws_reader *pws_FanoutAddReader( struct pws_fanout *fanout, bool keyframestart, u32 maxheld );
+void pws_FanoutRemoveReader( struct pws_reader *reader );
+int pws_FanoutRead( struct pws_reader *reader, struct pws_sharedframe **pframe );
+int pws_FanoutRelease( struct pws_reader *reader, const u8 *frame_ptr );
+const struct pws_framemeta *pws_FanoutFindMeta( struct pws_fanout *fanout, const u8 *frame_ptr );
+
+#endif /* PWS_FANOUT_H */
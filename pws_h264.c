@@ -0,0 +1,484 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***** HEADER FILE *****/
+#include "pws_h264.h"
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+/***** MACROS *****/
+#define PWS_H264_START_CODE_LEN		3
+#define PWS_H264_LONG_START_CODE_LEN	4
+
+/***** Structure Declaration *****/
+
+/* RBSP bit reader that skips emulation prevention bytes (00 00 03) */
+struct pws_bitreader
+{
+    const u8 *data;
+    const u8 *end;
+    u32 bit;
+    u32 zeros;
+};
+
+/***** Function Definition *****/
+
+/** @description: Scalar start code search. Looks at every third byte and
+ *                only backs up when it can be part of a start code
+ *  @param[in]: data and end of buffer
+ *  @return: Pointer to the first 00 00 01, or end
+ */
+/* {{{ pws_H264ScanScalar() */
+static const u8 *pws_H264ScanScalar( const u8 *p, const u8 *end )
+{
+    while( end - p > 2 )
+    {
+        if( p[2] > 1 )
+            p += 3;
+        else if( 0 == p[2] )
+            p++;
+        else if( ( 0 == p[0] ) && ( 0 == p[1] ) )
+            return p;
+        else
+            p += 3;
+    }
+
+    return end;
+}
+/* }}} */
+
+/** @description: Find the next Annex-B start code (00 00 01). Blocks of 16
+ *                bytes without a zero byte cannot start a start code and
+ *                are skipped with a single compare
+ *  @param[in]: data and end of buffer
+ *  @return: Pointer to the first byte of the start code, or end
+ */
+/* {{{ pws_H264FindStartCode() */
+const u8 *pws_H264FindStartCode( const u8 *data, const u8 *end )
+{
+    const u8 *p = data;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+
+    while( end - p >= 18 )
+    {
+        __m128i a = _mm_loadu_si128( (const __m128i *)p );
+        __m128i za = _mm_cmpeq_epi8( a, zero );
+        int mask = 0;
+
+        if( 0 == _mm_movemask_epi8( za ) )
+        {
+            p += 16;
+            continue;
+        }
+
+        mask = _mm_movemask_epi8( _mm_and_si128( _mm_and_si128( za,
+                      _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i *)( p + 1 ) ), zero ) ),
+                      _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i *)( p + 2 ) ), one ) ) );
+
+        if( 0 != mask )
+            return p + __builtin_ctz( mask );
+
+        p += 16;
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t one = vdupq_n_u8(1);
+
+    while( end - p >= 18 )
+    {
+        uint8x16_t za = vceqq_u8( vld1q_u8( p ), zero );
+        uint64x2_t m64 = vreinterpretq_u64_u8( za );
+        uint64_t lo = 0;
+        uint64_t hi = 0;
+
+        if( 0 == ( vgetq_lane_u64( m64, 0 ) | vgetq_lane_u64( m64, 1 ) ) )
+        {
+            p += 16;
+            continue;
+        }
+
+        m64 = vreinterpretq_u64_u8( vandq_u8( vandq_u8( za,
+                      vceqq_u8( vld1q_u8( p + 1 ), zero ) ),
+                      vceqq_u8( vld1q_u8( p + 2 ), one ) ) );
+
+        lo = vgetq_lane_u64( m64, 0 );
+        hi = vgetq_lane_u64( m64, 1 );
+
+        if( 0 != lo )
+            return p + ( __builtin_ctzll( lo ) >> 3 );
+
+        if( 0 != hi )
+            return p + 8 + ( __builtin_ctzll( hi ) >> 3 );
+
+        p += 16;
+    }
+#endif
+
+    return pws_H264ScanScalar( p, end );
+}
+/* }}} */
+
+/** @description: Read one bit of RBSP data
+ *  @param[in]: bit reader
+ *  @return: Bit value, or -1 past the end of the NAL
+ */
+/* {{{ pws_BitRead() */
+static int pws_BitRead( struct pws_bitreader *br )
+{
+    int val = 0;
+
+    if( br->data >= br->end )
+        return -1;
+
+    /* 00 00 03 : the 03 is an emulation prevention byte, not payload */
+    if( ( 0 == br->bit ) && ( br->zeros >= 2 ) && ( 0x03 == *br->data ) )
+    {
+        br->data++;
+        br->zeros = 0;
+
+        if( br->data >= br->end )
+            return -1;
+    }
+
+    val = ( *br->data >> ( 7 - br->bit ) ) & 1;
+
+    if( 8 == ++br->bit )
+    {
+        br->zeros = ( 0 == *br->data ) ? br->zeros + 1 : 0;
+        br->bit = 0;
+        br->data++;
+    }
+
+    return val;
+}
+/* }}} */
+
+/** @description: Decode an unsigned exp-Golomb code, ue(v)
+ *  @param[in]: bit reader
+ *  @param[out]: pval - decoded value
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_BitReadUe() */
+static int pws_BitReadUe( struct pws_bitreader *br, u32 *pval )
+{
+    u32 leadingzeros = 0;
+    u32 suffix = 0;
+    u32 i = 0;
+    int bit = 0;
+
+    while( 0 == ( bit = pws_BitRead( br ) ) )
+    {
+        if( ++leadingzeros > 31 )
+            return PWS_FAILURE;
+    }
+
+    if( bit < 0 )
+        return PWS_FAILURE;
+
+    for( i = 0; i < leadingzeros; i++ )
+    {
+        if( ( bit = pws_BitRead( br ) ) < 0 )
+            return PWS_FAILURE;
+
+        suffix = ( suffix << 1 ) | (u32)bit;
+    }
+
+    *pval = ( ( 1u << leadingzeros ) - 1 ) + suffix;
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Decode slice_type from a coded slice NAL. The slice header
+ *                starts with first_mb_in_slice ue(v) then slice_type ue(v)
+ *  @param[in]: NAL unit (header byte included) and its length
+ *  @param[out]: pslicetype - slice_type modulo 5 (0 P, 1 B, 2 I, 3 SP, 4 SI)
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_H264SliceType() */
+static int pws_H264SliceType( const u8 *nal, u32 length, u32 *pslicetype )
+{
+    struct pws_bitreader br;
+    u32 first_mb = 0;
+    u32 slice_type = 0;
+
+    if( length < 2 )
+        return PWS_FAILURE;
+
+    br.data = nal + 1;
+    br.end = nal + length;
+    br.bit = 0;
+    br.zeros = 0;
+
+    if( ( PWS_SUCCESS != pws_BitReadUe( &br, &first_mb ) ) ||
+        ( PWS_SUCCESS != pws_BitReadUe( &br, &slice_type ) ) )
+        return PWS_FAILURE;
+
+    *pslicetype = slice_type % 5;
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Walk every NAL unit of an Annex-B access unit, record it in
+ *                the NAL index and classify the picture. Any IDR slice makes
+ *                the frame an IDR; otherwise it is an I frame only if every
+ *                slice is I/SI, and a P frame if any slice predicts
+ *  @param[in]: frame data and size
+ *  @param[out]: pstnalindex - NAL units found, may be NULL
+ *  @return: Enum - Picture Type
+ */
+/* {{{ pws_H264IndexFrame() */
+u32 pws_H264IndexFrame( const u8 *data, u32 size, pws_nalIndex *pstnalindex )
+{
+    const u8 *end = data + size;
+    const u8 *sc = NULL;
+    const u8 *nal = NULL;
+    const u8 *next = NULL;
+    const u8 *nalend = NULL;
+    bool idr = false;
+    bool slice = false;
+    bool inter = false;
+    u32 slicetype = 0;
+    u8 type = 0;
+
+    if( NULL != pstnalindex )
+        pstnalindex->count = 0;
+
+    if( ( NULL == data ) || ( 0 == size ) )
+        return PWS_PIC_TYPE_INVALID;
+
+    sc = pws_H264FindStartCode( data, end );
+
+    while( sc < end )
+    {
+        nal = sc + PWS_H264_START_CODE_LEN;
+        next = pws_H264FindStartCode( nal, end );
+
+        /* Zero bytes before the next start code are its leading zero_byte
+         * or trailing_zero_8bits, not part of this NAL */
+        nalend = next;
+
+        if( next < end )
+        {
+            while( ( nalend > nal ) && ( 0 == nalend[-1] ) )
+                nalend--;
+        }
+
+        if( nal < nalend )
+        {
+            type = nal[0] & 0x1F;
+
+            if( ( NULL != pstnalindex ) && ( pstnalindex->count < PWS_MAX_NAL_UNITS ) )
+            {
+                pstnalindex->nal[pstnalindex->count].offset = (u32)( nal - data );
+                pstnalindex->nal[pstnalindex->count].length = (u32)( nalend - nal );
+                pstnalindex->nal[pstnalindex->count].type = type;
+                pstnalindex->count++;
+            }
+
+            if( PWS_NAL_TYPE_IDR == type )
+            {
+                idr = true;
+            }
+            else if( PWS_NAL_TYPE_SLICE == type )
+            {
+                slice = true;
+
+                if( ( PWS_SUCCESS != pws_H264SliceType( nal, (u32)( nalend - nal ), &slicetype ) ) ||
+                    ( ( 2 != slicetype ) && ( 4 != slicetype ) ) )
+                    inter = true;
+            }
+        }
+
+        sc = next;
+    }
+
+    if( true == idr )
+        return PWS_PIC_TYPE_IDR_FRAME;
+
+    if( true == slice )
+        return ( true == inter ) ? PWS_PIC_TYPE_P_FRAME : PWS_PIC_TYPE_I_FRAME;
+
+    return PWS_PIC_TYPE_INVALID;
+}
+/* }}} */
+
+/** @description: Check whether an access unit is an IDR without indexing
+ *                it. Stops at the first slice NAL, so only the parameter
+ *                sets and SEI in front of it are walked
+ *  @param[in]: Annex-B data, size
+ *  @return: true for an IDR access unit
+ */
+/* {{{ pws_H264IsKeyframe() */
+bool pws_H264IsKeyframe( const u8 *data, u32 size )
+{
+    const u8 *end = data + size;
+    const u8 *sc = NULL;
+    u8 type = 0;
+
+    if( ( NULL == data ) || ( 0 == size ) )
+        return false;
+
+    sc = pws_H264FindStartCode( data, end );
+
+    while( ( end - sc ) > PWS_H264_START_CODE_LEN )
+    {
+        type = sc[PWS_H264_START_CODE_LEN] & 0x1F;
+
+        if( PWS_NAL_TYPE_IDR == type )
+            return true;
+
+        /* Types 1 to 4 are the non-IDR slices and their partitions */
+        if( ( type >= PWS_NAL_TYPE_SLICE ) && ( type < PWS_NAL_TYPE_IDR ) )
+            return false;
+
+        sc = pws_H264FindStartCode( sc + PWS_H264_START_CODE_LEN, end );
+    }
+
+    return false;
+}
+/* }}} */
+
+/** @description: Check whether an access unit carries a NAL type
+ *  @param[in]: NAL index and nal_unit_type
+ *  @return: true if present
+ */
+/* {{{ pws_H264HasNal() */
+bool pws_H264HasNal( const pws_nalIndex *pstnalindex, u8 type )
+{
+    u32 i = 0;
+
+    for( i = 0; i < pstnalindex->count; i++ )
+    {
+        if( type == pstnalindex->nal[i].type )
+            return true;
+    }
+
+    return false;
+}
+/* }}} */
+
+/** @description: Copy one parameter set NAL into the cache as Annex-B
+ *  @param[in]: destination, destination size, NAL and its length
+ *  @return: true if stored, false if the NAL does not fit
+ */
+/* {{{ pws_H264StoreParamSet() */
+static bool pws_H264StoreParamSet( u8 *dst, u32 *pdstsize, const u8 *nal, u32 length )
+{
+    static const u8 startcode[PWS_H264_LONG_START_CODE_LEN] = { 0x00, 0x00, 0x00, 0x01 };
+
+    if( length + PWS_H264_LONG_START_CODE_LEN > PWS_MAX_PARAM_SET_SIZE )
+        return false;
+
+    memcpy( dst, startcode, PWS_H264_LONG_START_CODE_LEN );
+    memcpy( dst + PWS_H264_LONG_START_CODE_LEN, nal, length );
+    *pdstsize = length + PWS_H264_LONG_START_CODE_LEN;
+
+    return true;
+}
+/* }}} */
+
+/** @description: Cache the SPS/PPS of an access unit. Only the process
+ *                callback calls this, and the sequence is only bumped when
+ *                the parameter sets actually change
+ *  @param[in]: cache, frame data and its NAL index
+ *  @return: None
+ */
+/* {{{ pws_H264UpdateParamCache() */
+void pws_H264UpdateParamCache( struct pws_paramcache *cache, const u8 *data, const pws_nalIndex *pstnalindex )
+{
+    const pws_nalUnit *nal = NULL;
+    u8 *dst = NULL;
+    u32 *pdstsize = NULL;
+    u32 dstsize = 0;
+    u32 i = 0;
+
+    for( i = 0; i < pstnalindex->count; i++ )
+    {
+        nal = &pstnalindex->nal[i];
+
+        if( PWS_NAL_TYPE_SPS == nal->type )
+        {
+            dst = cache->sets.sps;
+            pdstsize = &cache->sets.sps_size;
+        }
+        else if( PWS_NAL_TYPE_PPS == nal->type )
+        {
+            dst = cache->sets.pps;
+            pdstsize = &cache->sets.pps_size;
+        }
+        else
+        {
+            continue;
+        }
+
+        /* Unchanged sets are by far the common case; compare before
+         * opening a write section readers would have to retry on */
+        dstsize = *pdstsize;
+
+        if( ( dstsize == nal->length + PWS_H264_LONG_START_CODE_LEN ) &&
+            ( 0 == memcmp( dst + PWS_H264_LONG_START_CODE_LEN, data + nal->offset, nal->length ) ) )
+            continue;
+
+        __atomic_store_n( &cache->sequence, cache->sequence + 1, __ATOMIC_RELAXED );
+        __atomic_thread_fence( __ATOMIC_RELEASE );
+
+        if( true == pws_H264StoreParamSet( dst, pdstsize, data + nal->offset, nal->length ) )
+            cache->sets.generation++;
+
+        __atomic_store_n( &cache->sequence, cache->sequence + 1, __ATOMIC_RELEASE );
+    }
+}
+/* }}} */
+
+/** @description: Take a consistent snapshot of the cached parameter sets
+ *  @param[in]: cache
+ *  @param[out]: pstparamsets
+ *  @return: None
+ */
+/* {{{ pws_H264ReadParamCache() */
+void pws_H264ReadParamCache( struct pws_paramcache *cache, pws_paramSets *pstparamsets )
+{
+    u32 before = 0;
+    u32 after = 0;
+
+    do
+    {
+        before = __atomic_load_n( &cache->sequence, __ATOMIC_ACQUIRE );
+
+        if( before & 1 )
+            continue;
+
+        memcpy( pstparamsets, &cache->sets, sizeof(pws_paramSets) );
+
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+        after = __atomic_load_n( &cache->sequence, __ATOMIC_RELAXED );
+
+    } while( ( before & 1 ) || ( before != after ) );
+}
+/* }}} */
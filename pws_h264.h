@@ -0,0 +1,44 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PWS_H264_H
+#define PWS_H264_H
+
+/***** HEADER FILE *****/
+#include "pwstream.h"
+
+/***** Structure Declaration *****/
+
+/* Latest SPS/PPS seen on ingest. Written only by the process callback and
+ * read lock-free through a sequence count: odd while an update is running. */
+struct pws_paramcache
+{
+    u32 sequence;
+    pws_paramSets sets;
+};
+
+/***** Prototype *****/
+const u8 *pws_H264FindStartCode( const u8 *data, const u8 *end );
+u32 pws_H264IndexFrame( const u8 *data, u32 size, pws_nalIndex *pstnalindex );
+void pws_H264UpdateParamCache( struct pws_paramcache *cache, const u8 *data, const pws_nalIndex *pstnalindex );
+void pws_H264ReadParamCache( struct pws_paramcache *cache, pws_paramSets *pstparamsets );
+bool pws_H264HasNal( const pws_nalIndex *pstnalindex, u8 type );
+bool pws_H264IsKeyframe( const u8 *data, u32 size );
+
+#endif /* PWS_H264_H */
@@ -0,0 +1,253 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***** HEADER FILE *****/
+#include "pws_history.h"
+#include <stdlib.h>
+#include <string.h>
+
+/***** Function Definition *****/
+
+/** @description: Allocate a history store
+ *  @param[in]: arena size in bytes, maximum number of stored frames
+ *  @return: History handle or NULL
+ */
+/* {{{ pws_HistoryCreate() */
+struct pws_history *pws_HistoryCreate( u32 arenasize, u32 maxentries )
+{
+    struct pws_history *history = NULL;
+
+    if( ( 0 == arenasize ) || ( 0 == maxentries ) )
+        return NULL;
+
+    history = (struct pws_history *)calloc( 1, sizeof(struct pws_history) );
+
+    if( NULL == history )
+        return NULL;
+
+    history->arena = (u8*)malloc( arenasize );
+    history->entries = (struct pws_history_entry *)calloc( maxentries, sizeof(struct pws_history_entry) );
+    history->keyframes = (u64 *)calloc( maxentries, sizeof(u64) );
+
+    if( ( NULL == history->arena ) || ( NULL == history->entries ) || ( NULL == history->keyframes ) ||
+        ( 0 != pthread_mutex_init( &history->lock, NULL ) ) )
+    {
+        free( history->arena );
+        free( history->entries );
+        free( history->keyframes );
+        free( history );
+        return NULL;
+    }
+
+    history->arenasize = arenasize;
+    history->maxentries = maxentries;
+    history->gap = true;
+
+    return history;
+}
+/* }}} */
+
+/** @description: Release a history store
+ *  @param[in]: history
+ *  @return: None
+ */
+/* {{{ pws_HistoryDestroy() */
+void pws_HistoryDestroy( struct pws_history *history )
+{
+    if( NULL == history )
+        return;
+
+    pthread_mutex_destroy( &history->lock );
+    free( history->arena );
+    free( history->entries );
+    free( history->keyframes );
+    free( history );
+}
+/* }}} */
+
+/** @description: Drop the oldest stored frame
+ *  @param[in]: history
+ *  @return: None
+ */
+/* {{{ pws_HistoryEvict() */
+static void pws_HistoryEvict( struct pws_history *history )
+{
+    if( ( history->keyfirst != history->keylast ) &&
+        ( history->keyframes[history->keyfirst % history->maxentries] == history->first ) )
+    {
+        history->keyfirst++;
+    }
+
+    history->first++;
+
+    if( history->first == history->last )
+        history->writeoffset = 0;
+}
+/* }}} */
+
+/** @description: Find room for size bytes, evicting the oldest frames
+ *  @param[in]: history, size
+ *  @return: Arena offset for the new frame
+ */
+/* {{{ pws_HistoryMakeRoom() */
+static u32 pws_HistoryMakeRoom( struct pws_history *history, u32 size )
+{
+    u32 oldest = 0;
+    u32 write = 0;
+
+    if( history->last - history->first >= history->maxentries )
+        pws_HistoryEvict( history );
+
+    while( history->first != history->last )
+    {
+        oldest = history->entries[history->first % history->maxentries].offset;
+        write = history->writeoffset;
+
+        if( write > oldest )
+        {
+            /* Free space runs to the end of the arena, then up to oldest */
+            if( history->arenasize - write >= size )
+                return write;
+
+            if( oldest >= size )
+                return 0;
+        }
+        else if( ( write < oldest ) && ( oldest - write >= size ) )
+        {
+            return write;
+        }
+
+        pws_HistoryEvict( history );
+    }
+
+    return 0;
+}
+/* }}} */
+
+/** @description: Store a frame. Called from the process callback only
+ *  @param[in]: history, frame, its capture time,
+ *              keyframe - a reader may start at this frame
+ *  @return: None
+ */
+/* {{{ pws_HistoryAppend() */
+void pws_HistoryAppend( struct pws_history *history, const pws_frameInfo *pstframeinfo, u64 capture_ts_ns, bool keyframe )
+{
+    struct pws_history_entry *entry = NULL;
+    u32 offset = 0;
+
+    if( 0 != pthread_mutex_trylock( &history->lock ) )
+    {
+        history->gap = true;
+        return;
+    }
+
+    if( pstframeinfo->frame_size > history->arenasize )
+    {
+        /* Cannot be stored, and nothing after it decodes without it */
+        history->gap = true;
+    }
+    else if( ( false == history->gap ) || ( true == keyframe ) )
+    {
+        history->gap = false;
+
+        offset = pws_HistoryMakeRoom( history, pstframeinfo->frame_size );
+
+        memcpy( history->arena + offset, pstframeinfo->frame_ptr, pstframeinfo->frame_size );
+
+        entry = &history->entries[history->last % history->maxentries];
+        entry->info = *pstframeinfo;
+        entry->info.frame_ptr = history->arena + offset;
+        entry->capture_ts_ns = capture_ts_ns;
+        entry->offset = offset;
+
+        if( true == keyframe )
+            history->keyframes[history->keylast++ % history->maxentries] = history->last;
+
+        history->last++;
+        history->writeoffset = offset + pstframeinfo->frame_size;
+    }
+
+    pthread_mutex_unlock( &history->lock );
+}
+/* }}} */
+
+/** @description: Find the newest stored IDR captured at or before
+ *                capture_ts_ns, or the oldest stored IDR if every one is
+ *                newer
+ *  @param[in]: history, capture_ts_ns
+ *  @return: Entry sequence number of the IDR
+ */
+/* {{{ pws_HistoryFindKeyframe() */
+static u64 pws_HistoryFindKeyframe( struct pws_history *history, u64 capture_ts_ns )
+{
+    u64 lo = history->keyfirst;
+    u64 hi = history->keylast;
+    u64 mid = 0;
+    u64 seq = 0;
+
+    /* Binary search for the first IDR newer than capture_ts_ns */
+    while( lo < hi )
+    {
+        mid = lo + ( hi - lo ) / 2;
+        seq = history->keyframes[mid % history->maxentries];
+
+        if( history->entries[seq % history->maxentries].capture_ts_ns > capture_ts_ns )
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    if( lo > history->keyfirst )
+        lo--;
+
+    return history->keyframes[lo % history->maxentries];
+}
+/* }}} */
+
+/** @description: Walk the stored frames from the IDR at or before
+ *                capture_ts_ns up to the newest. frame_ptr is only valid
+ *                inside the callback, and the callback must not call back
+ *                into the stream
+ *  @param[in]: history, capture_ts_ns, callback, userdata
+ *  @return: Macro - Success/Frame Not Ready if no IDR is stored
+ */
+/* {{{ pws_HistoryIterate() */
+int pws_HistoryIterate( struct pws_history *history, u64 capture_ts_ns, pws_historyCallback callback, void *userdata )
+{
+    u64 seq = 0;
+
+    pthread_mutex_lock( &history->lock );
+
+    if( history->keyfirst == history->keylast )
+    {
+        pthread_mutex_unlock( &history->lock );
+        return PWS_FRAME_NOT_READY;
+    }
+
+    for( seq = pws_HistoryFindKeyframe( history, capture_ts_ns ); seq != history->last; seq++ )
+    {
+        if( 0 != callback( &history->entries[seq % history->maxentries].info, userdata ) )
+            break;
+    }
+
+    pthread_mutex_unlock( &history->lock );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
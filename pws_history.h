@@ -0,0 +1,75 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PWS_HISTORY_H
+#define PWS_HISTORY_H
+
+/***** HEADER FILE *****/
+#include "pwstream.h"
+#include <pthread.h>
+
+/***** Structure Declaration *****/
+
+/* One stored frame. info.frame_ptr points into the history arena. */
+struct pws_history_entry
+{
+    pws_frameInfo info;
+    u64 capture_ts_ns;			// lookup key; frame_timestamp is wall clock and may step
+    u32 offset;
+};
+
+/* Byte-budgeted pre-roll store.
+ *
+ * Frames are packed back to back into a fixed arena; a frame that does not
+ * fit before the end of the arena starts again at offset 0. The oldest frames
+ * are evicted until there is room, so memory use is fixed by the budget and
+ * the entry count whatever the bitrate. keyframes holds the sequence number
+ * of every stored IDR (any raw video or audio frame counts as one), oldest
+ * first, and is what a timestamp lookup searches.
+ *
+ * The process callback only ever trylocks: if a reader holds the lock the
+ * frame is not stored and the store skips ahead to the next IDR, so a reader
+ * never stalls ingest and never sees a P frame whose reference is missing. */
+struct pws_history
+{
+    pthread_mutex_t lock;
+
+    u8 *arena;
+    u32 arenasize;
+    u32 writeoffset;
+
+    struct pws_history_entry *entries;
+    u32 maxentries;
+    u64 first;
+    u64 last;
+
+    u64 *keyframes;
+    u64 keyfirst;
+    u64 keylast;
+
+    bool gap;
+};
+
+/***** Prototype *****/
+struct pws_history *pws_HistoryCreate( u32 arenasize, u32 maxentries );
+void pws_HistoryDestroy( struct pws_history *history );
+void pws_HistoryAppend( struct pws_history *history, const pws_frameInfo *pstframeinfo, u64 capture_ts_ns, bool keyframe );
+int pws_HistoryIterate( struct pws_history *history, u64 capture_ts_ns, pws_historyCallback callback, void *userdata );
+
+#endif /* PWS_HISTORY_H */
@@ -0,0 +1,429 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***** HEADER FILE *****/
+#include "pws_mp4.h"
+#include <string.h>
+
+/***** MACROS *****/
+#define PWS_MP4_TRACK_ID		1
+#define PWS_MP4_MOVIE_TIMESCALE		1000
+#define PWS_MP4_LANGUAGE_UND		0x55C4	// ISO-639-2 "und", packed
+#define PWS_MP4_TFHD_BASE_IS_MOOF	0x020000
+#define PWS_MP4_TRUN_FLAGS		0x000701	// data offset, per-sample duration, size and flags
+#define PWS_MP4_SAMPLE_SYNC		0x02000000	// depends on no other sample
+#define PWS_MP4_SAMPLE_NON_SYNC		0x01010000	// depends on others, not a sync sample
+
+/***** Structure Declaration *****/
+
+/* Output cursor. Writes past the end are counted but not stored, so a
+ * caller checks once at the end instead of after every field. */
+struct pws_mp4writer
+{
+    u8 *data;
+    u32 size;
+    u32 pos;
+};
+
+/***** Function Definition *****/
+
+/** @description: Append a byte
+ *  @param[in]: writer, value
+ *  @return: None
+ */
+/* {{{ pws_Mp4Put8() */
+static void pws_Mp4Put8( struct pws_mp4writer *w, u8 value )
+{
+    if( w->pos < w->size )
+        w->data[w->pos] = value;
+
+    w->pos++;
+}
+/* }}} */
+
+/** @description: Append a big-endian 16-bit field
+ *  @param[in]: writer, value
+ *  @return: None
+ */
+/* {{{ pws_Mp4Put16() */
+static void pws_Mp4Put16( struct pws_mp4writer *w, u16 value )
+{
+    pws_Mp4Put8( w, (u8)( value >> 8 ) );
+    pws_Mp4Put8( w, (u8)value );
+}
+/* }}} */
+
+/** @description: Append a big-endian 32-bit field
+ *  @param[in]: writer, value
+ *  @return: None
+ */
+/* {{{ pws_Mp4Put32() */
+static void pws_Mp4Put32( struct pws_mp4writer *w, u32 value )
+{
+    pws_Mp4Put16( w, (u16)( value >> 16 ) );
+    pws_Mp4Put16( w, (u16)value );
+}
+/* }}} */
+
+/** @description: Append a big-endian 64-bit field
+ *  @param[in]: writer, value
+ *  @return: None
+ */
+/* {{{ pws_Mp4Put64() */
+static void pws_Mp4Put64( struct pws_mp4writer *w, u64 value )
+{
+    pws_Mp4Put32( w, (u32)( value >> 32 ) );
+    pws_Mp4Put32( w, (u32)value );
+}
+/* }}} */
+
+/** @description: Append bytes, or zeros when bytes is NULL
+ *  @param[in]: writer, bytes, count
+ *  @return: None
+ */
+/* {{{ pws_Mp4PutBytes() */
+static void pws_Mp4PutBytes( struct pws_mp4writer *w, const u8 *bytes, u32 count )
+{
+    u32 i = 0;
+
+    for( i = 0; i < count; i++ )
+        pws_Mp4Put8( w, ( NULL != bytes ) ? bytes[i] : 0 );
+}
+/* }}} */
+
+/** @description: Open a box; its size is filled in by pws_Mp4BoxEnd
+ *  @param[in]: writer, four-character type
+ *  @return: Offset of the box
+ */
+/* {{{ pws_Mp4BoxStart() */
+static u32 pws_Mp4BoxStart( struct pws_mp4writer *w, const char *type )
+{
+    u32 start = w->pos;
+
+    pws_Mp4Put32( w, 0 );
+    pws_Mp4PutBytes( w, (const u8 *)type, 4 );
+
+    return start;
+}
+/* }}} */
+
+/** @description: Open a full box, one with a version and flags
+ *  @param[in]: writer, four-character type, version, flags
+ *  @return: Offset of the box
+ */
+/* {{{ pws_Mp4FullBoxStart() */
+static u32 pws_Mp4FullBoxStart( struct pws_mp4writer *w, const char *type, u8 version, u32 flags )
+{
+    u32 start = pws_Mp4BoxStart( w, type );
+
+    pws_Mp4Put32( w, ( (u32)version << 24 ) | ( flags & 0xFFFFFF ) );
+
+    return start;
+}
+/* }}} */
+
+/** @description: Overwrite a 32-bit field written earlier
+ *  @param[in]: writer, offset, value
+ *  @return: None
+ */
+/* {{{ pws_Mp4Patch32() */
+static void pws_Mp4Patch32( struct pws_mp4writer *w, u32 offset, u32 value )
+{
+    if( offset + 4 <= w->size )
+    {
+        w->data[offset] = (u8)( value >> 24 );
+        w->data[offset + 1] = (u8)( value >> 16 );
+        w->data[offset + 2] = (u8)( value >> 8 );
+        w->data[offset + 3] = (u8)value;
+    }
+}
+/* }}} */
+
+/** @description: Close a box by filling in its size
+ *  @param[in]: writer, offset from the box start call
+ *  @return: None
+ */
+/* {{{ pws_Mp4BoxEnd() */
+static void pws_Mp4BoxEnd( struct pws_mp4writer *w, u32 start )
+{
+    pws_Mp4Patch32( w, start, w->pos - start );
+}
+/* }}} */
+
+/** @description: Append the identity transformation matrix
+ *  @param[in]: writer
+ *  @return: None
+ */
+/* {{{ pws_Mp4PutMatrix() */
+static void pws_Mp4PutMatrix( struct pws_mp4writer *w )
+{
+    /* Identity, 16.16 except the last column, which is 2.30 */
+    pws_Mp4Put32( w, 0x00010000 );
+    pws_Mp4Put32( w, 0 );
+    pws_Mp4Put32( w, 0 );
+    pws_Mp4Put32( w, 0 );
+    pws_Mp4Put32( w, 0x00010000 );
+    pws_Mp4Put32( w, 0 );
+    pws_Mp4Put32( w, 0 );
+    pws_Mp4Put32( w, 0 );
+    pws_Mp4Put32( w, 0x40000000 );
+}
+/* }}} */
+
+/** @description: Write the avc1 sample entry with its decoder configuration
+ *  @param[in]: writer, SPS and PPS without start code, picture size
+ *  @return: None
+ */
+/* {{{ pws_Mp4PutAvc1() */
+static void pws_Mp4PutAvc1( struct pws_mp4writer *w, const u8 *sps, u32 spssize, const u8 *pps, u32 ppssize,
+                            u32 width, u32 height )
+{
+    u32 avc1 = pws_Mp4BoxStart( w, "avc1" );
+    u32 avcc = 0;
+
+    pws_Mp4PutBytes( w, NULL, 6 );
+    pws_Mp4Put16( w, 1 );			// data_reference_index
+    pws_Mp4PutBytes( w, NULL, 16 );
+    pws_Mp4Put16( w, (u16)width );
+    pws_Mp4Put16( w, (u16)height );
+    pws_Mp4Put32( w, 0x00480000 );		// 72 dpi
+    pws_Mp4Put32( w, 0x00480000 );
+    pws_Mp4Put32( w, 0 );
+    pws_Mp4Put16( w, 1 );			// frame_count
+    pws_Mp4PutBytes( w, NULL, 32 );		// compressorname
+    pws_Mp4Put16( w, 0x0018 );
+    pws_Mp4Put16( w, 0xFFFF );
+
+    avcc = pws_Mp4BoxStart( w, "avcC" );
+    pws_Mp4Put8( w, 1 );
+    pws_Mp4Put8( w, sps[1] );			// profile_idc
+    pws_Mp4Put8( w, sps[2] );			// constraint flags
+    pws_Mp4Put8( w, sps[3] );			// level_idc
+    pws_Mp4Put8( w, 0xFF );			// 4-byte NAL lengths
+    pws_Mp4Put8( w, 0xE1 );			// one SPS
+    pws_Mp4Put16( w, (u16)spssize );
+    pws_Mp4PutBytes( w, sps, spssize );
+    pws_Mp4Put8( w, 1 );			// one PPS
+    pws_Mp4Put16( w, (u16)ppssize );
+    pws_Mp4PutBytes( w, pps, ppssize );
+    pws_Mp4BoxEnd( w, avcc );
+
+    pws_Mp4BoxEnd( w, avc1 );
+}
+/* }}} */
+
+/** @description: Write an init segment for one H.264 track
+ *  @param[in]: buf, size - output
+ *              sps, spssize, pps, ppssize - parameter sets, no start code
+ *              width, height - picture size
+ *  @return: Bytes written, 0 if they do not fit or the SPS is too short
+ */
+/* {{{ pws_Mp4WriteInit() */
+u32 pws_Mp4WriteInit( u8 *buf, u32 size, const u8 *sps, u32 spssize, const u8 *pps, u32 ppssize,
+                      u32 width, u32 height )
+{
+    struct pws_mp4writer w = { buf, size, 0 };
+    u32 box[6];
+
+    if( ( NULL == sps ) || ( spssize < 4 ) || ( NULL == pps ) || ( 0 == ppssize ) )
+        return 0;
+
+    box[0] = pws_Mp4BoxStart( &w, "ftyp" );
+    pws_Mp4PutBytes( &w, (const u8 *)"isom", 4 );
+    pws_Mp4Put32( &w, 0x200 );
+    pws_Mp4PutBytes( &w, (const u8 *)"isomiso6avc1mp41", 16 );
+    pws_Mp4BoxEnd( &w, box[0] );
+
+    box[0] = pws_Mp4BoxStart( &w, "moov" );
+
+    box[1] = pws_Mp4FullBoxStart( &w, "mvhd", 0, 0 );
+    pws_Mp4Put32( &w, 0 );			// creation_time
+    pws_Mp4Put32( &w, 0 );			// modification_time
+    pws_Mp4Put32( &w, PWS_MP4_MOVIE_TIMESCALE );
+    pws_Mp4Put32( &w, 0 );			// duration, all in fragments
+    pws_Mp4Put32( &w, 0x00010000 );		// rate 1.0
+    pws_Mp4Put16( &w, 0x0100 );		// volume 1.0
+    pws_Mp4PutBytes( &w, NULL, 10 );
+    pws_Mp4PutMatrix( &w );
+    pws_Mp4PutBytes( &w, NULL, 24 );
+    pws_Mp4Put32( &w, PWS_MP4_TRACK_ID + 1 );	// next_track_ID
+    pws_Mp4BoxEnd( &w, box[1] );
+
+    box[1] = pws_Mp4BoxStart( &w, "trak" );
+
+    box[2] = pws_Mp4FullBoxStart( &w, "tkhd", 0, 0x3 );	// enabled, in movie
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4Put32( &w, PWS_MP4_TRACK_ID );
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4Put32( &w, 0 );			// duration
+    pws_Mp4PutBytes( &w, NULL, 8 );
+    pws_Mp4Put16( &w, 0 );			// layer
+    pws_Mp4Put16( &w, 0 );			// alternate_group
+    pws_Mp4Put16( &w, 0 );			// volume
+    pws_Mp4Put16( &w, 0 );
+    pws_Mp4PutMatrix( &w );
+    pws_Mp4Put32( &w, width << 16 );
+    pws_Mp4Put32( &w, height << 16 );
+    pws_Mp4BoxEnd( &w, box[2] );
+
+    box[2] = pws_Mp4BoxStart( &w, "mdia" );
+
+    box[3] = pws_Mp4FullBoxStart( &w, "mdhd", 0, 0 );
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4Put32( &w, PWS_MP4_TIMESCALE );
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4Put16( &w, PWS_MP4_LANGUAGE_UND );
+    pws_Mp4Put16( &w, 0 );
+    pws_Mp4BoxEnd( &w, box[3] );
+
+    box[3] = pws_Mp4FullBoxStart( &w, "hdlr", 0, 0 );
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4PutBytes( &w, (const u8 *)"vide", 4 );
+    pws_Mp4PutBytes( &w, NULL, 12 );
+    pws_Mp4PutBytes( &w, (const u8 *)"VideoHandler", 13 );
+    pws_Mp4BoxEnd( &w, box[3] );
+
+    box[3] = pws_Mp4BoxStart( &w, "minf" );
+
+    box[4] = pws_Mp4FullBoxStart( &w, "vmhd", 0, 1 );
+    pws_Mp4PutBytes( &w, NULL, 8 );
+    pws_Mp4BoxEnd( &w, box[4] );
+
+    box[4] = pws_Mp4BoxStart( &w, "dinf" );
+    box[5] = pws_Mp4FullBoxStart( &w, "dref", 0, 0 );
+    pws_Mp4Put32( &w, 1 );
+    pws_Mp4BoxEnd( &w, pws_Mp4FullBoxStart( &w, "url ", 0, 1 ) );	// media in this file
+    pws_Mp4BoxEnd( &w, box[5] );
+    pws_Mp4BoxEnd( &w, box[4] );
+
+    /* Samples are all described by the fragments */
+    box[4] = pws_Mp4BoxStart( &w, "stbl" );
+
+    box[5] = pws_Mp4FullBoxStart( &w, "stsd", 0, 0 );
+    pws_Mp4Put32( &w, 1 );
+    pws_Mp4PutAvc1( &w, sps, spssize, pps, ppssize, width, height );
+    pws_Mp4BoxEnd( &w, box[5] );
+
+    box[5] = pws_Mp4FullBoxStart( &w, "stts", 0, 0 );
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4BoxEnd( &w, box[5] );
+
+    box[5] = pws_Mp4FullBoxStart( &w, "stsc", 0, 0 );
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4BoxEnd( &w, box[5] );
+
+    box[5] = pws_Mp4FullBoxStart( &w, "stsz", 0, 0 );
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4BoxEnd( &w, box[5] );
+
+    box[5] = pws_Mp4FullBoxStart( &w, "stco", 0, 0 );
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4BoxEnd( &w, box[5] );
+
+    pws_Mp4BoxEnd( &w, box[4] );		// stbl
+    pws_Mp4BoxEnd( &w, box[3] );		// minf
+    pws_Mp4BoxEnd( &w, box[2] );		// mdia
+    pws_Mp4BoxEnd( &w, box[1] );		// trak
+
+    box[1] = pws_Mp4BoxStart( &w, "mvex" );
+    box[2] = pws_Mp4FullBoxStart( &w, "trex", 0, 0 );
+    pws_Mp4Put32( &w, PWS_MP4_TRACK_ID );
+    pws_Mp4Put32( &w, 1 );			// sample description
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4Put32( &w, 0 );
+    pws_Mp4BoxEnd( &w, box[2] );
+    pws_Mp4BoxEnd( &w, box[1] );
+
+    pws_Mp4BoxEnd( &w, box[0] );		// moov
+
+    return ( w.pos <= w.size ) ? w.pos : 0;
+}
+/* }}} */
+
+/** @description: Write a fragment header: moof describing the samples and
+ *                the mdat header. The sample data goes right after it
+ *  @param[in]: buf, size - output
+ *              sequence - fragment number, from 1
+ *              decodetime - decode time of the first sample
+ *              samples, nsamples - in decode order
+ *  @return: Bytes written, 0 if they do not fit
+ */
+/* {{{ pws_Mp4WriteFragment() */
+u32 pws_Mp4WriteFragment( u8 *buf, u32 size, u32 sequence, u64 decodetime,
+                          const struct pws_mp4sample *samples, u32 nsamples )
+{
+    struct pws_mp4writer w = { buf, size, 0 };
+    u64 mdatsize = PWS_MP4_MDAT_HEADER_SIZE;
+    u32 moof = 0;
+    u32 box[2];
+    u32 dataoffset = 0;
+    u32 i = 0;
+
+    if( 0 == nsamples )
+        return 0;
+
+    moof = pws_Mp4BoxStart( &w, "moof" );
+
+    box[0] = pws_Mp4FullBoxStart( &w, "mfhd", 0, 0 );
+    pws_Mp4Put32( &w, sequence );
+    pws_Mp4BoxEnd( &w, box[0] );
+
+    box[0] = pws_Mp4BoxStart( &w, "traf" );
+
+    box[1] = pws_Mp4FullBoxStart( &w, "tfhd", 0, PWS_MP4_TFHD_BASE_IS_MOOF );
+    pws_Mp4Put32( &w, PWS_MP4_TRACK_ID );
+    pws_Mp4BoxEnd( &w, box[1] );
+
+    box[1] = pws_Mp4FullBoxStart( &w, "tfdt", 1, 0 );
+    pws_Mp4Put64( &w, decodetime );
+    pws_Mp4BoxEnd( &w, box[1] );
+
+    box[1] = pws_Mp4FullBoxStart( &w, "trun", 0, PWS_MP4_TRUN_FLAGS );
+    pws_Mp4Put32( &w, nsamples );
+    dataoffset = w.pos;
+    pws_Mp4Put32( &w, 0 );
+
+    for( i = 0; i < nsamples; i++ )
+    {
+        pws_Mp4Put32( &w, samples[i].duration );
+        pws_Mp4Put32( &w, samples[i].size );
+        pws_Mp4Put32( &w, ( true == samples[i].syncpoint ) ? PWS_MP4_SAMPLE_SYNC : PWS_MP4_SAMPLE_NON_SYNC );
+        mdatsize += samples[i].size;
+    }
+
+    pws_Mp4BoxEnd( &w, box[1] );
+    pws_Mp4BoxEnd( &w, box[0] );
+    pws_Mp4BoxEnd( &w, moof );
+
+    /* Sample data starts right after the mdat header */
+    pws_Mp4Patch32( &w, dataoffset, w.pos - moof + PWS_MP4_MDAT_HEADER_SIZE );
+
+    if( mdatsize > 0xFFFFFFFFULL )
+        return 0;
+
+    pws_Mp4Put32( &w, (u32)mdatsize );
+    pws_Mp4PutBytes( &w, (const u8 *)"mdat", 4 );
+
+    return ( w.pos <= w.size ) ? w.pos : 0;
+}
+/* }}} */
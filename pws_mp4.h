@@ -0,0 +1,51 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PWS_MP4_H
+#define PWS_MP4_H
+
+/***** HEADER FILE *****/
+#include "pwstream.h"
+
+/***** MACROS *****/
+#define PWS_MP4_TIMESCALE		90000	// media timescale of the video track
+#define PWS_MP4_MDAT_HEADER_SIZE	8
+
+/***** Structure Declaration *****/
+
+/* One sample of a fragment. Sample data is written by the caller after the
+ * fragment header, AVCC framed: each NAL unit behind a 4-byte length. */
+struct pws_mp4sample
+{
+    u32 duration;			// PWS_MP4_TIMESCALE units
+    u32 size;				// bytes in mdat, length prefixes included
+    bool syncpoint;
+};
+
+/***** Prototype *****/
+
+/* Writers for a fragmented MP4 with a single H.264 track: an init segment
+ * (ftyp and moov with an empty sample table) followed by any number of
+ * moof/mdat fragments. Both return the bytes written, 0 if they did not fit. */
+u32 pws_Mp4WriteInit( u8 *buf, u32 size, const u8 *sps, u32 spssize, const u8 *pps, u32 ppssize,
+                      u32 width, u32 height );
+u32 pws_Mp4WriteFragment( u8 *buf, u32 size, u32 sequence, u64 decodetime,
+                          const struct pws_mp4sample *samples, u32 nsamples );
+
+#endif /* PWS_MP4_H */
@@ -0,0 +1,307 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***** HEADER FILE *****/
+#include "pws_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+/***** MACROS *****/
+#define PWS_POOL_OVERSIZE	PWS_POOL_CLASSES	// class of an exact, uncached block
+#define PWS_POOL_HEADER_SIZE	32			// keeps the payload 16-byte aligned
+
+/***** Structure Declaration *****/
+
+/* Header in front of every payload */
+struct pws_poolblock
+{
+    struct pws_poolblock *next;
+    u32 sizeclass;
+    u32 capacity;
+};
+
+/***** Function Definition *****/
+
+/** @description: Find the class holding size bytes
+ *  @param[in]: size
+ *  @return: Class index, PWS_POOL_OVERSIZE when above the largest class
+ */
+/* {{{ pws_PoolClass() */
+static u32 pws_PoolClass( u32 size )
+{
+    u32 shift = 0;
+
+    if( size <= ( 1U << PWS_POOL_MIN_SHIFT ) )
+        return 0;
+
+    shift = 32 - __builtin_clz( size - 1 );
+
+    if( shift > PWS_POOL_MAX_SHIFT )
+        return PWS_POOL_OVERSIZE;
+
+    return shift - PWS_POOL_MIN_SHIFT;
+}
+/* }}} */
+
+/** @description: Get the header of a payload
+ *  @param[in]: payload
+ *  @return: Block header
+ */
+/* {{{ pws_PoolBlock() */
+static struct pws_poolblock *pws_PoolBlock( const void *ptr )
+{
+    return (struct pws_poolblock *)( (u8*)ptr - PWS_POOL_HEADER_SIZE );
+}
+/* }}} */
+
+/** @description: Allocate a new block from the system. Called with the
+ *                pool lock held
+ *  @param[in]: pool, class, size for an oversize block
+ *  @return: Block or NULL
+ */
+/* {{{ pws_PoolNewBlock() */
+static struct pws_poolblock *pws_PoolNewBlock( struct pws_pool *pool, u32 sizeclass, u32 size )
+{
+    struct pws_poolblock *block = NULL;
+    u32 capacity = size;
+
+    if( PWS_POOL_OVERSIZE != sizeclass )
+        capacity = 1U << ( sizeclass + PWS_POOL_MIN_SHIFT );
+
+    /* No memset: every user overwrites the payload before reading it */
+    block = (struct pws_poolblock *)malloc( PWS_POOL_HEADER_SIZE + (size_t)capacity );
+
+    if( NULL == block )
+        return NULL;
+
+    block->next = NULL;
+    block->sizeclass = sizeclass;
+    block->capacity = capacity;
+
+    pool->stats.system_allocs++;
+
+    return block;
+}
+/* }}} */
+
+/** @description: Create an empty pool
+ *  @param[in]: free blocks kept per class
+ *  @return: Pool handle or NULL
+ */
+/* {{{ pws_PoolCreate() */
+struct pws_pool *pws_PoolCreate( u32 maxfree )
+{
+    struct pws_pool *pool = NULL;
+
+    pool = (struct pws_pool *)calloc( 1, sizeof(struct pws_pool) );
+
+    if( NULL == pool )
+        return NULL;
+
+    if( pthread_mutex_init( &pool->lock, NULL ) != 0 )
+    {
+        free( pool );
+        return NULL;
+    }
+
+    pool->maxfree = maxfree;
+
+    return pool;
+}
+/* }}} */
+
+/** @description: Release the pool and every cached block. Blocks still in
+ *                use must have been freed first
+ *  @param[in]: pool
+ *  @return: None
+ */
+/* {{{ pws_PoolDestroy() */
+void pws_PoolDestroy( struct pws_pool *pool )
+{
+    struct pws_poolblock *block = NULL;
+    u32 i = 0;
+
+    if( NULL == pool )
+        return;
+
+    for( i = 0; i < PWS_POOL_CLASSES; i++ )
+    {
+        while( NULL != pool->freelist[i] )
+        {
+            block = pool->freelist[i];
+            pool->freelist[i] = block->next;
+            free( block );
+        }
+    }
+
+    pthread_mutex_destroy( &pool->lock );
+    free( pool );
+}
+/* }}} */
+
+/** @description: Get a buffer of at least size bytes. The contents are
+ *                undefined
+ *  @param[in]: pool, size
+ *  @return: Buffer or NULL
+ */
+/* {{{ pws_PoolAlloc() */
+void *pws_PoolAlloc( struct pws_pool *pool, u32 size )
+{
+    struct pws_poolblock *block = NULL;
+    u32 sizeclass = pws_PoolClass( size );
+
+    if( NULL == pool )
+        return NULL;
+
+    pthread_mutex_lock( &pool->lock );
+
+    if( ( PWS_POOL_OVERSIZE != sizeclass ) && ( NULL != pool->freelist[sizeclass] ) )
+    {
+        block = pool->freelist[sizeclass];
+        pool->freelist[sizeclass] = block->next;
+        pool->freecount[sizeclass]--;
+        pool->stats.bytes_cached -= block->capacity;
+        pool->stats.reuses++;
+    }
+    else
+    {
+        block = pws_PoolNewBlock( pool, sizeclass, size );
+    }
+
+    if( NULL != block )
+    {
+        pool->stats.bytes_in_use += block->capacity;
+
+        if( pool->stats.bytes_in_use > pool->stats.bytes_peak )
+            pool->stats.bytes_peak = pool->stats.bytes_in_use;
+    }
+
+    pthread_mutex_unlock( &pool->lock );
+
+    if( NULL == block )
+        return NULL;
+
+    return (u8*)block + PWS_POOL_HEADER_SIZE;
+}
+/* }}} */
+
+/** @description: Return a buffer from pws_PoolAlloc
+ *  @param[in]: pool, buffer (NULL is ignored)
+ *  @return: None
+ */
+/* {{{ pws_PoolFree() */
+void pws_PoolFree( struct pws_pool *pool, void *ptr )
+{
+    struct pws_poolblock *block = NULL;
+    u32 sizeclass = 0;
+
+    if( ( NULL == pool ) || ( NULL == ptr ) )
+        return;
+
+    block = pws_PoolBlock( ptr );
+    sizeclass = block->sizeclass;
+
+    pthread_mutex_lock( &pool->lock );
+
+    pool->stats.bytes_in_use -= block->capacity;
+
+    if( ( PWS_POOL_OVERSIZE != sizeclass ) && ( pool->freecount[sizeclass] < pool->maxfree ) )
+    {
+        block->next = pool->freelist[sizeclass];
+        pool->freelist[sizeclass] = block;
+        pool->freecount[sizeclass]++;
+        pool->stats.bytes_cached += block->capacity;
+        block = NULL;
+    }
+
+    pthread_mutex_unlock( &pool->lock );
+
+    free( block );
+}
+/* }}} */
+
+/** @description: Usable size of a buffer from pws_PoolAlloc
+ *  @param[in]: buffer
+ *  @return: Capacity in bytes, 0 for NULL
+ */
+/* {{{ pws_PoolCapacity() */
+u32 pws_PoolCapacity( const void *ptr )
+{
+    if( NULL == ptr )
+        return 0;
+
+    return pws_PoolBlock( ptr )->capacity;
+}
+/* }}} */
+
+/** @description: Pre-fill the class holding size bytes with count free
+ *                blocks so the first frames do not allocate
+ *  @param[in]: pool, size, count
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_PoolReserve() */
+int pws_PoolReserve( struct pws_pool *pool, u32 size, u32 count )
+{
+    struct pws_poolblock *block = NULL;
+    u32 sizeclass = pws_PoolClass( size );
+    int ret = PWS_SUCCESS;
+
+    if( ( NULL == pool ) || ( PWS_POOL_OVERSIZE == sizeclass ) )
+        return PWS_FAILURE;
+
+    pthread_mutex_lock( &pool->lock );
+
+    if( count > pool->maxfree )
+        count = pool->maxfree;
+
+    while( pool->freecount[sizeclass] < count )
+    {
+        block = pws_PoolNewBlock( pool, sizeclass, size );
+
+        if( NULL == block )
+        {
+            ret = PWS_FAILURE;
+            break;
+        }
+
+        block->next = pool->freelist[sizeclass];
+        pool->freelist[sizeclass] = block;
+        pool->freecount[sizeclass]++;
+        pool->stats.bytes_cached += block->capacity;
+    }
+
+    pthread_mutex_unlock( &pool->lock );
+
+    return ret;
+}
+/* }}} */
+
+/** @description: Copy out the pool usage counters
+ *  @param[in]: pool
+ *  @param[out]: pststats
+ *  @return: None
+ */
+/* {{{ pws_PoolGetStats() */
+void pws_PoolGetStats( struct pws_pool *pool, pws_poolStats *pststats )
+{
+    pthread_mutex_lock( &pool->lock );
+    *pststats = pool->stats;
+    pthread_mutex_unlock( &pool->lock );
+}
+/* }}} */
@@ -0,0 +1,64 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PWS_POOL_H
+#define PWS_POOL_H
+
+/***** HEADER FILE *****/
+#include "pwstream.h"
+#include <pthread.h>
+
+/***** MACROS *****/
+#define PWS_POOL_MIN_SHIFT	12	// smallest class, 4 KiB
+#define PWS_POOL_MAX_SHIFT	26	// largest cached class, 64 MiB
+#define PWS_POOL_CLASSES	( PWS_POOL_MAX_SHIFT - PWS_POOL_MIN_SHIFT + 1 )
+
+/***** Structure Declaration *****/
+
+struct pws_poolblock;
+
+/* Frame buffer pool with power-of-two size classes.
+ *
+ * A request is rounded up to the next class, so a buffer that has to grow
+ * does so geometrically and frames alternating between IDR and P sizes keep
+ * reusing the same block. Freed blocks go back on their class list, at most
+ * maxfree per class; anything larger than the biggest class is allocated
+ * exactly and never cached. Blocks are only taken or returned when a buffer
+ * has to grow, so the lock is off the per-frame path once the pool is warm. */
+struct pws_pool
+{
+    pthread_mutex_t lock;
+
+    struct pws_poolblock *freelist[PWS_POOL_CLASSES];
+    u32 freecount[PWS_POOL_CLASSES];
+    u32 maxfree;
+
+    pws_poolStats stats;
+};
+
+/***** Prototype *****/
+struct pws_pool *pws_PoolCreate( u32 maxfree );
+void pws_PoolDestroy( struct pws_pool *pool );
+void *pws_PoolAlloc( struct pws_pool *pool, u32 size );
+void pws_PoolFree( struct pws_pool *pool, void *ptr );
+u32 pws_PoolCapacity( const void *ptr );
+int pws_PoolReserve( struct pws_pool *pool, u32 size, u32 count );
+void pws_PoolGetStats( struct pws_pool *pool, pws_poolStats *pststats );
+
+#endif /* PWS_POOL_H */
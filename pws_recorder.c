@@ -0,0 +1,788 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***** HEADER FILE *****/
+#include "pws_recorder.h"
+#include "pws_h264.h"
+#include "pws_stats.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/***** MACROS *****/
+#define PWS_RECORD_ALIGN(x)		( ( (u64)(x) + 15 ) & ~(u64)15 )
+#define PWS_RECORD_ENTRY_SIZE		PWS_RECORD_ALIGN( sizeof(struct pws_recordframe) )
+#define PWS_RECORD_NAL_LENGTH_SIZE	4
+
+/***** Function Definition *****/
+
+/** @description: CLOCK_MONOTONIC in nanoseconds
+ *  @param[in]: None
+ *  @return: Nanoseconds
+ */
+/* {{{ pws_RecorderNow() */
+static u64 pws_RecorderNow( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+/* }}} */
+
+/** @description: Frame data of a ring entry
+ *  @param[in]: frame
+ *  @return: First byte of the Annex-B frame
+ */
+/* {{{ pws_RecorderFrameData() */
+static const u8 *pws_RecorderFrameData( const struct pws_recordframe *frame )
+{
+    return (const u8 *)frame + PWS_RECORD_ENTRY_SIZE;
+}
+/* }}} */
+
+/** @description: Decode time of a frame in the current segment
+ *  @param[in]: rec, capture time
+ *  @return: PWS_MP4_TIMESCALE units since the segment started
+ */
+/* {{{ pws_RecorderTicks() */
+static u64 pws_RecorderTicks( struct pws_recorder *rec, u64 capture_ts_ns )
+{
+    if( capture_ts_ns <= rec->segmentstart_ns )
+        return 0;
+
+    /* ns * 90000 / 10^9 */
+    return ( capture_ts_ns - rec->segmentstart_ns ) * 9 / 100000;
+}
+/* }}} */
+
+/** @description: Hand ring space back to the producer
+ *  @param[in]: rec, ring position everything before which was written
+ *  @return: None
+ */
+/* {{{ pws_RecorderRelease() */
+static void pws_RecorderRelease( struct pws_recorder *rec, u64 pos )
+{
+    __atomic_store_n( &rec->tail, pos, __ATOMIC_RELEASE );
+}
+/* }}} */
+
+/** @description: Step to the next ring entry, past any padding
+ *  @param[in]: rec, head as last published
+ *  @param[out]: ppos - ring position of the entry
+ *  @return: Entry, or NULL when every published frame was seen
+ */
+/* {{{ pws_RecorderNextFrame() */
+static struct pws_recordframe *pws_RecorderNextFrame( struct pws_recorder *rec, u64 head, u64 *ppos )
+{
+    struct pws_recordframe *frame = NULL;
+    u32 offset = 0;
+
+    while( rec->readpos < head )
+    {
+        offset = (u32)( rec->readpos % rec->ringsize );
+        frame = (struct pws_recordframe *)( rec->ring + offset );
+
+        if( ( rec->ringsize - offset < PWS_RECORD_ENTRY_SIZE ) || ( 0 == frame->length ) )
+        {
+            rec->readpos += rec->ringsize - offset;
+            continue;
+        }
+
+        *ppos = rec->readpos;
+        rec->readpos += frame->length;
+
+        return frame;
+    }
+
+    return NULL;
+}
+/* }}} */
+
+/** @description: Write a whole iovec array to the segment, resuming after
+ *                short writes
+ *  @param[in]: rec, iov, niov - modified as the write progresses
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_RecorderWritev() */
+static int pws_RecorderWritev( struct pws_recorder *rec, struct iovec *iov, u32 niov )
+{
+    u64 start_ns = pws_RecorderNow();
+    ssize_t written = 0;
+
+    while( 0 != niov )
+    {
+        written = writev( rec->fd, iov, (int)niov );
+
+        if( written < 0 )
+        {
+            if( EINTR == errno )
+                continue;
+
+            return PWS_FAILURE;
+        }
+
+        pws_StatsAdd( &rec->stats->record_bytes, (u64)written );
+
+        while( ( 0 != niov ) && ( (size_t)written >= iov->iov_len ) )
+        {
+            written -= (ssize_t)iov->iov_len;
+            iov++;
+            niov--;
+        }
+
+        if( 0 != niov )
+        {
+            iov->iov_base = (u8 *)iov->iov_base + written;
+            iov->iov_len -= (size_t)written;
+        }
+    }
+
+    pws_StatsRecord( &rec->stats->record_write_ns, pws_RecorderNow() - start_ns );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Finish the current segment. A sample still held back for
+ *                its duration is lost, so callers flush it first
+ *  @param[in]: rec
+ *  @return: None
+ */
+/* {{{ pws_RecorderCloseSegment() */
+static void pws_RecorderCloseSegment( struct pws_recorder *rec )
+{
+    if( -1 == rec->fd )
+        return;
+
+    if( NULL != rec->pending )
+    {
+        pws_StatsAdd( &rec->stats->record_frames_dropped, 1 );
+        rec->pending = NULL;
+    }
+
+    close( rec->fd );
+    rec->fd = -1;
+
+    pws_StatsAdd( &rec->stats->record_segments, 1 );
+}
+/* }}} */
+
+/** @description: Write the batched frames as one fragment or one run of
+ *                Annex-B, and release their ring space
+ *  @param[in]: rec
+ *  @return: None
+ */
+/* {{{ pws_RecorderFlush() */
+static void pws_RecorderFlush( struct pws_recorder *rec )
+{
+    struct iovec *iov = &rec->iov[1];
+    u32 niov = rec->niov - 1;
+    u32 length = 0;
+    int ret = PWS_FAILURE;
+
+    if( 0 == rec->nbatch )
+        return;
+
+    if( PWS_RECORD_FMP4 == rec->enformat )
+    {
+        length = pws_Mp4WriteFragment( rec->header, sizeof(rec->header), ++rec->fragmentseq,
+                                       pws_RecorderTicks( rec, rec->batch[0]->capture_ts_ns ),
+                                       rec->samples, rec->nbatch );
+
+        rec->iov[0].iov_base = rec->header;
+        rec->iov[0].iov_len = length;
+        iov = &rec->iov[0];
+        niov = rec->niov;
+    }
+
+    if( ( -1 != rec->fd ) && ( ( PWS_RECORD_FMP4 != rec->enformat ) || ( 0 != length ) ) )
+        ret = pws_RecorderWritev( rec, iov, niov );
+
+    if( PWS_SUCCESS == ret )
+    {
+        pws_StatsAdd( &rec->stats->record_frames, rec->nbatch );
+    }
+    else
+    {
+        pws_StatsAdd( &rec->stats->record_frames_dropped, rec->nbatch );
+
+        /* The segment is cut here and the next sync point starts another */
+        if( -1 != rec->fd )
+        {
+            pws_StatsAdd( &rec->stats->record_write_errors, 1 );
+            pws_RecorderCloseSegment( rec );
+        }
+    }
+
+    pws_RecorderRelease( rec, rec->batchend );
+
+    rec->nbatch = 0;
+    rec->niov = 1;
+}
+/* }}} */
+
+/** @description: Queue a frame's NAL units for writing, each behind its
+ *                4-byte length as fMP4 samples carry them
+ *  @param[in]: rec, frame
+ *  @param[out]: psize - sample size
+ *  @return: false if the iovec array is too full to take them
+ */
+/* {{{ pws_RecorderQueueNals() */
+static bool pws_RecorderQueueNals( struct pws_recorder *rec, const struct pws_recordframe *frame, u32 *psize )
+{
+    const u8 *data = pws_RecorderFrameData( frame );
+    const u8 *end = data + frame->size;
+    const u8 *sc = pws_H264FindStartCode( data, end );
+    const u8 *nal = NULL;
+    const u8 *nalend = NULL;
+    u32 niov = rec->niov;
+    u32 size = 0;
+
+    while( sc < end )
+    {
+        nal = sc + 3;
+        sc = pws_H264FindStartCode( nal, end );
+
+        /* Zero bytes before a start code belong to it, not to the NAL */
+        nalend = sc;
+
+        while( ( sc < end ) && ( nalend > nal ) && ( 0 == nalend[-1] ) )
+            nalend--;
+
+        if( nal >= nalend )
+            continue;
+
+        if( niov + 2 > PWS_RECORD_MAX_IOV )
+            return false;
+
+        rec->nallengths[niov] = htonl( (u32)( nalend - nal ) );
+        rec->iov[niov].iov_base = &rec->nallengths[niov];
+        rec->iov[niov].iov_len = PWS_RECORD_NAL_LENGTH_SIZE;
+        rec->iov[niov + 1].iov_base = (void *)nal;
+        rec->iov[niov + 1].iov_len = (size_t)( nalend - nal );
+
+        size += PWS_RECORD_NAL_LENGTH_SIZE + (u32)( nalend - nal );
+        niov += 2;
+    }
+
+    rec->niov = niov;
+    *psize = size;
+
+    return true;
+}
+/* }}} */
+
+/** @description: Add a frame to the batch, flushing first when the batch
+ *                is full
+ *  @param[in]: rec, frame, its ring position, duration for fMP4
+ *  @return: None
+ */
+/* {{{ pws_RecorderBatch() */
+static void pws_RecorderBatch( struct pws_recorder *rec, struct pws_recordframe *frame, u64 pos, u32 duration )
+{
+    u32 size = frame->size;
+    bool queued = false;
+
+    if( ( PWS_RECORD_MAX_SAMPLES == rec->nbatch ) || ( PWS_RECORD_MAX_IOV == rec->niov ) )
+        pws_RecorderFlush( rec );
+
+    if( ( -1 != rec->fd ) && ( PWS_RECORD_FMP4 == rec->enformat ) )
+    {
+        queued = pws_RecorderQueueNals( rec, frame, &size );
+
+        if( false == queued )
+        {
+            pws_RecorderFlush( rec );
+            queued = ( -1 != rec->fd ) && pws_RecorderQueueNals( rec, frame, &size );
+        }
+    }
+    else if( -1 != rec->fd )
+    {
+        rec->iov[rec->niov].iov_base = (void *)pws_RecorderFrameData( frame );
+        rec->iov[rec->niov].iov_len = frame->size;
+        rec->niov++;
+        queued = true;
+    }
+
+    /* A flush failed and cut the segment, or the frame has more NAL units
+     * than one write takes. Either way nothing is batched before it */
+    if( false == queued )
+    {
+        pws_StatsAdd( &rec->stats->record_frames_dropped, 1 );
+        pws_RecorderRelease( rec, pos + frame->length );
+        return;
+    }
+
+    rec->batch[rec->nbatch] = frame;
+    rec->samples[rec->nbatch].duration = duration;
+    rec->samples[rec->nbatch].size = size;
+    rec->samples[rec->nbatch].syncpoint = frame->syncpoint;
+    rec->nbatch++;
+    rec->batchend = pos + frame->length;
+}
+/* }}} */
+
+/** @description: Batch the fMP4 sample held back, now that the next frame
+ *                gives its duration
+ *  @param[in]: rec, next frame
+ *  @return: None
+ */
+/* {{{ pws_RecorderBatchPending() */
+static void pws_RecorderBatchPending( struct pws_recorder *rec, const struct pws_recordframe *next )
+{
+    struct pws_recordframe *pending = rec->pending;
+    u64 start = 0;
+    u64 end = 0;
+
+    if( NULL == pending )
+        return;
+
+    rec->pending = NULL;
+
+    start = pws_RecorderTicks( rec, pending->capture_ts_ns );
+    end = pws_RecorderTicks( rec, next->capture_ts_ns );
+
+    /* Out-of-order or repeated timestamps keep the last good duration */
+    if( ( end > start ) && ( end - start <= 0xFFFFFFFFULL ) )
+        rec->lastduration = (u32)( end - start );
+
+    pws_RecorderBatch( rec, pending, rec->pendingpos, rec->lastduration );
+}
+/* }}} */
+
+/** @description: Find the SPS and PPS for an fMP4 init segment, in the
+ *                frame itself or else in the stream's parameter cache
+ *  @param[in]: rec, sync frame
+ *  @param[out]: sets - storage for cached sets, sps/pps and their sizes
+ *               without start code
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_RecorderParamSets() */
+static int pws_RecorderParamSets( struct pws_recorder *rec, const struct pws_recordframe *frame, pws_paramSets *sets,
+                                  const u8 **psps, u32 *pspssize, const u8 **ppps, u32 *pppssize )
+{
+    const u8 *data = pws_RecorderFrameData( frame );
+    const u8 *end = data + frame->size;
+    const u8 *sc = pws_H264FindStartCode( data, end );
+    const u8 *nal = NULL;
+    const u8 *nalend = NULL;
+
+    *psps = NULL;
+    *ppps = NULL;
+
+    while( sc < end )
+    {
+        nal = sc + 3;
+        sc = pws_H264FindStartCode( nal, end );
+        nalend = sc;
+
+        while( ( sc < end ) && ( nalend > nal ) && ( 0 == nalend[-1] ) )
+            nalend--;
+
+        if( nal >= nalend )
+            continue;
+
+        if( ( PWS_NAL_TYPE_SPS == ( nal[0] & 0x1F ) ) && ( NULL == *psps ) )
+        {
+            *psps = nal;
+            *pspssize = (u32)( nalend - nal );
+        }
+        else if( ( PWS_NAL_TYPE_PPS == ( nal[0] & 0x1F ) ) && ( NULL == *ppps ) )
+        {
+            *ppps = nal;
+            *pppssize = (u32)( nalend - nal );
+        }
+    }
+
+    if( ( NULL != *psps ) && ( NULL != *ppps ) )
+        return PWS_SUCCESS;
+
+    /* Cached sets carry a 4-byte start code */
+    pws_H264ReadParamCache( rec->paramcache, sets );
+
+    if( ( sets->sps_size <= 4 ) || ( sets->pps_size <= 4 ) )
+        return PWS_FAILURE;
+
+    *psps = sets->sps + 4;
+    *pspssize = sets->sps_size - 4;
+    *ppps = sets->pps + 4;
+    *pppssize = sets->pps_size - 4;
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Start a segment file at a sync frame, with its init
+ *                segment for fMP4, or the cached SPS/PPS for Annex-B when
+ *                the frame has none
+ *  @param[in]: rec, sync frame
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_RecorderOpenSegment() */
+static int pws_RecorderOpenSegment( struct pws_recorder *rec, const struct pws_recordframe *frame )
+{
+    char path[PATH_MAX];
+    struct timespec now;
+    struct iovec iov;
+    pws_paramSets sets;
+    const u8 *sps = NULL;
+    const u8 *pps = NULL;
+    u32 spssize = 0;
+    u32 ppssize = 0;
+    u32 length = 0;
+
+    if( PWS_RECORD_FMP4 == rec->enformat )
+    {
+        if( PWS_SUCCESS != pws_RecorderParamSets( rec, frame, &sets, &sps, &spssize, &pps, &ppssize ) )
+            return PWS_FAILURE;
+
+        length = pws_Mp4WriteInit( rec->header, sizeof(rec->header), sps, spssize, pps, ppssize,
+                                   frame->width, frame->height );
+
+        if( 0 == length )
+            return PWS_FAILURE;
+    }
+    else if( ( PWS_SUCCESS == pws_RecorderParamSets( rec, frame, &sets, &sps, &spssize, &pps, &ppssize ) ) &&
+             ( sps == sets.sps + 4 ) )
+    {
+        /* The IDR carries no parameter sets of its own; put the cached ones,
+         * start codes included, ahead of it so the segment decodes alone */
+        memcpy( rec->header, sets.sps, sets.sps_size );
+        memcpy( rec->header + sets.sps_size, sets.pps, sets.pps_size );
+        length = sets.sps_size + sets.pps_size;
+    }
+
+    /* Named by wall-clock start so segments sort in recording order */
+    clock_gettime( CLOCK_REALTIME, &now );
+
+    if( snprintf( path, sizeof(path), "%s/%s-%llu.%s", rec->directory, rec->prefix,
+                  (u64)now.tv_sec * 1000ULL + (u64)now.tv_nsec / 1000000ULL,
+                  ( PWS_RECORD_FMP4 == rec->enformat ) ? "mp4" : "h264" ) >= (int)sizeof(path) )
+        return PWS_FAILURE;
+
+    rec->fd = open( path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 );
+
+    if( -1 == rec->fd )
+    {
+        pws_StatsAdd( &rec->stats->record_write_errors, 1 );
+        return PWS_FAILURE;
+    }
+
+    rec->segmentstart_ns = frame->capture_ts_ns;
+    rec->segmentsize = 0;
+    rec->fragmentseq = 0;
+
+    if( 0 != length )
+    {
+        iov.iov_base = rec->header;
+        iov.iov_len = length;
+
+        if( PWS_SUCCESS != pws_RecorderWritev( rec, &iov, 1 ) )
+        {
+            pws_StatsAdd( &rec->stats->record_write_errors, 1 );
+            close( rec->fd );
+            rec->fd = -1;
+            return PWS_FAILURE;
+        }
+    }
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Place one frame from the ring: rotate at a sync point when
+ *                a limit was reached, start a segment if none is open, and
+ *                batch the frame or hold it back for its duration
+ *  @param[in]: rec, frame, its ring position
+ *  @return: None
+ */
+/* {{{ pws_RecorderTake() */
+static void pws_RecorderTake( struct pws_recorder *rec, struct pws_recordframe *frame, u64 pos )
+{
+    bool rotate = false;
+
+    if( ( true == frame->syncpoint ) && ( -1 != rec->fd ) )
+    {
+        rotate = ( ( 0 != rec->segmentns ) && ( frame->capture_ts_ns > rec->segmentstart_ns ) &&
+                   ( frame->capture_ts_ns - rec->segmentstart_ns >= rec->segmentns ) ) ||
+                 ( ( 0 != rec->segmentbytes ) && ( rec->segmentsize >= rec->segmentbytes ) );
+    }
+
+    pws_RecorderBatchPending( rec, frame );
+
+    if( true == rotate )
+    {
+        pws_RecorderFlush( rec );
+        pws_RecorderCloseSegment( rec );
+    }
+
+    /* Nothing is batched or held back without a segment */
+    if( -1 == rec->fd )
+    {
+        if( ( false == frame->syncpoint ) || ( PWS_SUCCESS != pws_RecorderOpenSegment( rec, frame ) ) )
+        {
+            pws_StatsAdd( &rec->stats->record_frames_dropped, 1 );
+            pws_RecorderRelease( rec, pos + frame->length );
+            return;
+        }
+    }
+
+    if( PWS_RECORD_FMP4 == rec->enformat )
+    {
+        rec->pending = frame;
+        rec->pendingpos = pos;
+    }
+    else
+    {
+        pws_RecorderBatch( rec, frame, pos, 0 );
+    }
+
+    /* Counted before the write, so rotation sees the segment grow */
+    rec->segmentsize += frame->size;
+}
+/* }}} */
+
+/** @description: Writer thread: every flushms, or when woken early, write
+ *                all frames queued so far. Once stopped, drain the ring and
+ *                finish the segment
+ *  @param[in]: rec
+ *  @return: NULL
+ */
+/* {{{ pws_RecorderWriter() */
+static void *pws_RecorderWriter( void *arg )
+{
+    struct pws_recorder *rec = (struct pws_recorder *)arg;
+    struct pws_recordframe *frame = NULL;
+    struct timespec timeout;
+    bool stopping = false;
+    u64 head = 0;
+    u64 pos = 0;
+    u32 sequence = 0;
+
+    timeout.tv_sec = (time_t)( rec->flushns / 1000000000ULL );
+    timeout.tv_nsec = (long)( rec->flushns % 1000000000ULL );
+
+    for( ;; )
+    {
+        sequence = __atomic_load_n( &rec->wakeseq, __ATOMIC_ACQUIRE );
+        stopping = __atomic_load_n( &rec->stopping, __ATOMIC_ACQUIRE );
+        head = __atomic_load_n( &rec->head, __ATOMIC_ACQUIRE );
+
+        while( NULL != ( frame = pws_RecorderNextFrame( rec, head, &pos ) ) )
+            pws_RecorderTake( rec, frame, pos );
+
+        pws_RecorderFlush( rec );
+
+        if( true == stopping )
+            break;
+
+        syscall( SYS_futex, &rec->wakeseq, FUTEX_WAIT_PRIVATE, sequence, &timeout, NULL, 0 );
+    }
+
+    /* The last sample gets the duration of the one before it */
+    if( NULL != rec->pending )
+    {
+        frame = rec->pending;
+        rec->pending = NULL;
+        pws_RecorderBatch( rec, frame, rec->pendingpos, rec->lastduration );
+        pws_RecorderFlush( rec );
+    }
+
+    pws_RecorderCloseSegment( rec );
+
+    return NULL;
+}
+/* }}} */
+
+/** @description: Set up a recorder and start its writer thread
+ *  @param[in]: pstconfig - as given to pws_RecordStart
+ *              framerate - nominal rate, for a duration no timestamp gives
+ *              stats - stream counters for the record_* fields
+ *              paramcache - SPS/PPS for segments whose first IDR has none
+ *  @return: Recorder handle or NULL
+ */
+/* {{{ pws_RecorderCreate() */
+struct pws_recorder *pws_RecorderCreate( const pws_recordConfig *pstconfig, u32 framerate,
+                                         pws_streamStats *stats, struct pws_paramcache *paramcache )
+{
+    struct pws_recorder *rec = NULL;
+    u32 ringsize = 0;
+    u32 flushms = 0;
+
+    if( ( NULL == pstconfig ) || ( NULL == pstconfig->directory ) || ( NULL == stats ) || ( NULL == paramcache ) ||
+        ( ( PWS_RECORD_ANNEXB != pstconfig->enformat ) && ( PWS_RECORD_FMP4 != pstconfig->enformat ) ) )
+        return NULL;
+
+    ringsize = ( 0 != pstconfig->budgetbytes ) ? pstconfig->budgetbytes : PWS_DEF_RECORD_BUDGET;
+    ringsize &= ~15U;
+
+    if( ringsize < 2 * PWS_RECORD_ENTRY_SIZE )
+        return NULL;
+
+    flushms = ( 0 != pstconfig->flushms ) ? pstconfig->flushms : PWS_DEF_RECORD_FLUSH_MS;
+
+    rec = (struct pws_recorder *)calloc( 1, sizeof(struct pws_recorder) );
+
+    if( NULL == rec )
+        return NULL;
+
+    rec->fd = -1;
+    rec->niov = 1;
+    rec->enformat = pstconfig->enformat;
+    rec->segmentns = (u64)pstconfig->segmentms * 1000000ULL;
+    rec->segmentbytes = pstconfig->segmentbytes;
+    rec->flushns = (u64)flushms * 1000000ULL;
+    rec->stats = stats;
+    rec->paramcache = paramcache;
+    rec->lastduration = PWS_MP4_TIMESCALE / ( ( 0 != framerate ) ? framerate : PWS_DEF_FRAMERATE );
+    rec->ringsize = ringsize;
+
+    rec->directory = strdup( pstconfig->directory );
+    rec->prefix = strdup( ( NULL != pstconfig->prefix ) ? pstconfig->prefix : PWS_DEF_RECORD_PREFIX );
+    rec->ring = (u8 *)malloc( ringsize );
+
+    if( ( NULL == rec->directory ) || ( NULL == rec->prefix ) || ( NULL == rec->ring ) )
+    {
+        pws_RecorderDestroy( rec );
+        return NULL;
+    }
+
+    /* Fault the pages in here rather than on the PipeWire thread */
+    memset( rec->ring, 0, ringsize );
+
+    if( pthread_create( &rec->writer, NULL, pws_RecorderWriter, rec ) != 0 )
+    {
+        pws_RecorderDestroy( rec );
+        return NULL;
+    }
+
+    rec->started = true;
+
+    return rec;
+}
+/* }}} */
+
+/** @description: Stop the recorder once every queued frame is on disk, and
+ *                close the last segment. No frame may be published any more
+ *  @param[in]: rec
+ *  @return: None
+ */
+/* {{{ pws_RecorderDestroy() */
+void pws_RecorderDestroy( struct pws_recorder *rec )
+{
+    if( NULL == rec )
+        return;
+
+    if( true == rec->started )
+    {
+        __atomic_store_n( &rec->stopping, true, __ATOMIC_RELEASE );
+        __atomic_fetch_add( &rec->wakeseq, 1, __ATOMIC_RELEASE );
+        syscall( SYS_futex, &rec->wakeseq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0 );
+
+        pthread_join( rec->writer, NULL );
+    }
+
+    free( rec->ring );
+    free( rec->prefix );
+    free( rec->directory );
+    free( rec );
+}
+/* }}} */
+
+/** @description: Queue a frame for the writer. Runs on the PipeWire thread:
+ *                one copy into the ring, no lock, no allocation. A frame
+ *                that does not fit is dropped with the rest of its GOP
+ *  @param[in]: rec, frame, ingest metadata, sync point
+ *  @return: None
+ */
+/* {{{ pws_RecorderPublish() */
+void pws_RecorderPublish( struct pws_recorder *rec, const pws_frameInfo *pstframeinfo,
+                          const struct pws_framemeta *meta, bool syncpoint )
+{
+    struct pws_recordframe *frame = NULL;
+    u64 head = rec->head;
+    u64 tail = __atomic_load_n( &rec->tail, __ATOMIC_ACQUIRE );
+    u64 length = PWS_RECORD_ENTRY_SIZE + PWS_RECORD_ALIGN( pstframeinfo->frame_size );
+    u64 half = rec->ringsize / 2;
+    u32 offset = (u32)( head % rec->ringsize );
+    u32 pad = 0;
+
+    /* Only H.264 goes into segments */
+    if( ( PWS_STREAM_TYPE_VIDEO != pstframeinfo->stream_type ) || ( 0 != meta->nplanes ) )
+        return;
+
+    if( ( true == rec->waitsync ) && ( false == syncpoint ) )
+    {
+        pws_StatsAdd( &rec->stats->record_frames_dropped, 1 );
+        return;
+    }
+
+    /* An entry never wraps; the rest of the ring is skipped instead */
+    if( rec->ringsize - offset < length )
+        pad = rec->ringsize - offset;
+
+    if( pad + length > rec->ringsize - ( head - tail ) )
+    {
+        pws_StatsAdd( &rec->stats->record_frames_dropped, 1 );
+        rec->waitsync = true;
+        return;
+    }
+
+    if( 0 != pad )
+    {
+        if( pad >= PWS_RECORD_ENTRY_SIZE )
+            ( (struct pws_recordframe *)( rec->ring + offset ) )->length = 0;
+
+        offset = 0;
+    }
+
+    frame = (struct pws_recordframe *)( rec->ring + offset );
+    frame->length = (u32)length;
+    frame->size = pstframeinfo->frame_size;
+    frame->capture_ts_ns = meta->capture_ts_ns;
+    frame->width = pstframeinfo->width;
+    frame->height = pstframeinfo->height;
+    frame->syncpoint = syncpoint;
+
+    memcpy( (u8 *)frame + PWS_RECORD_ENTRY_SIZE, pstframeinfo->frame_ptr, pstframeinfo->frame_size );
+
+    pws_StatsAdd( &rec->stats->bytes_copied, pstframeinfo->frame_size );
+
+    __atomic_store_n( &rec->head, head + pad + length, __ATOMIC_RELEASE );
+
+    rec->waitsync = false;
+
+    /* Wake the writer early once half the budget is waiting */
+    if( ( head - tail < half ) && ( head + pad + length - tail >= half ) )
+    {
+        __atomic_fetch_add( &rec->wakeseq, 1, __ATOMIC_RELEASE );
+        syscall( SYS_futex, &rec->wakeseq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0 );
+    }
+}
+/* }}} */
@@ -0,0 +1,116 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PWS_RECORDER_H
+#define PWS_RECORDER_H
+
+/***** HEADER FILE *****/
+#include "pwstream.h"
+#include "pws_ring.h"
+#include "pws_mp4.h"
+#include <pthread.h>
+#include <sys/uio.h>
+
+/***** MACROS *****/
+#define PWS_RECORD_MAX_SAMPLES		64	// frames in one write call
+#define PWS_RECORD_MAX_IOV		1024	// IOV_MAX on Linux
+#define PWS_RECORD_HEADER_SIZE		4096	// init segment, fragment header or Annex-B SPS/PPS
+
+/***** Structure Declaration *****/
+
+struct pws_paramcache;
+
+/* Entry in the recorder ring, the Annex-B frame right after it. An entry
+ * never wraps: the producer pads the end of the ring with an entry of
+ * length 0, or leaves it implicitly when not even a header fits there. */
+struct pws_recordframe
+{
+    u32 length;				// ring bytes taken, header and padding included
+    u32 size;				// frame bytes
+    u64 capture_ts_ns;
+    u32 width;
+    u32 height;
+    bool syncpoint;
+};
+
+/* Segment recorder started with pws_RecordStart.
+ *
+ * The process callback copies each frame once into a byte ring of
+ * budgetbytes and moves on; it never locks, allocates or waits for the
+ * disk. A frame that does not fit is dropped with the rest of its GOP. A
+ * writer thread wakes every flushms, or early once half the ring is used,
+ * and writes all queued frames with as few writev calls as it can, straight
+ * from the ring. Only then is their space released.
+ *
+ * Segments start on a sync point and rotate at the first one after either
+ * limit is reached. An fMP4 segment is self-contained: its own init segment,
+ * then one fragment per write. Each sample is held back until the next frame
+ * gives its duration. */
+struct pws_recorder
+{
+    char *directory;
+    char *prefix;
+    PWS_RECORD_FORMAT enformat;
+    u64 segmentns;
+    u64 segmentbytes;
+    u64 flushns;
+
+    pws_streamStats *stats;
+    struct pws_paramcache *paramcache;
+
+    u8 *ring;
+    u32 ringsize;
+    u64 head;				// producer, bytes published
+    u64 tail;				// writer, bytes released
+    bool waitsync;			// producer only, dropping up to the next sync point
+    u32 wakeseq;			// futex word the writer sleeps on
+    bool stopping;
+
+    pthread_t writer;
+    bool started;
+
+    /* Writer thread only from here */
+    u64 readpos;			// next entry to look at
+    s32 fd;				// current segment, -1 between segments
+    u64 segmentstart_ns;		// capture time of the first frame, decode time 0
+    u64 segmentsize;
+    u32 fragmentseq;
+
+    struct pws_recordframe *batch[PWS_RECORD_MAX_SAMPLES];
+    struct pws_mp4sample samples[PWS_RECORD_MAX_SAMPLES];
+    u32 nbatch;
+    u64 batchend;			// ring position after the last frame batched
+    struct pws_recordframe *pending;	// fMP4 sample waiting for its duration
+    u64 pendingpos;
+    u32 lastduration;
+
+    struct iovec iov[PWS_RECORD_MAX_IOV];	// iov[0] is the fragment header
+    u32 niov;
+    u32 nallengths[PWS_RECORD_MAX_IOV];
+    u8 header[PWS_RECORD_HEADER_SIZE];
+};
+
+/***** Prototype *****/
+struct pws_recorder *pws_RecorderCreate( const pws_recordConfig *pstconfig, u32 framerate,
+                                         pws_streamStats *stats, struct pws_paramcache *paramcache );
+void pws_RecorderDestroy( struct pws_recorder *rec );
+void pws_RecorderPublish( struct pws_recorder *rec, const pws_frameInfo *pstframeinfo,
+                          const struct pws_framemeta *meta, bool syncpoint );
+
+#endif /* PWS_RECORDER_H */
@@ -0,0 +1,438 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***** HEADER FILE *****/
+#include "pws_ring.h"
+#include "pws_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+/***** MACROS *****/
+#define PWS_RING_BUSY(start, count)	( ( (u64)(start) << 32 ) | (u64)(count) )
+#define PWS_RING_BUSY_START(busy)	( (u32)( (busy) >> 32 ) )
+#define PWS_RING_BUSY_COUNT(busy)	( (u32)( (busy) & 0xFFFFFFFF ) )
+
+/***** Function Definition *****/
+
+/** @description: Allocate a frame ring with depth slots
+ *  @param[in]: depth, overflow policy, pool backing the slot buffers
+ *  @return: Ring handle or NULL
+ */
+/* {{{ pws_RingCreate() */
+struct pws_ring *pws_RingCreate( u32 depth, PWS_OVERFLOW_POLICY enpolicy, struct pws_pool *pool )
+{
+    struct pws_ring *ring = NULL;
+
+    if( 0 == depth )
+        depth = PWS_DEF_RING_DEPTH;
+
+    if( depth > PWS_MAX_RING_DEPTH )
+        depth = PWS_MAX_RING_DEPTH;
+
+    ring = (struct pws_ring *)calloc(1, sizeof(struct pws_ring));
+
+    if( NULL == ring )
+        return NULL;
+
+    ring->slots = (struct pws_ring_slot *)calloc(depth, sizeof(struct pws_ring_slot));
+
+    if( NULL == ring->slots )
+    {
+        free( ring );
+        return NULL;
+    }
+
+    ring->depth = depth;
+    ring->enpolicy = enpolicy;
+    ring->pool = pool;
+
+    return ring;
+}
+/* }}} */
+
+/** @description: Release a frame ring and every slot buffer
+ *  @param[in]: ring
+ *  @return: None
+ */
+/* {{{ pws_RingDestroy() */
+void pws_RingDestroy( struct pws_ring *ring )
+{
+    u32 i = 0;
+
+    if( NULL == ring )
+        return;
+
+    for( i = 0; i < ring->depth; i++ )
+    {
+        pws_PoolFree( ring->pool, ring->slots[i].buffer );
+        ring->slots[i].buffer = NULL;
+    }
+
+    free( ring->slots );
+    free( ring );
+}
+/* }}} */
+
+/** @description: Check whether the consumer is reading from a slot
+ *  @param[in]: ring, slot index
+ *  @return: true if the slot must not be written
+ */
+/* {{{ pws_RingSlotBusy() */
+static bool pws_RingSlotBusy( struct pws_ring *ring, u32 slot )
+{
+    u64 busy = __atomic_load_n( &ring->busy, __ATOMIC_SEQ_CST );
+    u32 count = PWS_RING_BUSY_COUNT( busy );
+
+    if( 0 == count )
+        return false;
+
+    return ( ( slot + ring->depth - PWS_RING_BUSY_START( busy ) ) % ring->depth ) < count;
+}
+/* }}} */
+
+/** @description: Start or extend a GOP cut under PWS_OVERFLOW_DROP_GOP; the
+ *                incoming frame and the rest of its GOP are dropped
+ *  @param[in]: ring
+ *  @param[out]: pflags
+ *  @return: NULL
+ */
+/* {{{ pws_RingSkipGop() */
+static struct pws_ring_slot *pws_RingSkipGop( struct pws_ring *ring, u32 *pflags )
+{
+    if( false == ring->gopskip )
+        *pflags |= PWS_RING_GOP_STARTED;
+
+    ring->gopskip = true;
+    *pflags |= PWS_RING_GOP_SKIPPED;
+
+    __atomic_fetch_add( &ring->dropped_newest, 1, __ATOMIC_RELAXED );
+
+    return NULL;
+}
+/* }}} */
+
+/** @description: Get the next slot to write, applying the overflow policy.
+ *                In copy mode the slot's buffer is grown first, so a frame
+ *                that evicts the oldest one is always committed
+ *  @param[in]: ring, whether the incoming frame decodes on its own (only
+ *              used by PWS_OVERFLOW_DROP_GOP), bytes the slot buffer must
+ *              hold (0 when the frame is not copied into the slot)
+ *  @param[out]: pflags - PWS_RING_EVICTED when the returned slot still held
+ *               the oldest, unread frame, which is now dropped; the
+ *               PWS_RING_GOP_* flags for frames dropped by the GOP policy;
+ *               PWS_RING_NO_MEMORY when the slot buffer could not grow
+ *  @return: Slot to fill, or NULL when the incoming frame must be dropped
+ */
+/* {{{ pws_RingProducerAcquire() */
+struct pws_ring_slot *pws_RingProducerAcquire( struct pws_ring *ring, bool syncpoint, u32 size, u32 *pflags )
+{
+    bool gop = ( PWS_OVERFLOW_DROP_GOP == ring->enpolicy );
+    struct pws_ring_slot *slot = NULL;
+    u8 *buffer = NULL;
+    u64 head = 0;
+    u64 tail = 0;
+
+    *pflags = 0;
+
+    if( true == gop )
+    {
+        if( true == syncpoint )
+            ring->gopskip = false;
+        else if( true == ring->gopskip )
+            return pws_RingSkipGop( ring, pflags );
+    }
+
+    head = __atomic_load_n( &ring->head, __ATOMIC_RELAXED );
+    tail = __atomic_load_n( &ring->tail, __ATOMIC_SEQ_CST );
+    slot = &ring->slots[head % ring->depth];
+
+    if( ( head - tail >= ring->depth ) && ( PWS_OVERFLOW_DROP_NEWEST == ring->enpolicy ) )
+    {
+        __atomic_fetch_add( &ring->dropped_newest, 1, __ATOMIC_RELAXED );
+        return NULL;
+    }
+
+    if( ( head - tail >= ring->depth ) && ( true == gop ) && ( false == syncpoint ) )
+        return pws_RingSkipGop( ring, pflags );
+
+    /* The slot may still hold the oldest frame, which the consumer can
+     * claim until it is evicted, so its buffer is only swapped later */
+    if( size > slot->capacity )
+    {
+        buffer = (u8*)pws_PoolAlloc( ring->pool, size );
+
+        if( NULL == buffer )
+        {
+            *pflags |= PWS_RING_NO_MEMORY;
+            __atomic_fetch_add( &ring->dropped_newest, 1, __ATOMIC_RELAXED );
+            return NULL;
+        }
+    }
+
+    if( head - tail >= ring->depth )
+    {
+        /* Raised before the eviction: a consumer that claims after it is
+         * guaranteed to see the flag */
+        if( true == gop )
+            __atomic_store_n( &ring->resync, 1, __ATOMIC_SEQ_CST );
+
+        /* A failed CAS means the consumer claimed the oldest frame first,
+         * which frees the same room. */
+        if( __atomic_compare_exchange_n( &ring->tail, &tail, tail + 1, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) )
+        {
+            __atomic_fetch_add( &ring->dropped_oldest, 1, __ATOMIC_RELAXED );
+            *pflags |= PWS_RING_EVICTED;
+
+            if( true == gop )
+                *pflags |= PWS_RING_GOP_SKIPPED | PWS_RING_GOP_STARTED;
+        }
+    }
+
+    /* A slot just evicted is the producer's: the busy range may still name
+     * it, published by a claim whose CAS then lost to the eviction, so it
+     * is not consulted. Otherwise the consumer may hold a claim on the slot
+     * from before the ring last filled up. */
+    if( ( 0 == ( *pflags & PWS_RING_EVICTED ) ) && pws_RingSlotBusy( ring, (u32)( head % ring->depth ) ) )
+    {
+        pws_PoolFree( ring->pool, buffer );
+
+        /* Even a sync point: its GOP goes with it */
+        if( true == gop )
+            return pws_RingSkipGop( ring, pflags );
+
+        __atomic_fetch_add( &ring->dropped_newest, 1, __ATOMIC_RELAXED );
+        return NULL;
+    }
+
+    if( NULL != buffer )
+    {
+        pws_PoolFree( ring->pool, slot->buffer );
+
+        slot->buffer = buffer;
+        slot->capacity = pws_PoolCapacity( buffer );
+    }
+
+    if( 0 != size )
+        slot->info.frame_ptr = slot->buffer;
+
+    return slot;
+}
+/* }}} */
+
+/** @description: Publish the slot returned by pws_RingProducerAcquire
+ *  @param[in]: ring
+ *  @return: None
+ */
+/* {{{ pws_RingProducerCommit() */
+void pws_RingProducerCommit( struct pws_ring *ring )
+{
+    u64 head = __atomic_load_n( &ring->head, __ATOMIC_RELAXED );
+
+    __atomic_store_n( &ring->head, head + 1, __ATOMIC_RELEASE );
+}
+/* }}} */
+
+/** @description: Grow the slot's own buffer so it can hold size bytes and
+ *                point the slot frame at it. The old contents are not kept
+ *  @param[in]: ring, slot, size
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_RingReserve() */
+int pws_RingReserve( struct pws_ring *ring, struct pws_ring_slot *slot, u32 size )
+{
+    u8 *buffer = NULL;
+
+    if( size > slot->capacity )
+    {
+        buffer = (u8*)pws_PoolAlloc( ring->pool, size );
+
+        if( NULL == buffer )
+            return PWS_FAILURE;
+
+        pws_PoolFree( ring->pool, slot->buffer );
+
+        slot->buffer = buffer;
+        slot->capacity = pws_PoolCapacity( buffer );
+    }
+
+    slot->info.frame_ptr = slot->buffer;
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Give every slot a buffer of at least size bytes before
+ *                the stream starts. Must not run while frames are queued
+ *  @param[in]: ring, size
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_RingPrealloc() */
+int pws_RingPrealloc( struct pws_ring *ring, u32 size )
+{
+    u32 i = 0;
+
+    for( i = 0; i < ring->depth; i++ )
+    {
+        if( PWS_SUCCESS != pws_RingReserve( ring, &ring->slots[i], size ) )
+            return PWS_FAILURE;
+
+        ring->slots[i].info.frame_ptr = NULL;
+    }
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Claim up to maxslots of the oldest frames for reading. The
+ *                slots stay reserved until pws_RingConsumerDone
+ *  @param[in]: ring, maxslots
+ *  @param[out]: slots - claimed slots, oldest first
+ *  @return: Number of slots claimed
+ */
+/* {{{ pws_RingConsumerClaim() */
+u32 pws_RingConsumerClaim( struct pws_ring *ring, struct pws_ring_slot **slots, u32 maxslots )
+{
+    u64 head = 0;
+    u64 tail = 0;
+    u32 count = 0;
+    u32 i = 0;
+
+    if( 0 == maxslots )
+        return 0;
+
+    tail = __atomic_load_n( &ring->tail, __ATOMIC_SEQ_CST );
+
+    do
+    {
+        head = __atomic_load_n( &ring->head, __ATOMIC_ACQUIRE );
+
+        if( head == tail )
+        {
+            __atomic_store_n( &ring->busy, 0, __ATOMIC_RELEASE );
+            return 0;
+        }
+
+        count = (u32)( head - tail );
+
+        if( count > maxslots )
+            count = maxslots;
+
+        /* Publish the range before taking it so a producer that sees the
+         * new tail is guaranteed to also see the busy range. */
+        __atomic_store_n( &ring->busy, PWS_RING_BUSY( tail % ring->depth, count ), __ATOMIC_SEQ_CST );
+
+    } while( !__atomic_compare_exchange_n( &ring->tail, &tail, tail + count, false,
+                                           __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) );
+
+    for( i = 0; i < count; i++ )
+        slots[i] = &ring->slots[( tail + i ) % ring->depth];
+
+    return count;
+}
+/* }}} */
+
+/** @description: Hand the claimed slots back to the producer
+ *  @param[in]: ring
+ *  @return: None
+ */
+/* {{{ pws_RingConsumerDone() */
+void pws_RingConsumerDone( struct pws_ring *ring )
+{
+    __atomic_store_n( &ring->busy, 0, __ATOMIC_RELEASE );
+}
+/* }}} */
+
+/** @description: Take the resync request raised when a PWS_OVERFLOW_DROP_GOP
+ *                eviction may have orphaned queued frames. Check it after
+ *                each claim: frames up to the next sync point are to be
+ *                discarded
+ *  @param[in]: ring
+ *  @return: true if the consumer must skip to a sync point
+ */
+/* {{{ pws_RingTakeResync() */
+bool pws_RingTakeResync( struct pws_ring *ring )
+{
+    if( 0 == __atomic_load_n( &ring->resync, __ATOMIC_SEQ_CST ) )
+        return false;
+
+    return ( 0 != __atomic_exchange_n( &ring->resync, 0, __ATOMIC_SEQ_CST ) );
+}
+/* }}} */
+
+/** @description: Number of frames waiting to be read
+ *  @param[in]: ring
+ *  @return: Frame count
+ */
+/* {{{ pws_RingCount() */
+u32 pws_RingCount( struct pws_ring *ring )
+{
+    u64 tail = __atomic_load_n( &ring->tail, __ATOMIC_ACQUIRE );
+    u64 head = __atomic_load_n( &ring->head, __ATOMIC_ACQUIRE );
+
+    return ( head > tail ) ? (u32)( head - tail ) : 0;
+}
+/* }}} */
+
+/** @description: Read the capture timestamp of the oldest queued frame
+ *                without claiming it. Consumer side only
+ *  @param[in]: ring
+ *  @param[out]: pcapture_ts_ns
+ *  @return: false if the ring is empty
+ */
+/* {{{ pws_RingPeekTimestamp() */
+bool pws_RingPeekTimestamp( struct pws_ring *ring, u64 *pcapture_ts_ns )
+{
+    u64 tail = __atomic_load_n( &ring->tail, __ATOMIC_SEQ_CST );
+    u64 head = 0;
+    u64 ts = 0;
+
+    /* The producer moves tail before it rewrites an evicted slot, so a tail
+     * that did not move across the read means the value was not torn */
+    do
+    {
+        head = __atomic_load_n( &ring->head, __ATOMIC_ACQUIRE );
+
+        if( head == tail )
+            return false;
+
+        ts = __atomic_load_n( &ring->slots[tail % ring->depth].meta.capture_ts_ns, __ATOMIC_RELAXED );
+
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+
+    } while( !__atomic_compare_exchange_n( &ring->tail, &tail, tail, false,
+                                           __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) );
+
+    *pcapture_ts_ns = ts;
+
+    return true;
+}
+/* }}} */
+
+/** @description: Total frames dropped by the overflow policy
+ *  @param[in]: ring
+ *  @return: Dropped frame count
+ */
+/* {{{ pws_RingDropped() */
+u64 pws_RingDropped( struct pws_ring *ring )
+{
+    return __atomic_load_n( &ring->dropped_newest, __ATOMIC_RELAXED ) +
+           __atomic_load_n( &ring->dropped_oldest, __ATOMIC_RELAXED );
+}
+/* }}} */
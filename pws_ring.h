@@ -0,0 +1,115 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PWS_RING_H
+#define PWS_RING_H
+
+/***** HEADER FILE *****/
+#include "pwstream.h"
+
+/***** MACROS *****/
+/* pws_RingProducerAcquire outcome flags */
+#define PWS_RING_EVICTED		0x1	// the oldest unread frame was dropped to make room
+#define PWS_RING_GOP_SKIPPED		0x2	// a frame was dropped by PWS_OVERFLOW_DROP_GOP
+#define PWS_RING_GOP_STARTED		0x4	// ... and it cut a GOP short
+#define PWS_RING_NO_MEMORY		0x8	// the slot buffer could not grow to the frame size
+
+/***** Structure Declaration *****/
+
+struct pws_bufmap;
+struct pws_pool;
+
+/* Per-frame metadata computed once on ingest and carried with the frame */
+struct pws_framemeta
+{
+    pws_nalIndex nalindex;
+    u64 capture_ts_ns;
+    u64 receive_ts_ns;
+    u32 tsflags;
+    u32 nplanes;
+    pws_framePlane plane[PWS_MAX_PLANES];
+    u32 nfds;
+    pws_frameFd fd[PWS_MAX_PLANES];
+    u32 nsamples;
+};
+
+/* One frame slot. In copy mode info.frame_ptr points at buffer, a pool
+ * block the slot owns for the lifetime of the ring and only ever grows. In
+ * zero-copy mode info.frame_ptr points into the PipeWire buffer behind
+ * lentbuf, which stays dequeued from PipeWire, or at least mapped if the
+ * stream went away meanwhile, until the consumer releases it. */
+struct pws_ring_slot
+{
+    pws_frameInfo info;
+    struct pws_framemeta meta;
+    u8 *buffer;
+    u32 capacity;
+    struct pws_bufmap *lentbuf;
+};
+
+/* Single-producer/single-consumer frame ring.
+ *
+ * head is only written by the producer. tail is advanced by the consumer when
+ * it claims slots, and by the producer when it evicts the oldest slot under
+ * PWS_OVERFLOW_DROP_OLDEST; both sides move it with CAS so an eviction and a
+ * claim can never hand out the same slot. busy publishes the slot range the
+ * consumer is still copying from so the producer never writes into it.
+ *
+ * Under PWS_OVERFLOW_DROP_GOP a full ring drops the incoming frame when it
+ * depends on earlier ones, and every frame after it up to the next sync
+ * point (gopskip). A sync point is never dropped: it evicts the oldest frame
+ * instead and raises resync, telling the consumer that queued frames up to
+ * the next sync point may have lost their reference. */
+struct pws_ring
+{
+    u32 depth;
+    PWS_OVERFLOW_POLICY enpolicy;
+
+    u64 head;
+    u64 tail;
+    u64 busy;
+
+    u64 dropped_newest;
+    u64 dropped_oldest;
+
+    bool gopskip;			// producer only
+    u32 resync;
+
+    struct pws_ring_slot *slots;
+    struct pws_pool *pool;
+};
+
+/***** Prototype *****/
+struct pws_ring *pws_RingCreate( u32 depth, PWS_OVERFLOW_POLICY enpolicy, struct pws_pool *pool );
+void pws_RingDestroy( struct pws_ring *ring );
+
+struct pws_ring_slot *pws_RingProducerAcquire( struct pws_ring *ring, bool syncpoint, u32 size, u32 *pflags );
+void pws_RingProducerCommit( struct pws_ring *ring );
+int pws_RingReserve( struct pws_ring *ring, struct pws_ring_slot *slot, u32 size );
+int pws_RingPrealloc( struct pws_ring *ring, u32 size );
+
+u32 pws_RingConsumerClaim( struct pws_ring *ring, struct pws_ring_slot **slots, u32 maxslots );
+void pws_RingConsumerDone( struct pws_ring *ring );
+bool pws_RingTakeResync( struct pws_ring *ring );
+
+u32 pws_RingCount( struct pws_ring *ring );
+u64 pws_RingDropped( struct pws_ring *ring );
+bool pws_RingPeekTimestamp( struct pws_ring *ring, u64 *pcapture_ts_ns );
+
+#endif /* PWS_RING_H */
@@ -0,0 +1,73 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PWS_SHM_H
+#define PWS_SHM_H
+
+/* Layout of the shared frame ring exported with streamprop.shmsocket. Shared
+ * by the exporting stream and pws_shmreader, so it only uses fixed width
+ * types and does not depend on PipeWire. */
+
+/***** HEADER FILE *****/
+#include <stdint.h>
+
+/***** MACROS *****/
+#define PWS_SHM_MAGIC			0x48535750	// "PWSH"
+#define PWS_SHM_VERSION			1
+#define PWS_SHM_ALIGN			64		// slots start on a cache line
+
+/* pws_shmslot flags */
+#define PWS_SHM_FLAG_SYNCPOINT		0x1	// IDR, raw or audio frame: decoding can start here
+#define PWS_SHM_FLAG_TS_FROM_PRODUCER	0x2	// capture_ts_ns is the producer's PTS
+
+/***** Structure Declaration *****/
+
+/* At offset 0 of the memfd. Everything but head, oversize and closed is
+ * fixed when the ring is created. */
+struct pws_shmheader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headersize;	// offset of slot 0
+    uint32_t nslots;
+    uint32_t slotstride;	// bytes from one slot to the next
+    uint32_t slotsize;		// largest frame payload a slot holds
+    uint64_t head;		// frames published; frame n lives in slot n % nslots
+    uint64_t oversize;		// frames not exported because they exceed slotsize
+    uint32_t closed;		// set once the exporting stream has closed
+};
+
+/* Slot header, followed by the payload. sequence is a seqlock: 2n+1 while
+ * frame n is written, 2n+2 once it is complete. A reader copies the slot
+ * and keeps the copy only if sequence was 2n+2 before and after. */
+struct pws_shmslot
+{
+    uint64_t sequence;
+    uint64_t capture_ts_ns;
+    uint64_t receive_ts_ns;
+    uint32_t frame_size;
+    uint32_t frame_timestamp;
+    uint32_t pic_type;
+    uint32_t width;
+    uint32_t height;
+    uint16_t stream_type;
+    uint16_t flags;		// PWS_SHM_FLAG_*
+};
+
+#endif /* PWS_SHM_H */
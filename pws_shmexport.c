@@ -0,0 +1,419 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***** HEADER FILE *****/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE		/* memfd_create, F_ADD_SEALS */
+#endif
+#include "pws_shmexport.h"
+#include "pipewire/pipewire.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+/***** MACROS *****/
+#define PWS_SHM_LISTEN_BACKLOG		4
+#define PWS_SHM_ALIGN_UP(x)		( ( (x) + PWS_SHM_ALIGN - 1 ) & ~(size_t)( PWS_SHM_ALIGN - 1 ) )
+
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE		0x0010	/* Linux 5.1 */
+#endif
+
+/***** Function Definition *****/
+
+/** @description: Slot header of slot index
+ *  @param[in]: shm, index
+ *  @return: Slot
+ */
+/* {{{ pws_ShmSlot() */
+static struct pws_shmslot *pws_ShmSlot( struct pws_shmexport *shm, u32 index )
+{
+    return (struct pws_shmslot *)( shm->map + shm->headersize + (size_t)index * shm->slotstride );
+}
+/* }}} */
+
+/** @description: Forget a reader whose connection went away
+ *  @param[in]: client
+ *  @return: None
+ */
+/* {{{ pws_ShmDropClient() */
+static void pws_ShmDropClient( struct pws_shmclient *client )
+{
+    /* The source owns the connection fd */
+    pw_loop_destroy_source( client->shm->loop, client->source );
+    close( client->eventfd );
+
+    client->source = NULL;
+    client->eventfd = -1;
+}
+/* }}} */
+
+/** @description: Connection of a reader hung up or failed
+ *  @param[in]: client, fd, event mask
+ *  @return: None
+ */
+/* {{{ pws_ShmOnClient() */
+static void pws_ShmOnClient( void *data, int fd, uint32_t mask )
+{
+    struct pws_shmclient *client = (struct pws_shmclient *)data;
+    u8 discard[64];
+
+    /* Readers never send anything; reading 0 bytes means they closed */
+    if( ( 0 != ( mask & ( SPA_IO_HUP | SPA_IO_ERR ) ) ) ||
+        ( read( fd, discard, sizeof(discard) ) <= 0 ) )
+        pws_ShmDropClient( client );
+}
+/* }}} */
+
+/** @description: Hand the read-only ring fd and a fresh eventfd to a new
+ *                reader
+ *  @param[in]: shm, connection fd
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_ShmSendFds() */
+static int pws_ShmSendFds( struct pws_shmexport *shm, s32 connfd, s32 eventfd )
+{
+    union
+    {
+        struct cmsghdr align;
+        u8 buf[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    struct msghdr msg;
+    struct cmsghdr *cmsg = NULL;
+    struct iovec iov;
+    u32 version = PWS_SHM_VERSION;
+    int fds[2] = { shm->readfd, eventfd };
+
+    memset( &msg, 0, sizeof(msg) );
+    memset( &control, 0, sizeof(control) );
+
+    iov.iov_base = &version;
+    iov.iov_len = sizeof(version);
+
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    cmsg = CMSG_FIRSTHDR( &msg );
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN( sizeof(fds) );
+    memcpy( CMSG_DATA( cmsg ), fds, sizeof(fds) );
+
+    if( sendmsg( connfd, &msg, MSG_NOSIGNAL ) != (ssize_t)sizeof(version) )
+        return PWS_FAILURE;
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Accept a reader connection
+ *  @param[in]: shm, listening fd, event mask
+ *  @return: None
+ */
+/* {{{ pws_ShmOnConnect() */
+static void pws_ShmOnConnect( void *data, int fd, uint32_t mask )
+{
+    struct pws_shmexport *shm = (struct pws_shmexport *)data;
+    struct pws_shmclient *client = NULL;
+    s32 connfd = -1;
+    u32 i = 0;
+
+    connfd = accept4( fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK );
+
+    if( -1 == connfd )
+        return;
+
+    for( i = 0; ( i < PWS_SHM_MAX_CLIENTS ) && ( NULL == client ); i++ )
+    {
+        if( NULL == shm->clients[i].source )
+            client = &shm->clients[i];
+    }
+
+    /* Full: the reader sees the connection close without any fds */
+    if( NULL == client )
+    {
+        close( connfd );
+        return;
+    }
+
+    client->eventfd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+    if( ( -1 == client->eventfd ) || ( PWS_SUCCESS != pws_ShmSendFds( shm, connfd, client->eventfd ) ) )
+    {
+        if( -1 != client->eventfd )
+            close( client->eventfd );
+
+        client->eventfd = -1;
+        close( connfd );
+        return;
+    }
+
+    client->source = pw_loop_add_io( shm->loop, connfd, SPA_IO_IN | SPA_IO_HUP | SPA_IO_ERR,
+                                     true, pws_ShmOnClient, client );
+
+    if( NULL == client->source )
+    {
+        close( client->eventfd );
+        client->eventfd = -1;
+        close( connfd );
+    }
+}
+/* }}} */
+
+/** @description: Create the memfd ring and the Unix socket readers connect
+ *                to. Must be called with the loop locked or on its thread
+ *  @param[in]: loop - loop that serves the socket and publishes frames
+ *              path - socket path; a stale socket file there is replaced
+ *              nslots, slotsize - ring geometry
+ *  @return: Export handle or NULL
+ */
+/* {{{ pws_ShmExportCreate() */
+struct pws_shmexport *pws_ShmExportCreate( struct pw_loop *loop, const char *path, u32 nslots, u32 slotsize )
+{
+    struct pws_shmexport *shm = NULL;
+    size_t headersize = PWS_SHM_ALIGN_UP( sizeof(struct pws_shmheader) );
+    size_t slotstride = PWS_SHM_ALIGN_UP( sizeof(struct pws_shmslot) + (size_t)slotsize );
+    char procpath[32];
+    u32 i = 0;
+
+    if( ( NULL == loop ) || ( NULL == path ) || ( 0 == nslots ) || ( 0 == slotsize ) ||
+        ( strlen( path ) >= sizeof(shm->addr.sun_path) ) )
+        return NULL;
+
+    shm = (struct pws_shmexport *)calloc( 1, sizeof(struct pws_shmexport) );
+
+    if( NULL == shm )
+        return NULL;
+
+    shm->loop = loop;
+    shm->listenfd = -1;
+    shm->readfd = -1;
+    shm->map = MAP_FAILED;
+    shm->mapsize = headersize + (size_t)nslots * slotstride;
+
+    for( i = 0; i < PWS_SHM_MAX_CLIENTS; i++ )
+    {
+        shm->clients[i].shm = shm;
+        shm->clients[i].eventfd = -1;
+    }
+
+    /* Sealed at its size so a reader can trust the geometry it maps */
+    shm->memfd = memfd_create( "pwstream-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING );
+
+    if( ( -1 == shm->memfd ) ||
+        ( 0 != ftruncate( shm->memfd, (off_t)shm->mapsize ) ) ||
+        ( 0 != fcntl( shm->memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW ) ) )
+    {
+        pws_ShmExportDestroy( shm );
+        return NULL;
+    }
+
+    shm->map = (u8*)mmap( NULL, shm->mapsize, PROT_READ | PROT_WRITE, MAP_SHARED, shm->memfd, 0 );
+
+    if( MAP_FAILED == shm->map )
+    {
+        pws_ShmExportDestroy( shm );
+        return NULL;
+    }
+
+    /* Readers get an fd opened read-only. Where the kernel has it, the
+     * future-write seal also stops them from reopening it writable; the
+     * exporter's own mapping above is not affected */
+    snprintf( procpath, sizeof(procpath), "/proc/self/fd/%d", shm->memfd );
+    shm->readfd = open( procpath, O_RDONLY | O_CLOEXEC );
+
+    if( -1 == shm->readfd )
+    {
+        pws_ShmExportDestroy( shm );
+        return NULL;
+    }
+
+    if( 0 != fcntl( shm->memfd, F_ADD_SEALS, F_SEAL_FUTURE_WRITE | F_SEAL_SEAL ) )
+        fcntl( shm->memfd, F_ADD_SEALS, F_SEAL_SEAL );
+
+    shm->headersize = (u32)headersize;
+    shm->nslots = nslots;
+    shm->slotstride = (u32)slotstride;
+    shm->slotsize = slotsize;
+
+    /* ftruncate zero-filled the slots, so every sequence starts at 0 */
+    shm->header = (struct pws_shmheader *)shm->map;
+    shm->header->magic = PWS_SHM_MAGIC;
+    shm->header->version = PWS_SHM_VERSION;
+    shm->header->headersize = shm->headersize;
+    shm->header->nslots = shm->nslots;
+    shm->header->slotstride = shm->slotstride;
+    shm->header->slotsize = shm->slotsize;
+
+    shm->addr.sun_family = AF_UNIX;
+    strcpy( shm->addr.sun_path, path );
+    unlink( path );
+
+    shm->listenfd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0 );
+
+    /* The mode is set before listen(), so nobody connects under the umask's */
+    if( ( -1 == shm->listenfd ) ||
+        ( 0 != bind( shm->listenfd, (struct sockaddr *)&shm->addr, sizeof(shm->addr) ) ) ||
+        ( 0 != chmod( path, PWS_SHM_SOCKET_MODE ) ) ||
+        ( 0 != listen( shm->listenfd, PWS_SHM_LISTEN_BACKLOG ) ) )
+    {
+        pws_ShmExportDestroy( shm );
+        return NULL;
+    }
+
+    shm->listensource = pw_loop_add_io( loop, shm->listenfd, SPA_IO_IN, false, pws_ShmOnConnect, shm );
+
+    if( NULL == shm->listensource )
+    {
+        pws_ShmExportDestroy( shm );
+        return NULL;
+    }
+
+    return shm;
+}
+/* }}} */
+
+/** @description: Tell connected readers the ring is closed and tear it
+ *                down. Readers keep their mapping until they unmap it. Must
+ *                be called with the loop locked or on its thread
+ *  @param[in]: shm
+ *  @return: None
+ */
+/* {{{ pws_ShmExportDestroy() */
+void pws_ShmExportDestroy( struct pws_shmexport *shm )
+{
+    u64 count = 1;
+    u32 i = 0;
+
+    if( NULL == shm )
+        return;
+
+    if( NULL != shm->header )
+        __atomic_store_n( &shm->header->closed, 1, __ATOMIC_RELEASE );
+
+    for( i = 0; i < PWS_SHM_MAX_CLIENTS; i++ )
+    {
+        if( NULL == shm->clients[i].source )
+            continue;
+
+        write( shm->clients[i].eventfd, &count, sizeof(count) );
+        pws_ShmDropClient( &shm->clients[i] );
+    }
+
+    if( NULL != shm->listensource )
+        pw_loop_destroy_source( shm->loop, shm->listensource );
+
+    if( -1 != shm->listenfd )
+    {
+        close( shm->listenfd );
+        unlink( shm->addr.sun_path );
+    }
+
+    if( MAP_FAILED != shm->map )
+        munmap( shm->map, shm->mapsize );
+
+    if( -1 != shm->readfd )
+        close( shm->readfd );
+
+    if( -1 != shm->memfd )
+        close( shm->memfd );
+
+    free( shm );
+}
+/* }}} */
+
+/** @description: Copy a frame into the next slot and wake every reader.
+ *                Lock-free for readers: a reader racing with the write sees
+ *                the sequence change and drops its copy. Runs on the loop
+ *                thread
+ *  @param[in]: shm, frame info, frame metadata, sync point
+ *  @return: None
+ */
+/* {{{ pws_ShmExportPublish() */
+void pws_ShmExportPublish( struct pws_shmexport *shm, const pws_frameInfo *pstframeinfo,
+                           const struct pws_framemeta *meta, bool syncpoint )
+{
+    struct pws_shmheader *header = shm->header;
+    struct pws_shmslot *slot = NULL;
+    u64 seq = shm->head;
+    u64 count = 1;
+    u8 *dst = NULL;
+    u32 i = 0;
+
+    if( pstframeinfo->frame_size > shm->slotsize )
+    {
+        shm->oversize++;
+        __atomic_store_n( &header->oversize, shm->oversize, __ATOMIC_RELAXED );
+        return;
+    }
+
+    slot = pws_ShmSlot( shm, (u32)( seq % shm->nslots ) );
+    dst = (u8*)( slot + 1 );
+
+    /* Odd while the slot is being rewritten, visible before any payload */
+    __atomic_store_n( &slot->sequence, 2 * seq + 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+
+    /* Raw planes are not contiguous in a lent PipeWire buffer */
+    if( 0 != meta->nplanes )
+    {
+        for( i = 0; i < meta->nplanes; i++ )
+        {
+            memcpy( dst, meta->plane[i].data, meta->plane[i].size );
+            dst += meta->plane[i].size;
+        }
+    }
+    else
+    {
+        memcpy( dst, pstframeinfo->frame_ptr, pstframeinfo->frame_size );
+    }
+
+    slot->capture_ts_ns = meta->capture_ts_ns;
+    slot->receive_ts_ns = meta->receive_ts_ns;
+    slot->frame_size = pstframeinfo->frame_size;
+    slot->frame_timestamp = pstframeinfo->frame_timestamp;
+    slot->pic_type = pstframeinfo->pic_type;
+    slot->width = pstframeinfo->width;
+    slot->height = pstframeinfo->height;
+    slot->stream_type = pstframeinfo->stream_type;
+    slot->flags = ( true == syncpoint ) ? PWS_SHM_FLAG_SYNCPOINT : 0;
+
+    if( 0 != ( meta->tsflags & PWS_FRAME_TS_FROM_PRODUCER ) )
+        slot->flags |= PWS_SHM_FLAG_TS_FROM_PRODUCER;
+
+    shm->head = seq + 1;
+
+    __atomic_store_n( &slot->sequence, 2 * seq + 2, __ATOMIC_RELEASE );
+    __atomic_store_n( &header->head, shm->head, __ATOMIC_RELEASE );
+
+    for( i = 0; i < PWS_SHM_MAX_CLIENTS; i++ )
+    {
+        if( NULL != shm->clients[i].source )
+            write( shm->clients[i].eventfd, &count, sizeof(count) );
+    }
+}
+/* }}} */
@@ -0,0 +1,85 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PWS_SHMEXPORT_H
+#define PWS_SHMEXPORT_H
+
+/***** HEADER FILE *****/
+#include "pwstream.h"
+#include "pws_ring.h"
+#include "pws_shm.h"
+#include <sys/un.h>
+
+/***** MACROS *****/
+#define PWS_SHM_MAX_CLIENTS		8
+#define PWS_SHM_SOCKET_MODE		0660	// owner and group may attach
+
+/***** Structure Declaration *****/
+
+struct pw_loop;
+struct spa_source;
+struct pws_shmexport;
+
+/* One connected reader process */
+struct pws_shmclient
+{
+    struct pws_shmexport *shm;
+    struct spa_source *source;		// HUP watch on the connection
+    s32 eventfd;			// written once per published frame
+};
+
+/* memfd-backed frame ring other processes map read-only.
+ *
+ * Readers connect to a Unix socket and get a read-only fd of the memfd and
+ * an eventfd of their own over SCM_RIGHTS. The memfd is sealed against new
+ * writable mappings, and the exporter never reads the shared header back:
+ * the geometry and head it writes there are kept in its own fields too.
+ * Publishing and every socket event run on the PipeWire loop thread, so the
+ * client table needs no lock. */
+struct pws_shmexport
+{
+    struct pw_loop *loop;
+
+    s32 memfd;
+    s32 readfd;				// O_RDONLY reopen of memfd handed to readers
+    u8 *map;
+    size_t mapsize;
+    struct pws_shmheader *header;	// written only
+
+    u32 headersize;
+    u32 nslots;
+    u32 slotstride;
+    u32 slotsize;
+    u64 head;
+    u64 oversize;
+
+    s32 listenfd;
+    struct spa_source *listensource;
+    struct sockaddr_un addr;
+
+    struct pws_shmclient clients[PWS_SHM_MAX_CLIENTS];
+};
+
+/***** Prototype *****/
+struct pws_shmexport *pws_ShmExportCreate( struct pw_loop *loop, const char *path, u32 nslots, u32 slotsize );
+void pws_ShmExportDestroy( struct pws_shmexport *shm );
+void pws_ShmExportPublish( struct pws_shmexport *shm, const pws_frameInfo *pstframeinfo,
+                           const struct pws_framemeta *meta, bool syncpoint );
+
+#endif /* PWS_SHMEXPORT_H */
@@ -0,0 +1,94 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***** HEADER FILE *****/
+#include "pws_stats.h"
+
+/***** MACROS *****/
+#define PWS_STATS_WORDS		( sizeof(pws_streamStats) / sizeof(u64) )
+
+/***** Function Definition *****/
+
+/** @description: Add to a counter
+ *  @param[in]: counter, value
+ *  @return: None
+ */
+/* {{{ pws_StatsAdd() */
+void pws_StatsAdd( u64 *counter, u64 value )
+{
+    __atomic_fetch_add( counter, value, __ATOMIC_RELAXED );
+}
+/* }}} */
+
+/** @description: Record a duration in a log2 histogram. Bucket i counts
+ *                durations in [2^i, 2^(i+1)) ns, the last bucket everything
+ *                longer
+ *  @param[in]: histogram, duration in ns
+ *  @return: None
+ */
+/* {{{ pws_StatsRecord() */
+void pws_StatsRecord( pws_histogram *hist, u64 ns )
+{
+    u32 bucket = 63 - __builtin_clzll( ns | 1 );
+    u64 max = __atomic_load_n( &hist->max_ns, __ATOMIC_RELAXED );
+
+    if( bucket >= PWS_STATS_HIST_BUCKETS )
+        bucket = PWS_STATS_HIST_BUCKETS - 1;
+
+    __atomic_fetch_add( &hist->bucket[bucket], 1, __ATOMIC_RELAXED );
+    __atomic_fetch_add( &hist->count, 1, __ATOMIC_RELAXED );
+    __atomic_fetch_add( &hist->sum_ns, ns, __ATOMIC_RELAXED );
+
+    while( ( ns > max ) &&
+           !__atomic_compare_exchange_n( &hist->max_ns, &max, ns, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED ) )
+        ;
+}
+/* }}} */
+
+/** @description: Copy the counters out
+ *  @param[in]: live stats
+ *  @param[out]: copy
+ *  @return: None
+ */
+/* {{{ pws_StatsRead() */
+void pws_StatsRead( pws_streamStats *stats, pws_streamStats *out )
+{
+    u64 *src = (u64 *)stats;
+    u64 *dst = (u64 *)out;
+    u32 i = 0;
+
+    for( i = 0; i < PWS_STATS_WORDS; i++ )
+        dst[i] = __atomic_load_n( &src[i], __ATOMIC_RELAXED );
+}
+/* }}} */
+
+/** @description: Zero the counters
+ *  @param[in]: live stats
+ *  @return: None
+ */
+/* {{{ pws_StatsReset() */
+void pws_StatsReset( pws_streamStats *stats )
+{
+    u64 *words = (u64 *)stats;
+    u32 i = 0;
+
+    for( i = 0; i < PWS_STATS_WORDS; i++ )
+        __atomic_store_n( &words[i], 0, __ATOMIC_RELAXED );
+}
+/* }}} */
@@ -0,0 +1,36 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PWS_STATS_H
+#define PWS_STATS_H
+
+/***** HEADER FILE *****/
+#include "pwstream.h"
+
+/***** Prototype *****/
+
+/* Every field of pws_streamStats is a u64 updated with relaxed atomics, so
+ * writers never lock and readers see each counter whole, though not a single
+ * consistent snapshot across counters. */
+void pws_StatsAdd( u64 *counter, u64 value );
+void pws_StatsRecord( pws_histogram *hist, u64 ns );
+void pws_StatsRead( pws_streamStats *stats, pws_streamStats *out );
+void pws_StatsReset( pws_streamStats *stats );
+
+#endif /* PWS_STATS_H */
@@ -0,0 +1,182 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***** HEADER FILE *****/
+#include "pws_triple.h"
+#include "pws_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+/***** MACROS *****/
+#define PWS_TRIPLE_FRESH		0x4
+#define PWS_TRIPLE_INDEX(v)		( (v) & 0x3 )
+
+/***** Function Definition *****/
+
+/** @description: Allocate the three slots with size bytes each
+ *  @param[in]: size - largest frame the handoff carries
+ *              pool - where the slot buffers come from
+ *  @return: Triple buffer handle or NULL
+ */
+/* {{{ pws_TripleCreate() */
+struct pws_triple *pws_TripleCreate( u32 size, struct pws_pool *pool )
+{
+    struct pws_triple *triple = NULL;
+    u32 i = 0;
+
+    if( ( 0 == size ) || ( NULL == pool ) )
+        return NULL;
+
+    triple = (struct pws_triple *)calloc( 1, sizeof(struct pws_triple) );
+
+    if( NULL == triple )
+        return NULL;
+
+    triple->pool = pool;
+
+    for( i = 0; i < PWS_TRIPLE_SLOTS; i++ )
+    {
+        triple->slots[i].buffer = (u8 *)pws_PoolAlloc( pool, size );
+
+        if( NULL == triple->slots[i].buffer )
+        {
+            pws_TripleDestroy( triple );
+            return NULL;
+        }
+
+        triple->slots[i].capacity = pws_PoolCapacity( triple->slots[i].buffer );
+        triple->slots[i].info.frame_ptr = triple->slots[i].buffer;
+    }
+
+    triple->back = 0;
+    triple->middle = 1;
+    triple->front = 2;
+
+    return triple;
+}
+/* }}} */
+
+/** @description: Free the slots
+ *  @param[in]: triple
+ *  @return: None
+ */
+/* {{{ pws_TripleDestroy() */
+void pws_TripleDestroy( struct pws_triple *triple )
+{
+    u32 i = 0;
+
+    if( NULL == triple )
+        return;
+
+    for( i = 0; i < PWS_TRIPLE_SLOTS; i++ )
+        pws_PoolFree( triple->pool, triple->slots[i].buffer );
+
+    free( triple );
+}
+/* }}} */
+
+/** @description: Slot the producer fills next. Its buffer is capacity bytes
+ *                and must not be replaced
+ *  @param[in]: triple
+ *  @return: Slot
+ */
+/* {{{ pws_TripleProducerSlot() */
+struct pws_ring_slot *pws_TripleProducerSlot( struct pws_triple *triple )
+{
+    struct pws_ring_slot *slot = &triple->slots[triple->back];
+
+    slot->info.frame_ptr = slot->buffer;
+
+    return slot;
+}
+/* }}} */
+
+/** @description: Make the producer slot the newest frame
+ *  @param[in]: triple
+ *  @return: true if it replaced a frame the consumer never took
+ */
+/* {{{ pws_TriplePublish() */
+bool pws_TriplePublish( struct pws_triple *triple )
+{
+    u32 previous = 0;
+
+    triple->sequence[triple->back] = ++triple->published;
+
+    previous = __atomic_exchange_n( &triple->middle, triple->back | PWS_TRIPLE_FRESH, __ATOMIC_ACQ_REL );
+
+    triple->back = PWS_TRIPLE_INDEX( previous );
+
+    if( 0 == ( previous & PWS_TRIPLE_FRESH ) )
+        return false;
+
+    __atomic_fetch_add( &triple->overwritten, 1, __ATOMIC_RELAXED );
+
+    return true;
+}
+/* }}} */
+
+/** @description: Take the newest frame if there is one the consumer has not
+ *                seen. The slot stays the consumer's until the next take
+ *  @param[in]: triple
+ *  @param[out]: pmissed - frames published since the last take and never
+ *               taken
+ *  @return: Slot, or NULL if no new frame was published
+ */
+/* {{{ pws_TripleTake() */
+struct pws_ring_slot *pws_TripleTake( struct pws_triple *triple, u64 *pmissed )
+{
+    u32 previous = 0;
+
+    *pmissed = 0;
+
+    if( 0 == ( __atomic_load_n( &triple->middle, __ATOMIC_ACQUIRE ) & PWS_TRIPLE_FRESH ) )
+        return NULL;
+
+    previous = __atomic_exchange_n( &triple->middle, triple->front, __ATOMIC_ACQ_REL );
+
+    triple->front = PWS_TRIPLE_INDEX( previous );
+
+    *pmissed = triple->sequence[triple->front] - triple->taken - 1;
+    triple->taken = triple->sequence[triple->front];
+
+    return &triple->slots[triple->front];
+}
+/* }}} */
+
+/** @description: Whether a frame is waiting to be taken
+ *  @param[in]: triple
+ *  @return: true if pws_TripleTake would return a frame
+ */
+/* {{{ pws_TripleHasFresh() */
+bool pws_TripleHasFresh( struct pws_triple *triple )
+{
+    return ( 0 != ( __atomic_load_n( &triple->middle, __ATOMIC_ACQUIRE ) & PWS_TRIPLE_FRESH ) );
+}
+/* }}} */
+
+/** @description: Frames replaced before the consumer took them
+ *  @param[in]: triple
+ *  @return: Frame count
+ */
+/* {{{ pws_TripleOverwritten() */
+u64 pws_TripleOverwritten( struct pws_triple *triple )
+{
+    return __atomic_load_n( &triple->overwritten, __ATOMIC_RELAXED );
+}
+/* }}} */
@@ -0,0 +1,69 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PWS_TRIPLE_H
+#define PWS_TRIPLE_H
+
+/***** HEADER FILE *****/
+#include "pwstream.h"
+#include "pws_ring.h"
+
+/***** MACROS *****/
+#define PWS_TRIPLE_SLOTS		3
+
+/***** Structure Declaration *****/
+
+struct pws_pool;
+
+/* Wait-free latest-frame handoff.
+ *
+ * Three slots, each owned by exactly one role at a time: the producer writes
+ * back, the consumer reads front, and middle holds the newest finished frame.
+ * Publishing swaps back with middle and marks it fresh; taking swaps front
+ * with middle if it is fresh. Each side is one atomic exchange, so neither
+ * ever waits for the other, and a frame the consumer is still copying is
+ * never written. Frames the consumer did not take in time are replaced.
+ * Slot buffers are allocated once and never grow; ingest drops a frame that
+ * does not fit. */
+struct pws_triple
+{
+    struct pws_ring_slot slots[PWS_TRIPLE_SLOTS];
+    u64 sequence[PWS_TRIPLE_SLOTS];	// publish count of the frame in each slot
+    struct pws_pool *pool;
+
+    u32 back;				// producer only
+    u64 published;			// producer only
+    u32 middle;				// slot index | PWS_TRIPLE_FRESH, exchanged by both
+    u32 front;				// consumer only
+    u64 taken;				// consumer only, sequence of the last frame taken
+
+    u64 overwritten;
+};
+
+/***** Prototype *****/
+struct pws_triple *pws_TripleCreate( u32 size, struct pws_pool *pool );
+void pws_TripleDestroy( struct pws_triple *triple );
+
+struct pws_ring_slot *pws_TripleProducerSlot( struct pws_triple *triple );
+bool pws_TriplePublish( struct pws_triple *triple );
+struct pws_ring_slot *pws_TripleTake( struct pws_triple *triple, u64 *pmissed );
+bool pws_TripleHasFresh( struct pws_triple *triple );
+u64 pws_TripleOverwritten( struct pws_triple *triple );
+
+#endif /* PWS_TRIPLE_H */
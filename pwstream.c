@@ -18,26 +18,178 @@
  */
 
 /***** HEADER FILE *****/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE		/* pthread_setaffinity_np */
+#endif
 #include "pwstream.h"
+#include "pws_ring.h"
+#include "pws_h264.h"
+#include "pws_history.h"
+#include "pws_stats.h"
+#include "pws_pool.h"
+#include "pws_fanout.h"
+#include "pws_shmexport.h"
+#include "pws_dispatch.h"
+#include "pws_triple.h"
+#include "pws_recorder.h"
 #include "pipewire/pipewire.h"
 #include <pthread.h>
-#include <fcntl.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <linux/dma-buf.h>
+#include <sched.h>
+
+/***** MACROS *****/
+#define PWS_MAX_STREAM_BUFFERS		64
+#define PWS_PARAM_SET_PREFIX_LEN	4
+#define PWS_BUFFER_DATA_TYPES		( (1<<SPA_DATA_MemPtr) | (1<<SPA_DATA_MemFd) | (1<<SPA_DATA_DmaBuf) )
+#define PWS_POOL_KEYFRAME_FACTOR	4	// IDR size over the average frame size at a given bitrate
+#define PWS_POOL_SPARE_BLOCKS		2	// free blocks per class beyond the ring depth
+#define PWS_AUDIO_FRAMES_PER_SEC	10	// PCM buffers are assumed no longer than 100 ms
+#define PWS_AAC_MAX_CHANNEL_BYTES	768	// 6144 bits per channel per AAC frame
+#define PWS_ADTS_HEADER_SIZE		9
+#define PWS_MAX_FRAMERATE		1000
+#define PWS_SHM_SLOT_HEADROOM		2	// exported H.264 slot size over the keyframe estimate
+#define PWS_LATEST_SLOT_HEADROOM	2	// latest-frame H.264 slot size over the keyframe estimate
+#define PWS_MAX_AFFINITY_CPUS		64
+#define PWS_RECONNECT_MIN_MS		50	// first retry after the daemon or a stream was lost
+#define PWS_RECONNECT_MAX_MS		1000	// retries back off up to this interval
+
+/* Built with PWS_RT_DEBUG, the process callback reports entry and exit to
+ * an interposer such as bench/pws_rtcheck.c, which flags every blocking or
+ * allocating call made in between. The hooks are weak: without the
+ * interposer loaded they are NULL and nothing is called. */
+#ifdef PWS_RT_DEBUG
+extern void pws_RtCheckEnter( void ) __attribute__((weak));
+extern void pws_RtCheckLeave( void ) __attribute__((weak));
+#define PWS_RT_ENTER()			do { if( pws_RtCheckEnter ) pws_RtCheckEnter(); } while( 0 )
+#define PWS_RT_LEAVE()			do { if( pws_RtCheckLeave ) pws_RtCheckLeave(); } while( 0 )
+#else
+#define PWS_RT_ENTER()			do { } while( 0 )
+#define PWS_RT_LEAVE()			do { } while( 0 )
+#endif
 
 /*RDK Logging */
 #include "rdk_debug.h"
 
+/***** Structure Declaration *****/
+
+/* PipeWire loop, context and core connection shared by every stream opened
+ * in this process. While the daemon is away core is NULL and the retry
+ * timer keeps trying to connect */
+struct pws_core
+{
+    u32 refcount;
+    struct pw_thread_loop *loop;
+    struct pw_context *context;
+    struct pw_core *core;
+    struct spa_hook core_listener;
+    bool corelost;			// connection broken, dropped by the retry timer
+    struct spa_source *retrytimer;
+    u32 retry_ms;			// next retry interval
+    struct spa_list streams;		// pws_data of every open stream
+};
+
+/* Mappings made for an fd-backed PipeWire buffer, kept in pw_buffer->user_data
+ * from add_buffer to remove_buffer so a buffer is mapped only once. A buffer
+ * that is lent out when PipeWire removes it keeps its mappings until the
+ * consumer gives it back */
+struct pws_bufmap
+{
+    void *base[PWS_MAX_PLANES];
+    size_t length[PWS_MAX_PLANES];
+    struct pw_buffer *pwbuf;		// NULL once PipeWire removed the buffer
+    bool lent;				// in a ring slot or held by the consumer
+};
+
+/* Frame handed to the consumer: lent by pws_AcquireFrame, or the last
+ * frame copied out by pws_ReadFrame (lentbuf is NULL) */
+struct pws_heldframe
+{
+    struct pws_bufmap *lentbuf;
+    u8 *frame_ptr;
+    struct pws_framemeta meta;
+};
+
 /***** Global Variable Declaration *****/
 
-pthread_t pws_getFrame;
-pthread_mutex_t pws_videoframelock;
+static struct pws_core pws_sharedcore;
+static pthread_mutex_t pws_corelock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t pws_initonce = PTHREAD_ONCE_INIT;
 
 /***** Prototype *****/
 static int pws_FormatConversion( PWS_FORMAT enpwsformat, int formatval);
 static void pws_Load_DefaultStreamProp( struct pws_data *pwsdata);
-static int pws_StartStream( void *vptr );
+static void pws_ProcessInit( void );
+static void pws_FreeStreamData( struct pws_data *pwsdata );
+static int pws_CoreAcquire( void );
+static void pws_CoreRelease( void );
+static void pws_CoreConnect( void );
+static void pws_OnCoreError( void *data, uint32_t id, int seq, int res, const char *message );
+static void pws_ArmRetry( u32 delay_ms );
+static void pws_OnRetryTimer( void *data, uint64_t expirations );
+static int pws_StartStream( struct pws_data *pwsdata );
+static int pws_ConnectStream( struct pws_data *pwsdata );
+static void pws_DestroyStream( struct pws_data *pwsdata );
+static void pws_LoseStream( struct pws_data *pwsdata );
+static void pws_SetState( struct pws_data *pwsdata, u32 state );
+static void pws_StartupMark( struct pws_data *pwsdata, u64 *pmark );
+static void pws_FirstFrame( struct pws_data *pwsdata, u64 receive_ts_ns );
+static void pws_OnStateChanged( void *userdata, enum pw_stream_state old, enum pw_stream_state state, const char *error );
+static void pws_ApplyThreadPolicy( struct pws_data *pwsdata );
+static u32 pws_BuildFormats( struct pws_data *pwsdata, struct spa_pod_builder *b, const struct spa_pod **params );
+static const struct spa_pod *pws_BuildVideoFormat( struct spa_pod_builder *b, const pws_formatPref *pref, u32 maxframerate );
+static void pws_ApplyNegotiatedFormat( struct pws_data *pwsdata );
 static void pws_OnParamChanged(void *userdata, uint32_t id, const struct spa_pod *param);
+static u64 pws_MonotonicNs( void );
+static void pws_OnAddBuffer(void *userdata, struct pw_buffer *pwbuf);
+static void pws_OnRemoveBuffer(void *userdata, struct pw_buffer *pwbuf);
+static void pws_DmaBufSync( struct spa_buffer *buf, u64 flags );
+static u32 pws_GetFrameFds( struct spa_buffer *buf, pws_frameFd *fds );
 static void pws_OnProcess(void *userdata);
-static u32 pws_GetH264PictureType( u8 *Framedata );
+static void pws_ProcessBuffer( struct pws_data *pwsdata, u64 receive_ts_ns );
+static bool pws_IsSupportedFormat( const struct spa_video_info *format );
+static bool pws_PassDecimation( struct pws_data *pwsdata, struct spa_buffer *buf, const u8 *data, u32 size,
+                                bool standalone, u64 receive_ts_ns );
+static u32 pws_GetAudioSamples( struct pws_data *pwsdata, u32 size );
+static u32 pws_GetRawPlanes( struct pws_data *pwsdata, struct spa_buffer *buf, pws_framePlane *planes );
+static u32 pws_GatherPlanes( const pws_framePlane *src, u32 nplanes, u8 *dst, pws_framePlane *out );
+static void pws_DescribeFrame( struct pws_data *pwsdata, struct spa_buffer *buf, bool audio, u64 receive_ts_ns,
+                               pws_frameInfo *pstframeinfo, struct pws_framemeta *meta );
+static void pws_PublishFrame( struct pws_data *pwsdata, struct pw_buffer *b, const u8 *data, u32 size,
+                              const pws_framePlane *planes, u32 nplanes, bool audio, u64 receive_ts_ns );
+static void pws_CallbackFrame( struct pws_data *pwsdata, struct pw_buffer *b, u8 *data, u32 size,
+                               const pws_framePlane *planes, u32 nplanes, bool audio, u64 receive_ts_ns );
+static void pws_FillFrameInfoExt( struct pws_data *pwsdata, const struct pws_framemeta *meta, pws_frameInfoExt *pstframeinfoext );
+static void pws_LatestFrame( struct pws_data *pwsdata, struct pw_buffer *b, const u8 *data, u32 size,
+                             const pws_framePlane *planes, u32 nplanes, bool audio, u64 receive_ts_ns );
+static bool pws_FramesPending( struct pws_data *pwsdata );
+static int pws_CopyLatest( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo );
+static bool pws_IsSyncPoint( const pws_frameInfo *pstframeinfo, const struct pws_framemeta *meta );
+static void pws_CountDelivery( struct pws_data *pwsdata, const struct pws_framemeta *meta, u32 copied );
+static void pws_UnmapBuffer( struct pws_bufmap *map );
+static void pws_RequeueBuffer( struct pws_data *pwsdata, struct pws_bufmap *map );
+static void pws_ReturnBuffer( struct pws_data *pwsdata, struct pws_bufmap *map );
+static void pws_FreeLentBuffers( struct pws_data *pwsdata );
+static struct timespec *pws_MakeDeadline( u64 timeout_ns, struct timespec *deadline );
+static struct pws_heldframe *pws_FindFrame( struct pws_data *pwsdata, const u8 *frame_ptr );
+static const struct pws_framemeta *pws_FindFrameMeta( struct pws_data *pwsdata, const u8 *frame_ptr );
+static void pws_SignalNotify( struct pws_data *pwsdata );
+static void pws_WakeReaders( struct pws_data *pwsdata );
+static void pws_ConsumeNotify( struct pws_data *pwsdata, u32 nframes );
+static void pws_CheckResync( struct pws_data *pwsdata );
+static bool pws_ClaimFrame( struct pws_data *pwsdata, struct pws_ring_slot **pslot, bool *psyncframe );
+static u32 pws_GetKeyframePrefix( struct pws_data *pwsdata, pws_paramSets *pstparamsets, pws_nalIndex *pstnalindex );
+static void pws_CopyKeyframePrefix( const pws_paramSets *pstparamsets, u8 *dst );
+static u32 pws_EstimateFrameSize( struct pws_data *pwsdata );
+static int pws_ReserveFrameBuffer( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo, u32 size );
 
 /***** Function Definition *****/
 
@@ -64,525 +216,3928 @@ static int pws_FormatConversion( PWS_FORMAT enpwsformat, int formatval)
 
 	if( PWS_MEDIA_SUBTYPE_FORMAT_H264 == formatval )
 	    return SPA_MEDIA_SUBTYPE_h264;
+
+	if( PWS_MEDIA_SUBTYPE_FORMAT_AAC == formatval )
+	    return SPA_MEDIA_SUBTYPE_aac;
     }
 
     if( PWS_FORMAT_VIDEO == enpwsformat   )
     {
         if( PWS_VIDEO_FORMAT_ENCODED == formatval )
 	    return SPA_VIDEO_FORMAT_ENCODED;
+
+        if( PWS_VIDEO_FORMAT_I420 == formatval )
+	    return SPA_VIDEO_FORMAT_I420;
+
+        if( PWS_VIDEO_FORMAT_NV12 == formatval )
+	    return SPA_VIDEO_FORMAT_NV12;
+    }
+
+    if( PWS_FORMAT_AUDIO == enpwsformat )
+    {
+        if( PWS_AUDIO_FORMAT_S16 == formatval )
+	    return SPA_AUDIO_FORMAT_S16;
+
+        if( PWS_AUDIO_FORMAT_S32 == formatval )
+	    return SPA_AUDIO_FORMAT_S32;
+
+        if( PWS_AUDIO_FORMAT_F32 == formatval )
+	    return SPA_AUDIO_FORMAT_F32;
     }
 
     return PWS_FAILURE;
 }
 /* }}} */
 
-/** @description: Inilializing logs,video properties and memory allocation
+/** @description: Inilializing logs,video properties and memory allocation.
+ *                Returns as soon as the stream is created, without waiting
+ *                for the daemon or a producer; see pws_WaitReady
  *  @param[in]: pwsdata
  *  @return: File Descriptor
  */
 /* {{{ pws_StreamInit() */
 int pws_StreamInit(struct pws_data *pwsdata)
 {
-    int ret = 0;
+    /* Startup times count from here, process setup included */
+    u64 init_ns = pws_MonotonicNs();
 
-    /* RDK logger initialization */
-    rdk_logger_init("/etc/debug.ini");
+    /* RDK logger and PipeWire initialization */
+    pthread_once(&pws_initonce, pws_ProcessInit);
 
     if(NULL == pwsdata )
         return PWS_FAILURE;
 
-    pwsdata->isH264FrameReady = false;
+    pws_Load_DefaultStreamProp(pwsdata);
+
+    /* Nothing to close yet if init fails early */
+    pwsdata->notifyfd = -1;
 
-    if( NULL == pwsdata->intermediateFrameInfoH264)
+    if( NULL == pwsdata->stats )
     {
-        pwsdata->intermediateFrameInfoH264 = (pws_frameInfo*)malloc(sizeof(pws_frameInfo));
+        pwsdata->stats = (pws_streamStats *)calloc( 1, sizeof(pws_streamStats) );
 
-	if( NULL == pwsdata->intermediateFrameInfoH264 )
+	if( NULL == pwsdata->stats )
 	{
 	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
-	    return PWS_FAILURE;
+	    goto fail;
 	}
-	else
+    }
+
+    if( NULL == pwsdata->pool )
+    {
+        /* Reader handles keep a window of readerlag frames instead */
+        pwsdata->pool = pws_PoolCreate( SPA_MAX( pwsdata->streamprop.ringdepth, pwsdata->streamprop.readerlag ) +
+                                        PWS_POOL_SPARE_BLOCKS );
+
+	if( NULL == pwsdata->pool )
 	{
-	    memset(pwsdata->intermediateFrameInfoH264,0,sizeof(pws_frameInfo));
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+	    goto fail;
 	}
+    }
 
-	pwsdata->intermediateFrameInfoH264->frame_ptr = (u8*)malloc(sizeof(u8)*FRAME_SIZE);
+    if( NULL == pwsdata->framering )
+    {
+        pwsdata->framering = pws_RingCreate( pwsdata->streamprop.ringdepth,
+                                             pwsdata->streamprop.enoverflowpolicy,
+                                             pwsdata->pool );
 
-        if( NULL == pwsdata->intermediateFrameInfoH264->frame_ptr )
-        {
-            RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
-            return PWS_FAILURE;
-        }
-        else
-        {
-            memset(pwsdata->intermediateFrameInfoH264->frame_ptr,0,(sizeof(u8)*FRAME_SIZE));
-        }
+	if( NULL == pwsdata->framering )
+	{
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+	    goto fail;
+	}
+
+        /* Copy mode slots start at the expected frame size so ingest does
+         * not allocate; zero-copy slots never hold frame data, and with
+         * reader handles frames go to the fanout instead */
+        if( ( false == pwsdata->streamprop.zerocopy ) && ( 0 == pwsdata->streamprop.maxreaders ) &&
+            ( false == pwsdata->streamprop.latestframe ) &&
+            ( PWS_SUCCESS != pws_RingPrealloc( pwsdata->framering, pws_EstimateFrameSize( pwsdata ) ) ) )
+	{
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+	    goto fail;
+	}
     }
 
-    pws_Load_DefaultStreamProp(pwsdata);
+    if( ( 0 != pwsdata->streamprop.maxreaders ) && ( NULL == pwsdata->fanout ) )
+    {
+        pwsdata->fanout = pws_FanoutCreate( pwsdata->streamprop.readerlag,
+                                            pwsdata->streamprop.maxreaders,
+                                            pwsdata->pool );
 
-    memset (pwsdata->pws_fd, -1, 2 *sizeof(s32));
+	if( ( NULL == pwsdata->fanout ) ||
+            ( PWS_SUCCESS != pws_FanoutPrealloc( pwsdata->fanout, pws_EstimateFrameSize( pwsdata ) ) ) )
+	{
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+	    goto fail;
+	}
+    }
 
-    //create pipe and return its one end point(read fd)
-    if( -1 != pipe(pwsdata->pws_fd) )
+    if( ( true == pwsdata->streamprop.latestframe ) && ( NULL == pwsdata->latest ) )
     {
-        if (fcntl(pwsdata->pws_fd[0], F_SETFL, O_NONBLOCK) < 0) {
-            RDK_LOG(RDK_LOG_WARN,"LOG.RDK.PWSTREAM","%s(%d) : Error in setting the read end of PIPE(%d<------%d) to non blocking mode\n", __FILE__, __LINE__, pwsdata->pws_fd[0], pwsdata->pws_fd[1]);
-        }
-        else {
-            RDK_LOG(RDK_LOG_INFO,"LOG.RDK.PWSTREAM","%s(%d) : Set the read end of PIPE(%d<------%d) to non blocking mode\n", __FILE__, __LINE__, pwsdata->pws_fd[0], pwsdata->pws_fd[1]);
-        }
+        pwsdata->latest = pws_TripleCreate( pwsdata->streamprop.latestframesize, pwsdata->pool );
 
-        if (fcntl(pwsdata->pws_fd[1], F_SETFL, O_NONBLOCK) < 0) {
-            RDK_LOG(RDK_LOG_WARN,"LOG.RDK.PWSTREAM","%s(%d) : Error in setting the write end of PIPE(%d<------%d) to non blocking mode\n", __FILE__, __LINE__, pwsdata->pws_fd[0], pwsdata->pws_fd[1]);
-        }
-        else {
-            RDK_LOG(RDK_LOG_INFO,"LOG.RDK.PWSTREAM","%s(%d) : Set the write end of PIPE(%d<------%d) to non blocking mode\n", __FILE__, __LINE__, pwsdata->pws_fd[0], pwsdata->pws_fd[1]);
-        }
+	if( NULL == pwsdata->latest )
+	{
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+	    goto fail;
+	}
     }
 
-    if(pthread_mutex_init(&pws_videoframelock, NULL) != 0)
+    if( NULL == pwsdata->lastframe )
     {
-	RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : FrameLock Mutex Init Failed \n",__FILE__, __LINE__);
-        return PWS_FAILURE;
+        pwsdata->lastframe = (struct pws_heldframe *)calloc( 1, sizeof(struct pws_heldframe) );
+
+	if( NULL == pwsdata->lastframe )
+	{
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+	    goto fail;
+	}
     }
 
-    ret = pthread_create( &pws_getFrame, NULL, pws_StartStream, (void*)pwsdata );
+    if( NULL == pwsdata->batchslots )
+    {
+        pwsdata->batchslots = (struct pws_ring_slot **)calloc( pwsdata->framering->depth,
+                                                               sizeof(struct pws_ring_slot *) );
+
+	if( NULL == pwsdata->batchslots )
+	{
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+	    goto fail;
+	}
+    }
 
-    if(ret != 0)
+    pwsdata->borrowedcount = 0;
+
+    if( NULL == pwsdata->paramcache )
     {
-	RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to create start_Streaming thread \n",__FILE__, __LINE__);
+        pwsdata->paramcache = (struct pws_paramcache *)calloc( 1, sizeof(struct pws_paramcache) );
+
+	if( NULL == pwsdata->paramcache )
+	{
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+	    goto fail;
+	}
     }
-    
-    return pwsdata->pws_fd[0];
 
-}
-/* }}} */
+    pwsdata->keyframepending = pwsdata->streamprop.keyframestart;
 
-/** @description: Update video/Audio properties in streamprop structure
- *  @param[in]: pwsdata
- *  @return: None
- */
-/* {{{ pws_Load_DefaultStreamProp() */
-static void pws_Load_DefaultStreamProp( struct pws_data *pwsdata)
-{
-    if( NULL == pwsdata )
-        return;
+    if( ( 0 != pwsdata->streamprop.historybytes ) && ( NULL == pwsdata->history ) )
+    {
+        pwsdata->history = pws_HistoryCreate( pwsdata->streamprop.historybytes,
+                                              pwsdata->streamprop.historyframes );
 
-    if( NULL == pwsdata->streamprop.stream_name )
-        pwsdata->streamprop.stream_name = PWS_DEF_STREAM_NAME;
+	if( NULL == pwsdata->history )
+	{
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+	    goto fail;
+	}
+    }
 
-    if( NULL == pwsdata->streamprop.mediatype )
-        pwsdata->streamprop.mediatype = PWS_DEF_MEDIA_TYPE;
+    if( ( true == pwsdata->streamprop.zerocopy ) && ( NULL == pwsdata->heldframes ) )
+    {
+        pwsdata->heldframes = (struct pws_heldframe *)calloc( pwsdata->streamprop.maxheldbuffers,
+                                                              sizeof(struct pws_heldframe) );
 
-    if( NULL == pwsdata->streamprop.mediacategory )
-        pwsdata->streamprop.mediacategory = PWS_DEF_MEDIA_CATEGORY;
+	if( NULL == pwsdata->heldframes )
+	{
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+	    goto fail;
+	}
 
-    if( NULL == pwsdata->streamprop.mediarole )
-        pwsdata->streamprop.mediarole = PWS_DEF_MEDIA_ROLE;
+        pwsdata->heldcount = 0;
+    }
 
-    if((PWS_MEDIA_TYPE_FORMAT_START >= pwsdata->streamprop.enMtypeformat) || \
-		(pwsdata->streamprop.enMtypeformat >= PWS_MEDIA_TYPE_FORMAT_END))
+    /* Level mode counts ready frames; edge mode is only written on the
+     * empty to non-empty transition, see pws_SignalNotify() */
+    pwsdata->notifysignaled = 0;
+    pwsdata->notifyfd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+    if( -1 == pwsdata->notifyfd )
     {
-        pwsdata->streamprop.enMtypeformat = PWS_DEF_MEDIA_TYPE_FORMAT;
-        pwsdata->streamprop.enMtypeformat = pws_FormatConversion(PWS_FORMAT_MEDIA_TYPE,
-		    					     pwsdata->streamprop.enMtypeformat);
+	RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to create eventfd \n",__FILE__, __LINE__);
+        goto fail;
     }
 
-    if( ( PWS_MEDIA_SUBTYPE_FORMAT_START >= pwsdata->streamprop.enMsubtypeformat ) || \
-		(pwsdata->streamprop.enMsubtypeformat >= PWS_MEDIA_SUBTYPE_FORMAT_END ) )
+    pwsdata->init_ns = init_ns;
+    memset( &pwsdata->startup, 0, sizeof(pwsdata->startup) );
+    pwsdata->lastreceive_ns = 0;
+    pwsdata->gapstart_ns = 0;
+    pwsdata->streamlost = false;
+    pws_SetState( pwsdata, PWS_STREAM_CONNECTING );
+
+    if( PWS_SUCCESS != pws_CoreAcquire() )
     {
-        pwsdata->streamprop.enMsubtypeformat = PWS_DEF_MEDIA_SUBTYPE_FORMAT;
-        pwsdata->streamprop.enMsubtypeformat = pws_FormatConversion(PWS_FORMAT_MEDIA_SUBTYPE,
-                                                             pwsdata->streamprop.enMsubtypeformat);
+	RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to set up PipeWire \n",__FILE__, __LINE__);
+        goto fail;
     }
 
-    if( ( PWS_VIDEO_FORMAT_START >= pwsdata->streamprop.envideoformat ) || \
-		( pwsdata->streamprop.envideoformat >= PWS_VIDEO_FORMAT_END ) )
+    if( PWS_SUCCESS != pws_StartStream( pwsdata ) )
     {
-        pwsdata->streamprop.envideoformat = PWS_DEF_VIDEO_FORMAT;
-        pwsdata->streamprop.envideoformat = pws_FormatConversion(PWS_FORMAT_VIDEO,
-                                                             pwsdata->streamprop.envideoformat);
+	RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to start stream %s \n",__FILE__, __LINE__, pwsdata->streamprop.stream_name);
+        pwsdata->loop = NULL;
+        pws_CoreRelease();
+        goto fail;
     }
 
-    if( 0 == pwsdata->streamprop.width )
-        pwsdata->streamprop.width = PWS_DEF_FRAME_WIDTH;
+    pws_ApplyThreadPolicy( pwsdata );
 
-    if( 0 == pwsdata->streamprop.height )
-        pwsdata->streamprop.height = PWS_DEF_FRAME_HEIGHT;
+    return pwsdata->notifyfd;
 
-    if( 0 == pwsdata->streamprop.framerate )
-        pwsdata->streamprop.framerate = PWS_DEF_FRAMERATE;
+fail:
+    /* pws_StreamClose is never called for a stream whose init failed */
+    pws_SetState( pwsdata, PWS_STREAM_CLOSED );
+    pws_FreeStreamData( pwsdata );
 
+    return PWS_FAILURE;
 }
 /* }}} */
 
-static const struct pw_stream_events pws_stream_events = {
-        PW_VERSION_STREAM_EVENTS,
-        .param_changed = pws_OnParamChanged,
-        .process = pws_OnProcess,
-};
-
-/** @description: Start the read of video buffer with pipewire callback
+/** @description: Free everything pws_StreamInit allocated for a stream
+ *                and close its notification fd. The PipeWire side must be
+ *                gone already
  *  @param[in]: pwsdata
- *  @return: Macro- Success/Failure
+ *  @return: None
  */
-/* {{{ pws_StartStream() */
-static int pws_StartStream( void *vptr )
+/* {{{ pws_FreeStreamData() */
+static void pws_FreeStreamData( struct pws_data *pwsdata )
 {
-    const struct spa_pod *params[1];
-    uint8_t buffer[1024];
-    struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+    /* Closes any reader handle still open; its frames go back to the pool */
+    pws_FanoutDestroy( pwsdata->fanout );
+    pwsdata->fanout = NULL;
 
-    struct pws_data *pwsdata = (struct pws_data *)vptr;
+    pws_TripleDestroy( pwsdata->latest );
+    pwsdata->latest = NULL;
 
-    if( NULL == pwsdata )
-        return PWS_FAILURE;
-
-    printf(" mtype<%s> mcategory<%s> mediarole<%s> Mtypeformat<%d> MsubtypeFMT<%d> Videoformat<%d> Width<%d> height<%d> framerate<%d>",
-                    pwsdata->streamprop.mediatype,
-                    pwsdata->streamprop.mediacategory,
-                    pwsdata->streamprop.mediarole,
-                    pwsdata->streamprop.enMtypeformat,
-                    pwsdata->streamprop.enMsubtypeformat,
-                    pwsdata->streamprop.envideoformat,
-                    pwsdata->streamprop.width,
-                    pwsdata->streamprop.height,
-                    pwsdata->streamprop.framerate );
+    pws_RingDestroy( pwsdata->framering );
+    pwsdata->framering = NULL;
 
-    pw_init(NULL, NULL);
+    free( pwsdata->lastframe );
+    pwsdata->lastframe = NULL;
 
-    pwsdata->loop = pw_main_loop_new(NULL);
+    free( pwsdata->paramcache );
+    pwsdata->paramcache = NULL;
 
-    pwsdata->stream = pw_stream_new_simple(
-                          pw_main_loop_get_loop(pwsdata->loop),
-                          pwsdata->streamprop.stream_name,
-                          pw_properties_new(
-                              PW_KEY_MEDIA_TYPE, pwsdata->streamprop.mediatype,
-                              PW_KEY_MEDIA_CATEGORY, pwsdata->streamprop.mediacategory,
-                              PW_KEY_MEDIA_ROLE, pwsdata->streamprop.mediarole,
-                              NULL),
-                          &pws_stream_events,
-                          pwsdata);
+    free( pwsdata->batchslots );
+    pwsdata->batchslots = NULL;
+    pwsdata->borrowedcount = 0;
 
-    params[0] = spa_pod_builder_add_object(&b,
-                    SPA_TYPE_OBJECT_Format,   SPA_PARAM_EnumFormat,
-                    SPA_FORMAT_mediaType,     SPA_POD_Id(pwsdata->streamprop.enMtypeformat),
-                    SPA_FORMAT_mediaSubtype,  SPA_POD_Id(pwsdata->streamprop.enMsubtypeformat),
-                    SPA_FORMAT_VIDEO_format,  SPA_POD_Id(pwsdata->streamprop.envideoformat),
-                    SPA_FORMAT_VIDEO_size,    SPA_POD_Rectangle(
-			                          &SPA_RECTANGLE(
-					              pwsdata->streamprop.width, 
-						      pwsdata->streamprop.height)),
-		    SPA_FORMAT_VIDEO_framerate, SPA_POD_CHOICE_RANGE_Fraction(
-                                                              &SPA_FRACTION(25, 1),
-                                                              &SPA_FRACTION(0, 1),
-                                                              &SPA_FRACTION(1000, 1)));
+    free( pwsdata->stats );
+    pwsdata->stats = NULL;
 
+    pws_HistoryDestroy( pwsdata->history );
+    pwsdata->history = NULL;
 
-    pw_stream_connect(pwsdata->stream,
-                      PW_DIRECTION_INPUT,
-                      PW_ID_ANY,
-                      PW_STREAM_FLAG_AUTOCONNECT |
-                      PW_STREAM_FLAG_MAP_BUFFERS,
-                      params, 1);
+    free( pwsdata->heldframes );
+    pwsdata->heldframes = NULL;
+    pwsdata->heldcount = 0;
 
-    pw_main_loop_run(pwsdata->loop);
+    /* Last, once the ring and the reader's frame are back in it */
+    pws_PoolDestroy( pwsdata->pool );
+    pwsdata->pool = NULL;
 
-    return 0;
+    // cleanup the notification fd
+    if( -1 != pwsdata->notifyfd )
+        close( pwsdata->notifyfd );
+    pwsdata->notifyfd = -1;
 }
 /* }}} */
 
-/** @description: Find triggered video capture parameter
- *  @param[in]: pwsdata and Parameter
+/** @description: One-time RDK logger and PipeWire initialization for the
+ *                process. pw_init stays done after the last stream closes,
+ *                so opening a stream again does not pay for it twice
+ *  @param[in]: None
  *  @return: None
  */
-/* {{{ pws_OnParamChanged() */
-static void pws_OnParamChanged(void *userdata, uint32_t id, const struct spa_pod *param)
+/* {{{ pws_ProcessInit() */
+static void pws_ProcessInit( void )
 {
-    struct pws_data *pwsdata = userdata;
-    struct pw_stream *stream = pwsdata->stream;
-    uint8_t params_buffer[1024];
-    struct spa_pod_builder b = SPA_POD_BUILDER_INIT(params_buffer, sizeof(params_buffer));
-    const struct spa_pod *params[5];
+    rdk_logger_init("/etc/debug.ini");
 
-    if (param == NULL || id != SPA_PARAM_Format)
-        return;
+    pw_init(NULL, NULL);
+}
+/* }}} */
 
-    if (spa_format_parse(param,
-                         &pwsdata->format.media_type,
-                         &pwsdata->format.media_subtype) < 0 )
-        return;
+static const struct pw_core_events pws_core_events = {
+        PW_VERSION_CORE_EVENTS,
+        .error = pws_OnCoreError,
+};
 
-    if (pwsdata->format.media_type != SPA_MEDIA_TYPE_video )
-        return;
+/** @description: Take a reference on the shared PipeWire loop and core
+ *                connection, creating them for the first stream. A daemon
+ *                that is not up yet is not an error: the retry timer
+ *                connects once it is
+ *  @param[in]: None
+ *  @return: Macro- Success/Failure
+ */
+/* {{{ pws_CoreAcquire() */
+static int pws_CoreAcquire( void )
+{
+    int ret = PWS_SUCCESS;
 
-    if( pwsdata->format.media_subtype == SPA_MEDIA_SUBTYPE_raw )
+    pthread_mutex_lock( &pws_corelock );
+
+    if( 0 == pws_sharedcore.refcount )
     {
-        if( spa_format_video_raw_parse(param, &pwsdata->format.info.raw) >= 0 )
+        pws_sharedcore.loop = pw_thread_loop_new("pwstream", NULL);
+
+        if( NULL != pws_sharedcore.loop )
+            pws_sharedcore.context = pw_context_new(pw_thread_loop_get_loop(pws_sharedcore.loop), NULL, 0);
+
+        if( ( NULL != pws_sharedcore.context ) && ( 0 == pw_thread_loop_start(pws_sharedcore.loop) ) )
         {
-            printf("got video format:\n");
-            printf("  format: %d (%s)\n", pwsdata->format.info.raw.format,
-                                          spa_debug_type_find_name(spa_type_video_format,
-                                                                   pwsdata->format.info.raw.format));
-            printf("  size: %dx%d\n", pwsdata->format.info.raw.size.width,
-                                      pwsdata->format.info.raw.size.height);
-            printf("  framerate: %d/%d\n", pwsdata->format.info.raw.framerate.num,
-                                           pwsdata->format.info.raw.framerate.denom);
+            pw_thread_loop_lock(pws_sharedcore.loop);
+
+            spa_list_init( &pws_sharedcore.streams );
+            pws_sharedcore.corelost = false;
+            pws_sharedcore.retry_ms = PWS_RECONNECT_MIN_MS;
+            pws_sharedcore.retrytimer = pw_loop_add_timer( pw_thread_loop_get_loop(pws_sharedcore.loop),
+                                                           pws_OnRetryTimer, NULL );
+
+            if( NULL != pws_sharedcore.retrytimer )
+            {
+                pws_CoreConnect();
+
+                if( NULL == pws_sharedcore.core )
+                    pws_ArmRetry( pws_sharedcore.retry_ms );
+            }
+
+            pw_thread_loop_unlock(pws_sharedcore.loop);
         }
-    }
 
-    if( pwsdata->format.media_subtype == SPA_MEDIA_SUBTYPE_h264 )
-    {
-        if( spa_format_video_h264_parse(param, &pwsdata->format.info.h264) >= 0 )
+        if( NULL == pws_sharedcore.retrytimer )
         {
-            printf("got video format: H264\n");
-            printf("  size: %dx%d\n", pwsdata->format.info.h264.size.width,
-                                      pwsdata->format.info.h264.size.height);
-            printf("  framerate: %d/%d\n", pwsdata->format.info.h264.framerate.num,
-                                           pwsdata->format.info.h264.framerate.denom);
+            if( NULL != pws_sharedcore.loop )
+                pw_thread_loop_stop(pws_sharedcore.loop);
+
+            if( NULL != pws_sharedcore.context )
+                pw_context_destroy(pws_sharedcore.context);
+
+            if( NULL != pws_sharedcore.loop )
+                pw_thread_loop_destroy(pws_sharedcore.loop);
+
+            pws_sharedcore.context = NULL;
+            pws_sharedcore.loop = NULL;
+
+            ret = PWS_FAILURE;
         }
     }
-   
-    /* a SPA_TYPE_OBJECT_ParamBuffers object defines the acceptable size,
-     * number, stride etc of the buffers */
 
-    params[0] = spa_pod_builder_add_object(&b,
-                SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
-                SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int((1<<SPA_DATA_MemPtr)));
+    if( PWS_SUCCESS == ret )
+        pws_sharedcore.refcount++;
 
-    pw_stream_update_params(stream, params, 1);
+    pthread_mutex_unlock( &pws_corelock );
 
+    return ret;
 }
 /* }}} */
 
-/** @description: Dequeue video frame from pipewire instance
- *  @param[in]: pwsdata
+/** @description: Drop a reference on the shared PipeWire loop and core
+ *                connection, tearing them down after the last stream
+ *  @param[in]: None
  *  @return: None
  */
-/* {{{ pws_OnProcess() */
-static void pws_OnProcess(void *userdata)
+/* {{{ pws_CoreRelease() */
+static void pws_CoreRelease( void )
 {
-    struct pws_data *pwsdata = NULL;
-    struct pw_buffer *b;
-    struct spa_buffer *buf;
-    struct timeb timer_msec;
-
-    if(NULL == userdata )
-        return PWS_FAILURE;
-
-    pwsdata = (struct pws_data *)userdata;
-
-    if( NULL == pwsdata->intermediateFrameInfoH264 )
-        return PWS_FAILURE;
-
-    if ( pthread_mutex_lock( &pws_videoframelock ) != 0 )
-        return PWS_FAILURE;
+    pthread_mutex_lock( &pws_corelock );
 
-    if ((b = pw_stream_dequeue_buffer(pwsdata->stream)) == NULL)
+    if( ( pws_sharedcore.refcount > 0 ) && ( 0 == --pws_sharedcore.refcount ) )
     {
-	RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Out of Buffers \n",__FILE__, __LINE__);
-        return PWS_FAILURE;
-    }
-
-    buf = b->buffer;
-
-    if (buf->datas[0].data == NULL)
-        return PWS_FAILURE;
+        pw_thread_loop_lock(pws_sharedcore.loop);
 
+        pw_loop_destroy_source( pw_thread_loop_get_loop(pws_sharedcore.loop), pws_sharedcore.retrytimer );
+        pws_sharedcore.retrytimer = NULL;
 
-    /* Updating H264 frame details in intermediateFrameInfoH264 */
-    if(SPA_MEDIA_SUBTYPE_h264 == pwsdata->streamprop.enMsubtypeformat )
-    {
-        if (!ftime(&timer_msec))
+        if( NULL != pws_sharedcore.core )
         {
-           pwsdata->intermediateFrameInfoH264->frame_timestamp = ((long long int) timer_msec.time) * 1000ll +
-                                                			(long long int) timer_msec.millitm;
+            spa_hook_remove( &pws_sharedcore.core_listener );
+            pw_core_disconnect(pws_sharedcore.core);
         }
 
-        pwsdata->intermediateFrameInfoH264->frame_size = buf->datas[0].chunk->size;
+        pw_thread_loop_unlock(pws_sharedcore.loop);
 
-        pwsdata->intermediateFrameInfoH264->frame_ptr = (u8*)realloc(pwsdata->intermediateFrameInfoH264->frame_ptr,
-		    						 pwsdata->intermediateFrameInfoH264->frame_size);
+        pw_thread_loop_stop(pws_sharedcore.loop);
+        pw_context_destroy(pws_sharedcore.context);
+        pw_thread_loop_destroy(pws_sharedcore.loop);
 
-	if(NULL != pwsdata->intermediateFrameInfoH264->frame_ptr)
-	{
-	    memset(pwsdata->intermediateFrameInfoH264->frame_ptr,0,pwsdata->intermediateFrameInfoH264->frame_size);
+        pws_sharedcore.core = NULL;
+        pws_sharedcore.context = NULL;
+        pws_sharedcore.loop = NULL;
+    }
 
-	    memcpy(pwsdata->intermediateFrameInfoH264->frame_ptr,
-			    buf->datas[0].data,
-			    pwsdata->intermediateFrameInfoH264->frame_size);
-	}
+    pthread_mutex_unlock( &pws_corelock );
+}
+/* }}} */
 
-	pwsdata->intermediateFrameInfoH264->stream_type = 1;
+/** @description: Connect the shared core to the daemon. Loop lock held
+ *  @param[in]: None
+ *  @return: None, core stays NULL if the daemon is not there
+ */
+/* {{{ pws_CoreConnect() */
+static void pws_CoreConnect( void )
+{
+    pws_sharedcore.core = pw_context_connect(pws_sharedcore.context, NULL, 0);
 
-	pwsdata->intermediateFrameInfoH264->width = pwsdata->streamprop.width;
-	pwsdata->intermediateFrameInfoH264->height = pwsdata->streamprop.height;
+    if( NULL != pws_sharedcore.core )
+        pw_core_add_listener( pws_sharedcore.core, &pws_sharedcore.core_listener, &pws_core_events, NULL );
+}
+/* }}} */
 
-	pwsdata->intermediateFrameInfoH264->pic_type = pws_GetH264PictureType( pwsdata->intermediateFrameInfoH264->frame_ptr );
-    }
+/** @description: Notice the daemon going away. Every stream is marked lost
+ *                and the retry timer does the teardown, outside of this
+ *                event
+ *  @param[in]: data, object id, sequence, error code, message
+ *  @return: None
+ */
+/* {{{ pws_OnCoreError() */
+static void pws_OnCoreError( void *data, uint32_t id, int seq, int res, const char *message )
+{
+    struct pws_data *pwsdata = NULL;
 
-    if( ( true == pwsdata->isH264FrameReady) && ( -1 != pwsdata->pws_fd[0] ) )
-    {
-        char rbuf[1]={0};
-	read(pwsdata->pws_fd[0], rbuf, 1);
-	pwsdata->isH264FrameReady = false;
-    }
+    if( ( PW_ID_CORE != id ) || ( -EPIPE != res ) )
+        return;
 
-    if(pwsdata->pws_fd[1] != -1) 
-    {
-        char wbuf[1] = {0};
-	pwsdata->isH264FrameReady = true;
-        write(pwsdata->pws_fd[1], wbuf, sizeof(wbuf));
-    }
+    pws_sharedcore.corelost = true;
 
-    pw_stream_queue_buffer(pwsdata->stream, b);
+    spa_list_for_each( pwsdata, &pws_sharedcore.streams, corelink )
+        pws_LoseStream( pwsdata );
 
-    pthread_mutex_unlock( &pws_videoframelock );
+    pws_ArmRetry( 0 );
 }
 /* }}} */
 
-/** @description: Get video frame from pwstream instance
+/** @description: Run the retry timer once after delay_ms. Loop lock held
+ *  @param[in]: delay in milliseconds, 0 = as soon as the loop gets to it
+ *  @return: None
+ */
+/* {{{ pws_ArmRetry() */
+static void pws_ArmRetry( u32 delay_ms )
+{
+    struct timespec value;
+
+    value.tv_sec = delay_ms / 1000;
+    value.tv_nsec = ( delay_ms % 1000 ) * 1000000L;
+
+    /* An all-zero value disarms the timer */
+    if( 0 == delay_ms )
+        value.tv_nsec = 1;
+
+    pw_loop_update_timer( pw_thread_loop_get_loop(pws_sharedcore.loop), pws_sharedcore.retrytimer,
+                          &value, NULL, false );
+}
+/* }}} */
+
+/** @description: Bring lost streams back, on the loop thread. A broken core
+ *                connection is dropped and made again, then every stream
+ *                without a PipeWire stream gets a new one. Only the
+ *                PipeWire side is replaced: the eventfd, ring, readers and
+ *                exports of each stream carry on. Whatever fails is tried
+ *                again later, backing off up to PWS_RECONNECT_MAX_MS
+ *  @param[in]: data, expirations
+ *  @return: None
+ */
+/* {{{ pws_OnRetryTimer() */
+static void pws_OnRetryTimer( void *data, uint64_t expirations )
+{
+    struct pws_data *pwsdata = NULL;
+    bool pending = false;
+
+    if( ( true == pws_sharedcore.corelost ) && ( NULL != pws_sharedcore.core ) )
+    {
+        /* Streams go before the core they were made on */
+        spa_list_for_each( pwsdata, &pws_sharedcore.streams, corelink )
+            pws_DestroyStream( pwsdata );
+
+        spa_hook_remove( &pws_sharedcore.core_listener );
+        pw_core_disconnect(pws_sharedcore.core);
+        pws_sharedcore.core = NULL;
+    }
+
+    pws_sharedcore.corelost = false;
+
+    if( NULL == pws_sharedcore.core )
+        pws_CoreConnect();
+
+    spa_list_for_each( pwsdata, &pws_sharedcore.streams, corelink )
+    {
+        if( true == pwsdata->streamlost )
+            pws_DestroyStream( pwsdata );
+
+        if( NULL != pwsdata->stream )
+            continue;
+
+        if( ( NULL == pws_sharedcore.core ) || ( PWS_SUCCESS != pws_ConnectStream( pwsdata ) ) )
+        {
+            pending = true;
+            continue;
+        }
+
+        /* A stream first created here, the daemon having been down at
+         * pws_StreamInit, is no reconnect */
+        if( PWS_STREAM_RECONNECTING == __atomic_load_n( &pwsdata->state, __ATOMIC_RELAXED ) )
+            pws_StatsAdd( &pwsdata->stats->reconnects, 1 );
+
+        pws_SetState( pwsdata, PWS_STREAM_CONNECTING );
+    }
+
+    if( true == pending )
+    {
+        pws_ArmRetry( pws_sharedcore.retry_ms );
+        pws_sharedcore.retry_ms = SPA_MIN( pws_sharedcore.retry_ms * 2, PWS_RECONNECT_MAX_MS );
+    }
+    else
+    {
+        pws_sharedcore.retry_ms = PWS_RECONNECT_MIN_MS;
+    }
+}
+/* }}} */
+
+/** @description: Update video/Audio properties in streamprop structure
+ *  @param[in]: pwsdata
+ *  @return: None
+ */
+/* {{{ pws_Load_DefaultStreamProp() */
+static void pws_Load_DefaultStreamProp( struct pws_data *pwsdata)
+{
+    if( NULL == pwsdata )
+        return;
+
+    if( NULL == pwsdata->streamprop.stream_name )
+        pwsdata->streamprop.stream_name = PWS_DEF_STREAM_NAME;
+
+    /* streamprop keeps the pwstream enums; pws_StartStream converts them
+     * to PipeWire ids, so a second pws_StreamInit sees the same values */
+    if((PWS_MEDIA_TYPE_FORMAT_START >= pwsdata->streamprop.enMtypeformat) || \
+		(pwsdata->streamprop.enMtypeformat >= PWS_MEDIA_TYPE_FORMAT_END))
+    {
+        pwsdata->streamprop.enMtypeformat = PWS_DEF_MEDIA_TYPE_FORMAT;
+    }
+
+    if( NULL == pwsdata->streamprop.mediatype )
+        pwsdata->streamprop.mediatype = ( PWS_MEDIA_TYPE_FORMAT_AUDIO == pwsdata->streamprop.enMtypeformat ) ?
+                                            PWS_DEF_AUDIO_MEDIA_TYPE : PWS_DEF_MEDIA_TYPE;
+
+    if( NULL == pwsdata->streamprop.mediacategory )
+        pwsdata->streamprop.mediacategory = PWS_DEF_MEDIA_CATEGORY;
+
+    if( NULL == pwsdata->streamprop.mediarole )
+        pwsdata->streamprop.mediarole = PWS_DEF_MEDIA_ROLE;
+
+    if( PWS_MEDIA_TYPE_FORMAT_AUDIO == pwsdata->streamprop.enMtypeformat )
+    {
+        if( ( PWS_MEDIA_SUBTYPE_FORMAT_RAW != pwsdata->streamprop.enMsubtypeformat ) &&
+		( PWS_MEDIA_SUBTYPE_FORMAT_AAC != pwsdata->streamprop.enMsubtypeformat ) )
+            pwsdata->streamprop.enMsubtypeformat = PWS_DEF_AUDIO_SUBTYPE_FORMAT;
+
+        if( ( PWS_AUDIO_FORMAT_START >= pwsdata->streamprop.enaudioformat ) ||
+		( pwsdata->streamprop.enaudioformat >= PWS_AUDIO_FORMAT_END ) )
+            pwsdata->streamprop.enaudioformat = PWS_DEF_AUDIO_FORMAT;
+
+        if( 0 == pwsdata->streamprop.samplerate )
+            pwsdata->streamprop.samplerate = PWS_DEF_SAMPLE_RATE;
+
+        if( 0 == pwsdata->streamprop.channels )
+            pwsdata->streamprop.channels = PWS_DEF_CHANNELS;
+    }
+    else if( ( PWS_MEDIA_SUBTYPE_FORMAT_RAW != pwsdata->streamprop.enMsubtypeformat ) &&
+		( PWS_MEDIA_SUBTYPE_FORMAT_H264 != pwsdata->streamprop.enMsubtypeformat ) )
+    {
+        pwsdata->streamprop.enMsubtypeformat = PWS_DEF_MEDIA_SUBTYPE_FORMAT;
+    }
+
+    if( ( PWS_VIDEO_FORMAT_START >= pwsdata->streamprop.envideoformat ) ||
+		( pwsdata->streamprop.envideoformat >= PWS_VIDEO_FORMAT_END ) )
+    {
+        pwsdata->streamprop.envideoformat = PWS_DEF_VIDEO_FORMAT;
+    }
+
+    if( 0 == pwsdata->streamprop.width )
+        pwsdata->streamprop.width = PWS_DEF_FRAME_WIDTH;
+
+    if( 0 == pwsdata->streamprop.height )
+        pwsdata->streamprop.height = PWS_DEF_FRAME_HEIGHT;
+
+    if( 0 == pwsdata->streamprop.framerate )
+        pwsdata->streamprop.framerate = PWS_DEF_FRAMERATE;
+
+    if( 0 == pwsdata->streamprop.ringdepth )
+        pwsdata->streamprop.ringdepth = PWS_DEF_RING_DEPTH;
+
+    if( pwsdata->streamprop.ringdepth > PWS_MAX_RING_DEPTH )
+        pwsdata->streamprop.ringdepth = PWS_MAX_RING_DEPTH;
+
+    if( ( PWS_OVERFLOW_DROP_NEWEST != pwsdata->streamprop.enoverflowpolicy ) &&
+        ( PWS_OVERFLOW_DROP_GOP != pwsdata->streamprop.enoverflowpolicy ) )
+        pwsdata->streamprop.enoverflowpolicy = PWS_OVERFLOW_DROP_OLDEST;
+
+    if( 0 == pwsdata->streamprop.maxheldbuffers )
+        pwsdata->streamprop.maxheldbuffers = PWS_DEF_MAX_HELD_BUFFERS;
+
+    if( pwsdata->streamprop.maxheldbuffers > PWS_MAX_HELD_BUFFERS )
+        pwsdata->streamprop.maxheldbuffers = PWS_MAX_HELD_BUFFERS;
+
+    if( 0 == pwsdata->streamprop.historyframes )
+        pwsdata->streamprop.historyframes = PWS_DEF_HISTORY_FRAMES;
+
+    if( PWS_NOTIFY_EDGE != pwsdata->streamprop.ennotifymode )
+        pwsdata->streamprop.ennotifymode = PWS_NOTIFY_LEVEL;
+
+    if( pwsdata->streamprop.endecimatemode > PWS_DECIMATE_MAX_FPS )
+        pwsdata->streamprop.endecimatemode = PWS_DECIMATE_NONE;
+
+    pwsdata->decimatecount = 0;
+    pwsdata->decimatenext_ns = 0;
+
+    if( pwsdata->streamprop.maxreaders > PWS_MAX_READERS )
+        pwsdata->streamprop.maxreaders = PWS_MAX_READERS;
+
+    if( 0 == pwsdata->streamprop.readerlag )
+        pwsdata->streamprop.readerlag = pwsdata->streamprop.ringdepth;
+
+    if( pwsdata->streamprop.readerlag > PWS_MAX_RING_DEPTH )
+        pwsdata->streamprop.readerlag = PWS_MAX_RING_DEPTH;
+
+    if( 0 == pwsdata->streamprop.shmslots )
+        pwsdata->streamprop.shmslots = pwsdata->streamprop.ringdepth;
+
+    if( pwsdata->streamprop.shmslots > PWS_MAX_RING_DEPTH )
+        pwsdata->streamprop.shmslots = PWS_MAX_RING_DEPTH;
+
+    /* Encoded frames vary in size; a frame larger than a slot is not
+     * exported at all, so leave headroom over the keyframe estimate */
+    if( 0 == pwsdata->streamprop.shmslotsize )
+    {
+        pwsdata->streamprop.shmslotsize = pws_EstimateFrameSize( pwsdata );
+
+        if( ( PWS_MEDIA_TYPE_FORMAT_VIDEO == pwsdata->streamprop.enMtypeformat ) &&
+            ( PWS_MEDIA_SUBTYPE_FORMAT_H264 == pwsdata->streamprop.enMsubtypeformat ) )
+            pwsdata->streamprop.shmslotsize *= PWS_SHM_SLOT_HEADROOM;
+    }
+
+    /* Shared frames are copies; there is no PipeWire buffer to lend out
+     * to several readers at once */
+    if( 0 != pwsdata->streamprop.maxreaders )
+        pwsdata->streamprop.zerocopy = false;
+
+    /* Reader handles take every frame; there is no single newest one */
+    if( 0 != pwsdata->streamprop.maxreaders )
+        pwsdata->streamprop.latestframe = false;
+
+    /* The newest frame is copied into a slot allocated up front; a reader
+     * wakes once per batch of frames it did not take yet */
+    if( true == pwsdata->streamprop.latestframe )
+    {
+        pwsdata->streamprop.zerocopy = false;
+        pwsdata->streamprop.ennotifymode = PWS_NOTIFY_EDGE;
+
+        if( 0 == pwsdata->streamprop.latestframesize )
+        {
+            pwsdata->streamprop.latestframesize = pws_EstimateFrameSize( pwsdata );
+
+            if( ( PWS_MEDIA_TYPE_FORMAT_VIDEO == pwsdata->streamprop.enMtypeformat ) &&
+                ( PWS_MEDIA_SUBTYPE_FORMAT_H264 == pwsdata->streamprop.enMsubtypeformat ) )
+                pwsdata->streamprop.latestframesize *= PWS_LATEST_SLOT_HEADROOM;
+        }
+    }
+
+}
+/* }}} */
+
+static const struct pw_stream_events pws_stream_events = {
+        PW_VERSION_STREAM_EVENTS,
+        .state_changed = pws_OnStateChanged,
+        .param_changed = pws_OnParamChanged,
+        .add_buffer = pws_OnAddBuffer,
+        .remove_buffer = pws_OnRemoveBuffer,
+        .process = pws_OnProcess,
+};
+
+/** @description: Build one video EnumFormat
+ *  @param[in]: pod builder, format, highest framerate to accept
+ *  @return: Format pod
+ */
+/* {{{ pws_BuildVideoFormat() */
+static const struct spa_pod *pws_BuildVideoFormat( struct spa_pod_builder *b, const pws_formatPref *pref, u32 maxframerate )
+{
+    return spa_pod_builder_add_object(b,
+                    SPA_TYPE_OBJECT_Format,   SPA_PARAM_EnumFormat,
+                    SPA_FORMAT_mediaType,     SPA_POD_Id(SPA_MEDIA_TYPE_video),
+                    SPA_FORMAT_mediaSubtype,  SPA_POD_Id(pws_FormatConversion(PWS_FORMAT_MEDIA_SUBTYPE,
+                                                                              pref->enMsubtypeformat)),
+                    SPA_FORMAT_VIDEO_format,  SPA_POD_Id(pws_FormatConversion(PWS_FORMAT_VIDEO,
+                                                                              pref->envideoformat)),
+                    SPA_FORMAT_VIDEO_size,    SPA_POD_Rectangle(
+			                          &SPA_RECTANGLE(
+					              pref->width, 
+						      pref->height)),
+		    SPA_FORMAT_VIDEO_framerate, SPA_POD_CHOICE_RANGE_Fraction(
+                                                              &SPA_FRACTION(pref->framerate, 1),
+                                                              &SPA_FRACTION(0, 1),
+                                                              &SPA_FRACTION(maxframerate, 1)));
+}
+/* }}} */
+
+/** @description: Build the EnumFormats offered for the configured media
+ *                type. Video offers streamprop.formatprefs in order when
+ *                set, else the single format in streamprop
+ *  @param[in]: pwsdata, pod builder
+ *  @param[out]: params - PWS_MAX_FORMAT_PREFS entries
+ *  @return: Number of formats built
+ */
+/* {{{ pws_BuildFormats() */
+static u32 pws_BuildFormats( struct pws_data *pwsdata, struct spa_pod_builder *b, const struct spa_pod **params )
+{
+    u32 mediatype = pws_FormatConversion( PWS_FORMAT_MEDIA_TYPE, pwsdata->streamprop.enMtypeformat );
+    u32 mediasubtype = pws_FormatConversion( PWS_FORMAT_MEDIA_SUBTYPE, pwsdata->streamprop.enMsubtypeformat );
+    pws_formatPref pref;
+    u32 nparams = 0;
+    u32 i = 0;
+
+    if( PWS_MEDIA_TYPE_FORMAT_AUDIO == pwsdata->streamprop.enMtypeformat )
+    {
+        if( PWS_MEDIA_SUBTYPE_FORMAT_AAC == pwsdata->streamprop.enMsubtypeformat )
+        {
+            params[0] = spa_pod_builder_add_object(b,
+                    SPA_TYPE_OBJECT_Format,   SPA_PARAM_EnumFormat,
+                    SPA_FORMAT_mediaType,     SPA_POD_Id(mediatype),
+                    SPA_FORMAT_mediaSubtype,  SPA_POD_Id(mediasubtype),
+                    SPA_FORMAT_AUDIO_rate,    SPA_POD_Int(pwsdata->streamprop.samplerate),
+                    SPA_FORMAT_AUDIO_channels, SPA_POD_Int(pwsdata->streamprop.channels));
+            return 1;
+        }
+
+        params[0] = spa_pod_builder_add_object(b,
+                    SPA_TYPE_OBJECT_Format,   SPA_PARAM_EnumFormat,
+                    SPA_FORMAT_mediaType,     SPA_POD_Id(mediatype),
+                    SPA_FORMAT_mediaSubtype,  SPA_POD_Id(mediasubtype),
+                    SPA_FORMAT_AUDIO_format,  SPA_POD_Id(pws_FormatConversion(PWS_FORMAT_AUDIO,
+                                                                              pwsdata->streamprop.enaudioformat)),
+                    SPA_FORMAT_AUDIO_rate,    SPA_POD_Int(pwsdata->streamprop.samplerate),
+                    SPA_FORMAT_AUDIO_channels, SPA_POD_Int(pwsdata->streamprop.channels));
+        return 1;
+    }
+
+    /* Each preference caps the framerate it asks for, so a producer that can
+     * go faster still delivers no more than that */
+    for( i = 0; ( NULL != pwsdata->streamprop.formatprefs ) && ( i < pwsdata->streamprop.nformatprefs ) &&
+                ( nparams < PWS_MAX_FORMAT_PREFS ); i++ )
+    {
+        pref = pwsdata->streamprop.formatprefs[i];
+
+        if( ( PWS_MEDIA_SUBTYPE_FORMAT_RAW != pref.enMsubtypeformat ) &&
+            ( PWS_MEDIA_SUBTYPE_FORMAT_H264 != pref.enMsubtypeformat ) )
+            pref.enMsubtypeformat = pwsdata->streamprop.enMsubtypeformat;
+
+        if( PWS_MEDIA_SUBTYPE_FORMAT_H264 == pref.enMsubtypeformat )
+            pref.envideoformat = PWS_VIDEO_FORMAT_ENCODED;
+        else if( ( PWS_VIDEO_FORMAT_I420 != pref.envideoformat ) && ( PWS_VIDEO_FORMAT_NV12 != pref.envideoformat ) )
+            pref.envideoformat = PWS_DEF_RAW_VIDEO_FORMAT;
+
+        if( 0 == pref.width )
+            pref.width = pwsdata->streamprop.width;
+
+        if( 0 == pref.height )
+            pref.height = pwsdata->streamprop.height;
+
+        if( 0 == pref.framerate )
+            pref.framerate = pwsdata->streamprop.framerate;
+
+        params[nparams++] = pws_BuildVideoFormat( b, &pref, pref.framerate );
+    }
+
+    if( 0 != nparams )
+        return nparams;
+
+    pref.enMsubtypeformat = pwsdata->streamprop.enMsubtypeformat;
+    pref.envideoformat = pwsdata->streamprop.envideoformat;
+    pref.width = pwsdata->streamprop.width;
+    pref.height = pwsdata->streamprop.height;
+    pref.framerate = pwsdata->streamprop.framerate;
+
+    params[0] = pws_BuildVideoFormat( b, &pref, PWS_MAX_FRAMERATE );
+
+    return 1;
+}
+/* }}} */
+
+/** @description: Set up the stream's export and register it with the
+ *                shared core, creating its PipeWire stream right away if
+ *                the daemon is there and from the retry timer otherwise
+ *  @param[in]: pwsdata
+ *  @return: Macro- Success/Failure
+ */
+/* {{{ pws_StartStream() */
+static int pws_StartStream( struct pws_data *pwsdata )
+{
+    if( NULL == pwsdata )
+        return PWS_FAILURE;
+
+    printf(" mtype<%s> mcategory<%s> mediarole<%s> Mtypeformat<%d> MsubtypeFMT<%d> Videoformat<%d> Width<%d> height<%d> framerate<%d>",
+                    pwsdata->streamprop.mediatype,
+                    pwsdata->streamprop.mediacategory,
+                    pwsdata->streamprop.mediarole,
+                    pwsdata->streamprop.enMtypeformat,
+                    pwsdata->streamprop.enMsubtypeformat,
+                    pwsdata->streamprop.envideoformat,
+                    pwsdata->streamprop.width,
+                    pwsdata->streamprop.height,
+                    pwsdata->streamprop.framerate );
+
+    pwsdata->loop = pws_sharedcore.loop;
+
+    pw_thread_loop_lock(pwsdata->loop);
+
+    /* Before the stream, so the first frame already has somewhere to go */
+    if( ( NULL != pwsdata->streamprop.shmsocket ) && ( NULL == pwsdata->shmexport ) )
+    {
+        pwsdata->shmexport = pws_ShmExportCreate( pw_thread_loop_get_loop(pwsdata->loop),
+                                                  pwsdata->streamprop.shmsocket,
+                                                  pwsdata->streamprop.shmslots,
+                                                  pwsdata->streamprop.shmslotsize );
+
+        if( NULL == pwsdata->shmexport )
+        {
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to export on %s \n",__FILE__, __LINE__, pwsdata->streamprop.shmsocket);
+            pw_thread_loop_unlock(pwsdata->loop);
+            return PWS_FAILURE;
+        }
+    }
+
+    if( ( NULL != pws_sharedcore.core ) && ( false == pws_sharedcore.corelost ) &&
+        ( PWS_SUCCESS != pws_ConnectStream( pwsdata ) ) )
+    {
+        /* The export's socket source lives on the shared loop, and a
+         * stream whose init failed is never closed */
+        pws_ShmExportDestroy( pwsdata->shmexport );
+        pwsdata->shmexport = NULL;
+
+        pw_thread_loop_unlock(pwsdata->loop);
+        return PWS_FAILURE;
+    }
+
+    spa_list_append( &pws_sharedcore.streams, &pwsdata->corelink );
+
+    pw_thread_loop_unlock(pwsdata->loop);
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Create the PipeWire stream on the shared core and connect
+ *                it. Loop lock held
+ *  @param[in]: pwsdata
+ *  @return: Macro- Success/Failure
+ */
+/* {{{ pws_ConnectStream() */
+static int pws_ConnectStream( struct pws_data *pwsdata )
+{
+    const struct spa_pod *params[PWS_MAX_FORMAT_PREFS];
+    uint8_t buffer[PWS_MAX_FORMAT_PREFS * 512];
+    struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+    u32 nparams = 0;
+    int ret = 0;
+
+    nparams = pws_BuildFormats( pwsdata, &b, params );
+
+    pwsdata->stream = pw_stream_new(
+                          pws_sharedcore.core,
+                          pwsdata->streamprop.stream_name,
+                          pw_properties_new(
+                              PW_KEY_MEDIA_TYPE, pwsdata->streamprop.mediatype,
+                              PW_KEY_MEDIA_CATEGORY, pwsdata->streamprop.mediacategory,
+                              PW_KEY_MEDIA_ROLE, pwsdata->streamprop.mediarole,
+                              NULL));
+
+    if( NULL == pwsdata->stream )
+        return PWS_FAILURE;
+
+    pw_stream_add_listener(pwsdata->stream,
+                           &pwsdata->stream_listener,
+                           &pws_stream_events,
+                           pwsdata);
+
+    ret = pw_stream_connect(pwsdata->stream,
+                      PW_DIRECTION_INPUT,
+                      PW_ID_ANY,
+                      PW_STREAM_FLAG_AUTOCONNECT,
+                      params, nparams);
+
+    if( ret < 0 )
+    {
+        pw_stream_destroy(pwsdata->stream);
+        pwsdata->stream = NULL;
+    }
+
+    return ( ret < 0 ) ? PWS_FAILURE : PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Disconnect and destroy the PipeWire stream and nothing
+ *                else. Buffers still lent to the consumer stay mapped, see
+ *                pws_OnRemoveBuffer. Loop lock held
+ *  @param[in]: pwsdata
+ *  @return: None
+ */
+/* {{{ pws_DestroyStream() */
+static void pws_DestroyStream( struct pws_data *pwsdata )
+{
+    /* Set while disconnecting so the state change it causes is not taken
+     * for a loss */
+    pwsdata->streamlost = true;
+
+    if( NULL != pwsdata->stream )
+    {
+        pw_stream_disconnect(pwsdata->stream);
+        pw_stream_destroy(pwsdata->stream);
+        pwsdata->stream = NULL;
+    }
+
+    pwsdata->streamlost = false;
+}
+/* }}} */
+
+/** @description: Mark a stream lost, with the daemon or on its own, and
+ *                have the retry timer replace it. Loop lock held
+ *  @param[in]: pwsdata
+ *  @return: None
+ */
+/* {{{ pws_LoseStream() */
+static void pws_LoseStream( struct pws_data *pwsdata )
+{
+    if( ( true == pwsdata->streamlost ) ||
+        ( PWS_STREAM_CLOSED == __atomic_load_n( &pwsdata->state, __ATOMIC_RELAXED ) ) )
+        return;
+
+    pwsdata->streamlost = true;
+
+    /* A second loss before frames came back keeps the first gap open */
+    if( 0 == pwsdata->gapstart_ns )
+        pwsdata->gapstart_ns = pwsdata->lastreceive_ns;
+
+    pws_SetState( pwsdata, PWS_STREAM_RECONNECTING );
+
+    pws_ArmRetry( 0 );
+}
+/* }}} */
+
+/** @description: Move the stream to another PWS_STREAM_STATE and wake
+ *                pws_WaitReady callers
+ *  @param[in]: pwsdata, new state
+ *  @return: None
+ */
+/* {{{ pws_SetState() */
+static void pws_SetState( struct pws_data *pwsdata, u32 state )
+{
+    if( state == __atomic_exchange_n( &pwsdata->state, state, __ATOMIC_SEQ_CST ) )
+        return;
+
+    if( 0 != __atomic_load_n( &pwsdata->statewaiters, __ATOMIC_SEQ_CST ) )
+        syscall( SYS_futex, &pwsdata->state, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0 );
+}
+/* }}} */
+
+/** @description: Record the time since pws_StreamInit in a startup field
+ *                not set yet
+ *  @param[in]: pwsdata, field of pwsdata->startup
+ *  @return: None
+ */
+/* {{{ pws_StartupMark() */
+static void pws_StartupMark( struct pws_data *pwsdata, u64 *pmark )
+{
+    if( 0 == __atomic_load_n( pmark, __ATOMIC_RELAXED ) )
+        __atomic_store_n( pmark, pws_MonotonicNs() - pwsdata->init_ns, __ATOMIC_RELAXED );
+}
+/* }}} */
+
+/** @description: First frame since the stream was connected, negotiated
+ *                again, or lost: it is streaming, and a reconnect gap is
+ *                closed
+ *  @param[in]: pwsdata, receive time
+ *  @return: None
+ */
+/* {{{ pws_FirstFrame() */
+static void pws_FirstFrame( struct pws_data *pwsdata, u64 receive_ts_ns )
+{
+    pws_StartupMark( pwsdata, &pwsdata->startup.first_frame_ns );
+
+    if( 0 != pwsdata->gapstart_ns )
+    {
+        pws_StatsRecord( &pwsdata->stats->reconnect_gap_ns, receive_ts_ns - pwsdata->gapstart_ns );
+        pwsdata->gapstart_ns = 0;
+    }
+
+    pws_SetState( pwsdata, PWS_STREAM_STREAMING );
+}
+/* }}} */
+
+/** @description: Follow the PipeWire stream state. A stream that fails, or
+ *                is disconnected other than by pws_DestroyStream, is lost
+ *  @param[in]: pwsdata, previous state, new state, error message
+ *  @return: None
+ */
+/* {{{ pws_OnStateChanged() */
+static void pws_OnStateChanged( void *userdata, enum pw_stream_state old, enum pw_stream_state state, const char *error )
+{
+    struct pws_data *pwsdata = (struct pws_data *)userdata;
+
+    if( ( PW_STREAM_STATE_PAUSED == state ) || ( PW_STREAM_STATE_STREAMING == state ) )
+        pws_StartupMark( pwsdata, &pwsdata->startup.connected_ns );
+
+    if( ( PW_STREAM_STATE_ERROR == state ) ||
+        ( ( PW_STREAM_STATE_UNCONNECTED == state ) && ( PW_STREAM_STATE_UNCONNECTED != old ) ) )
+        pws_LoseStream( pwsdata );
+}
+/* }}} */
+
+/** @description: Set the scheduling policy and CPU affinity of the
+ *                thread it runs on, the PipeWire loop thread
+ *  @param[in]: loop, async, seq, data, size, pwsdata
+ *  @return: 0
+ */
+/* {{{ pws_DoThreadPolicy() */
+static int pws_DoThreadPolicy( struct spa_loop *loop, bool async, uint32_t seq,
+                               const void *data, size_t size, void *user_data )
+{
+    struct pws_data *pwsdata = (struct pws_data *)user_data;
+    struct sched_param param;
+    cpu_set_t cpus;
+    u32 i = 0;
+    int ret = 0;
+
+    if( 0 != pwsdata->streamprop.rtpriority )
+    {
+        memset( &param, 0, sizeof(param) );
+        param.sched_priority = SPA_CLAMP( (int)pwsdata->streamprop.rtpriority,
+                                          sched_get_priority_min( SCHED_FIFO ),
+                                          sched_get_priority_max( SCHED_FIFO ) );
+
+        ret = pthread_setschedparam( pthread_self(), SCHED_FIFO, &param );
+
+        if( 0 != ret )
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to set SCHED_FIFO priority %d: %s \n",__FILE__, __LINE__, param.sched_priority, strerror(ret));
+    }
+
+    if( 0 != pwsdata->streamprop.cpuaffinity )
+    {
+        CPU_ZERO( &cpus );
+
+        for( i = 0; i < PWS_MAX_AFFINITY_CPUS; i++ )
+        {
+            if( 0 != ( pwsdata->streamprop.cpuaffinity & ( 1ULL << i ) ) )
+                CPU_SET( i, &cpus );
+        }
+
+        ret = pthread_setaffinity_np( pthread_self(), sizeof(cpus), &cpus );
+
+        if( 0 != ret )
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to set CPU affinity 0x%llx: %s \n",__FILE__, __LINE__, pwsdata->streamprop.cpuaffinity, strerror(ret));
+    }
+
+    return 0;
+}
+/* }}} */
+
+/** @description: Apply streamprop rtpriority and cpuaffinity to the PipeWire
+ *                thread. The thread is shared by every stream in the
+ *                process, so the last stream that sets them wins; failing
+ *                to apply them (no CAP_SYS_NICE, say) is logged, not fatal
+ *  @param[in]: pwsdata
+ *  @return: None
+ */
+/* {{{ pws_ApplyThreadPolicy() */
+static void pws_ApplyThreadPolicy( struct pws_data *pwsdata )
+{
+    if( ( 0 == pwsdata->streamprop.rtpriority ) && ( 0 == pwsdata->streamprop.cpuaffinity ) )
+        return;
+
+    pw_loop_invoke(pw_thread_loop_get_loop(pwsdata->loop), pws_DoThreadPolicy,
+                   0, NULL, 0, true, pwsdata);
+}
+/* }}} */
+
+/** @description: Copy the video format the producer picked into streamprop,
+ *                where frame width/height and later reinits pick it up
+ *  @param[in]: pwsdata
+ *  @return: None
+ */
+/* {{{ pws_ApplyNegotiatedFormat() */
+static void pws_ApplyNegotiatedFormat( struct pws_data *pwsdata )
+{
+    struct spa_rectangle size = pwsdata->format.info.h264.size;
+    struct spa_fraction framerate = pwsdata->format.info.h264.framerate;
+
+    if( SPA_MEDIA_SUBTYPE_raw == pwsdata->format.media_subtype )
+    {
+        size = pwsdata->format.info.raw.size;
+        framerate = pwsdata->format.info.raw.framerate;
+
+        pwsdata->streamprop.enMsubtypeformat = PWS_MEDIA_SUBTYPE_FORMAT_RAW;
+        pwsdata->streamprop.envideoformat = ( SPA_VIDEO_FORMAT_I420 == pwsdata->format.info.raw.format ) ?
+                                                PWS_VIDEO_FORMAT_I420 : PWS_VIDEO_FORMAT_NV12;
+    }
+    else
+    {
+        pwsdata->streamprop.enMsubtypeformat = PWS_MEDIA_SUBTYPE_FORMAT_H264;
+        pwsdata->streamprop.envideoformat = PWS_VIDEO_FORMAT_ENCODED;
+    }
+
+    if( ( 0 != size.width ) && ( 0 != size.height ) )
+    {
+        pwsdata->streamprop.width = size.width;
+        pwsdata->streamprop.height = size.height;
+    }
+
+    if( ( 0 != framerate.num ) && ( 0 != framerate.denom ) )
+        pwsdata->streamprop.framerate = ( framerate.num + framerate.denom / 2 ) / framerate.denom;
+}
+/* }}} */
+
+/** @description: Find triggered video capture parameter
+ *  @param[in]: pwsdata and Parameter
+ *  @return: None
+ */
+/* {{{ pws_OnParamChanged() */
+static void pws_OnParamChanged(void *userdata, uint32_t id, const struct spa_pod *param)
+{
+    struct pws_data *pwsdata = userdata;
+    struct pw_stream *stream = pwsdata->stream;
+    uint8_t params_buffer[1024];
+    struct spa_pod_builder b = SPA_POD_BUILDER_INIT(params_buffer, sizeof(params_buffer));
+    const struct spa_pod *params[5];
+    u32 nbuffers = 0;
+
+    if (id != SPA_PARAM_Format)
+        return;
+
+    /* Cleared when the producer goes away; back to waiting for one */
+    if (param == NULL)
+    {
+        if( false == pwsdata->streamlost )
+            pws_SetState( pwsdata, PWS_STREAM_CONNECTING );
+
+        return;
+    }
+
+    if (spa_format_parse(param,
+                         &pwsdata->format.media_type,
+                         &pwsdata->format.media_subtype) < 0 )
+        return;
+
+    if( pwsdata->format.media_type == SPA_MEDIA_TYPE_audio )
+    {
+        /* AAC carries no raw layout; keep what was asked for */
+        pwsdata->audioformat.rate = pwsdata->streamprop.samplerate;
+        pwsdata->audioformat.channels = pwsdata->streamprop.channels;
+
+        if( ( pwsdata->format.media_subtype == SPA_MEDIA_SUBTYPE_raw ) &&
+            ( spa_format_audio_raw_parse(param, &pwsdata->audioformat) >= 0 ) )
+        {
+	    RDK_LOG(RDK_LOG_DEBUG,"LOG.RDK.PWSTREAM","%s(%d) : Audio format %d (%s) rate %d channels %d \n",__FILE__, __LINE__,
+                    pwsdata->audioformat.format,
+                    spa_debug_type_find_name(spa_type_audio_format, pwsdata->audioformat.format),
+                    pwsdata->audioformat.rate, pwsdata->audioformat.channels);
+        }
+    }
+    else if (pwsdata->format.media_type != SPA_MEDIA_TYPE_video )
+        return;
+
+    if( ( pwsdata->format.media_type == SPA_MEDIA_TYPE_video ) &&
+        ( pwsdata->format.media_subtype == SPA_MEDIA_SUBTYPE_raw ) )
+    {
+        if( spa_format_video_raw_parse(param, &pwsdata->format.info.raw) >= 0 )
+        {
+            printf("got video format:\n");
+            printf("  format: %d (%s)\n", pwsdata->format.info.raw.format,
+                                          spa_debug_type_find_name(spa_type_video_format,
+                                                                   pwsdata->format.info.raw.format));
+            printf("  size: %dx%d\n", pwsdata->format.info.raw.size.width,
+                                      pwsdata->format.info.raw.size.height);
+            printf("  framerate: %d/%d\n", pwsdata->format.info.raw.framerate.num,
+                                           pwsdata->format.info.raw.framerate.denom);
+
+            pws_ApplyNegotiatedFormat( pwsdata );
+        }
+    }
+
+    if( pwsdata->format.media_subtype == SPA_MEDIA_SUBTYPE_h264 )
+    {
+        if( spa_format_video_h264_parse(param, &pwsdata->format.info.h264) >= 0 )
+        {
+            printf("got video format: H264\n");
+            printf("  size: %dx%d\n", pwsdata->format.info.h264.size.width,
+                                      pwsdata->format.info.h264.size.height);
+            printf("  framerate: %d/%d\n", pwsdata->format.info.h264.framerate.num,
+                                           pwsdata->format.info.h264.framerate.denom);
+
+            pws_ApplyNegotiatedFormat( pwsdata );
+        }
+    }
+   
+    pws_StartupMark( pwsdata, &pwsdata->startup.negotiated_ns );
+
+    if( false == pwsdata->streamlost )
+        pws_SetState( pwsdata, PWS_STREAM_NEGOTIATED );
+
+    /* a SPA_TYPE_OBJECT_ParamBuffers object defines the acceptable size,
+     * number, stride etc of the buffers */
+
+    if( true == pwsdata->streamprop.zerocopy )
+    {
+        /* Queued and held frames keep their buffers out of the pool, so ask
+         * for enough that the producer always has two left to fill. */
+        nbuffers = pwsdata->streamprop.ringdepth + pwsdata->streamprop.maxheldbuffers + 2;
+
+        if( nbuffers > PWS_MAX_STREAM_BUFFERS )
+            nbuffers = PWS_MAX_STREAM_BUFFERS;
+
+        params[0] = spa_pod_builder_add_object(&b,
+                    SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+                    SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(nbuffers, 2, PWS_MAX_STREAM_BUFFERS),
+                    SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int(PWS_BUFFER_DATA_TYPES));
+    }
+    else
+    {
+        params[0] = spa_pod_builder_add_object(&b,
+                    SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers,
+                    SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int(PWS_BUFFER_DATA_TYPES));
+    }
+
+    /* Ask for the header so capture timestamps come from the producer */
+    params[1] = spa_pod_builder_add_object(&b,
+                SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+                SPA_PARAM_META_type, SPA_POD_Id(SPA_META_Header),
+                SPA_PARAM_META_size, SPA_POD_Int(sizeof(struct spa_meta_header)));
+
+    pw_stream_update_params(stream, params, 2);
+
+}
+/* }}} */
+
+/** @description: Map the fd-backed data blocks of a new PipeWire buffer.
+ *                MemPtr blocks are already addressable and left alone
+ *  @param[in]: pwsdata, pw_buffer
+ *  @return: None
+ */
+/* {{{ pws_OnAddBuffer() */
+static void pws_OnAddBuffer(void *userdata, struct pw_buffer *pwbuf)
+{
+    struct spa_buffer *buf = pwbuf->buffer;
+    struct pws_bufmap *map = NULL;
+    struct spa_data *d = NULL;
+    void *base = NULL;
+    u32 i = 0;
+
+    map = (struct pws_bufmap *)calloc( 1, sizeof(struct pws_bufmap) );
+
+    if( NULL == map )
+    {
+	RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+        return;
+    }
+
+    map->pwbuf = pwbuf;
+
+    for( i = 0; ( i < buf->n_datas ) && ( i < PWS_MAX_PLANES ); i++ )
+    {
+        d = &buf->datas[i];
+
+        if( ( ( SPA_DATA_MemFd != d->type ) && ( SPA_DATA_DmaBuf != d->type ) ) || ( NULL != d->data ) )
+            continue;
+
+        /* Map from 0 so mapoffset need not be page aligned */
+        base = mmap( NULL, d->mapoffset + d->maxsize, PROT_READ, MAP_SHARED, d->fd, 0 );
+
+        if( MAP_FAILED == base )
+        {
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to map buffer fd %d \n",__FILE__, __LINE__, (int)d->fd);
+            continue;
+        }
+
+        map->base[i] = base;
+        map->length[i] = d->mapoffset + d->maxsize;
+        d->data = (u8*)base + d->mapoffset;
+    }
+
+    pwbuf->user_data = map;
+}
+/* }}} */
+
+/** @description: Unmap what pws_OnAddBuffer mapped. A buffer lent out at
+ *                the time, its stream going away under a reconnect say,
+ *                stays mapped until the consumer gives it back
+ *  @param[in]: pwsdata, pw_buffer
+ *  @return: None
+ */
+/* {{{ pws_OnRemoveBuffer() */
+static void pws_OnRemoveBuffer(void *userdata, struct pw_buffer *pwbuf)
+{
+    struct pws_bufmap *map = (struct pws_bufmap *)pwbuf->user_data;
+    u32 i = 0;
+
+    if( NULL == map )
+        return;
+
+    pwbuf->user_data = NULL;
+    map->pwbuf = NULL;
+
+    if( true == map->lent )
+        return;
+
+    for( i = 0; i < PWS_MAX_PLANES; i++ )
+    {
+        if( NULL != map->base[i] )
+            pwbuf->buffer->datas[i].data = NULL;
+    }
+
+    pws_UnmapBuffer( map );
+}
+/* }}} */
+
+/** @description: Unmap and free a buffer's mapping record
+ *  @param[in]: map
+ *  @return: None
+ */
+/* {{{ pws_UnmapBuffer() */
+static void pws_UnmapBuffer( struct pws_bufmap *map )
+{
+    u32 i = 0;
+
+    for( i = 0; i < PWS_MAX_PLANES; i++ )
+    {
+        if( NULL != map->base[i] )
+            munmap( map->base[i], map->length[i] );
+    }
+
+    free( map );
+}
+/* }}} */
+
+/** @description: Bracket CPU reads of DMA-BUF data blocks
+ *  @param[in]: spa buffer, DMA_BUF_SYNC_START or DMA_BUF_SYNC_END
+ *  @return: None
+ */
+/* {{{ pws_DmaBufSync() */
+static void pws_DmaBufSync( struct spa_buffer *buf, u64 flags )
+{
+    struct dma_buf_sync sync = { flags | DMA_BUF_SYNC_READ };
+    u32 i = 0;
+
+    for( i = 0; i < buf->n_datas; i++ )
+    {
+        if( SPA_DATA_DmaBuf == buf->datas[i].type )
+            ioctl( (int)buf->datas[i].fd, DMA_BUF_IOCTL_SYNC, &sync );
+    }
+}
+/* }}} */
+
+/** @description: Describe the fds behind a buffer's data blocks
+ *  @param[in]: spa buffer
+ *  @param[out]: fds
+ *  @return: Number of fd-backed blocks
+ */
+/* {{{ pws_GetFrameFds() */
+static u32 pws_GetFrameFds( struct spa_buffer *buf, pws_frameFd *fds )
+{
+    struct spa_data *d = NULL;
+    u32 nfds = 0;
+    u32 i = 0;
+
+    for( i = 0; ( i < buf->n_datas ) && ( i < PWS_MAX_PLANES ); i++ )
+    {
+        d = &buf->datas[i];
+
+        if( ( SPA_DATA_MemFd != d->type ) && ( SPA_DATA_DmaBuf != d->type ) )
+            continue;
+
+        fds[nfds].fd = (s32)d->fd;
+        fds[nfds].type = ( SPA_DATA_DmaBuf == d->type ) ? PWS_FD_TYPE_DMABUF : PWS_FD_TYPE_MEMFD;
+        fds[nfds].offset = d->mapoffset + d->chunk->offset;
+        fds[nfds].size = d->chunk->size;
+        nfds++;
+    }
+
+    return nfds;
+}
+/* }}} */
+
+/** @description: Current CLOCK_MONOTONIC time
+ *  @param[in]: None
+ *  @return: Time in nanoseconds
+ */
+/* {{{ pws_MonotonicNs() */
+static u64 pws_MonotonicNs( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+/* }}} */
+
+/** @description: Dequeue video frame from pipewire instance
+ *  @param[in]: pwsdata
+ *  @return: None
+ */
+/* {{{ pws_OnProcess() */
+static void pws_OnProcess(void *userdata)
+{
+    struct pws_data *pwsdata = NULL;
+    u64 receive_ts_ns = 0;
+
+    if(NULL == userdata )
+        return;
+
+    pwsdata = (struct pws_data *)userdata;
+
+    if( NULL == pwsdata->framering )
+        return;
+
+    PWS_RT_ENTER();
+
+    receive_ts_ns = pws_MonotonicNs();
+
+    pws_ProcessBuffer( pwsdata, receive_ts_ns );
+
+    pws_StatsRecord( &pwsdata->stats->process_ns, pws_MonotonicNs() - receive_ts_ns );
+
+    PWS_RT_LEAVE();
+}
+/* }}} */
+
+/** @description: Check whether the negotiated format is one pwstream reads
+ *  @param[in]: negotiated format
+ *  @return: true for H.264 or raw video, PCM or AAC audio
+ */
+/* {{{ pws_IsSupportedFormat() */
+static bool pws_IsSupportedFormat( const struct spa_video_info *format )
+{
+    if( SPA_MEDIA_TYPE_audio == format->media_type )
+        return ( SPA_MEDIA_SUBTYPE_raw == format->media_subtype ) ||
+               ( SPA_MEDIA_SUBTYPE_aac == format->media_subtype );
+
+    return ( SPA_MEDIA_SUBTYPE_raw == format->media_subtype ) ||
+           ( SPA_MEDIA_SUBTYPE_h264 == format->media_subtype );
+}
+/* }}} */
+
+/** @description: Apply the decimation mode to an incoming frame. Only an
+ *                H.264 frame that is due is looked at, and only up to its
+ *                first slice
+ *  @param[in]: pwsdata, spa buffer, frame data and size, standalone - the
+ *              frame decodes on its own (raw video, audio), receive time
+ *  @return: true to keep the frame
+ */
+/* {{{ pws_PassDecimation() */
+static bool pws_PassDecimation( struct pws_data *pwsdata, struct spa_buffer *buf, const u8 *data, u32 size,
+                                bool standalone, u64 receive_ts_ns )
+{
+    PWS_DECIMATE_MODE enmode = __atomic_load_n( &pwsdata->streamprop.endecimatemode, __ATOMIC_RELAXED );
+    u32 decimation = __atomic_load_n( &pwsdata->streamprop.decimation, __ATOMIC_RELAXED );
+    bool keyframe = standalone;
+    bool due = true;
+
+    if( PWS_DECIMATE_NONE == enmode )
+        return true;
+
+    pwsdata->decimatecount++;
+
+    if( PWS_DECIMATE_EVERY_NTH == enmode )
+        due = ( pwsdata->decimatecount >= decimation );
+    else if( PWS_DECIMATE_MAX_FPS == enmode )
+        due = ( receive_ts_ns >= pwsdata->decimatenext_ns );
+
+    if( false == due )
+        return false;
+
+    if( false == standalone )
+    {
+        pws_DmaBufSync( buf, DMA_BUF_SYNC_START );
+        keyframe = pws_H264IsKeyframe( data, size );
+        pws_DmaBufSync( buf, DMA_BUF_SYNC_END );
+    }
+
+    if( false == keyframe )
+        return false;
+
+    pwsdata->decimatecount = 0;
+
+    if( ( PWS_DECIMATE_MAX_FPS == enmode ) && ( 0 != decimation ) )
+    {
+        /* Keep the cadence, but never burst to catch up after a gap */
+        pwsdata->decimatenext_ns += SPA_NSEC_PER_SEC / decimation;
+
+        if( pwsdata->decimatenext_ns <= receive_ts_ns )
+            pwsdata->decimatenext_ns = receive_ts_ns + SPA_NSEC_PER_SEC / decimation;
+    }
+
+    return true;
+}
+/* }}} */
+
+/** @description: Samples per channel in an interleaved PCM frame
+ *  @param[in]: pwsdata, frame size in bytes
+ *  @return: Sample count, 0 for AAC or an unknown sample format
+ */
+/* {{{ pws_GetAudioSamples() */
+static u32 pws_GetAudioSamples( struct pws_data *pwsdata, u32 size )
+{
+    u32 bytes = 0;
+
+    if( SPA_MEDIA_SUBTYPE_raw != pwsdata->format.media_subtype )
+        return 0;
+
+    if( SPA_AUDIO_FORMAT_S16 == pwsdata->audioformat.format )
+        bytes = 2;
+    else if( ( SPA_AUDIO_FORMAT_S32 == pwsdata->audioformat.format ) ||
+             ( SPA_AUDIO_FORMAT_F32 == pwsdata->audioformat.format ) )
+        bytes = 4;
+
+    if( ( 0 == bytes ) || ( 0 == pwsdata->audioformat.channels ) )
+        return 0;
+
+    return size / ( bytes * pwsdata->audioformat.channels );
+}
+/* }}} */
+
+/** @description: Describe the planes of a raw video buffer. Buffers with a
+ *                data block per plane are taken as they are; a single block
+ *                holding a whole I420/NV12 image is split using its stride
+ *  @param[in]: pwsdata, spa buffer
+ *  @param[out]: planes
+ *  @return: Number of planes, 0 if the buffer is unusable
+ */
+/* {{{ pws_GetRawPlanes() */
+static u32 pws_GetRawPlanes( struct pws_data *pwsdata, struct spa_buffer *buf, pws_framePlane *planes )
+{
+    struct spa_data *d = NULL;
+    u32 height = pwsdata->format.info.raw.size.height;
+    u32 stride = 0;
+    u32 luma = 0;
+    u32 nplanes = 0;
+    u32 i = 0;
+
+    for( i = 0; ( i < buf->n_datas ) && ( i < PWS_MAX_PLANES ); i++ )
+    {
+        d = &buf->datas[i];
+
+        if( NULL == d->data )
+            return 0;
+
+        planes[i].data = (u8*)d->data + d->chunk->offset;
+        planes[i].offset = d->chunk->offset;
+        planes[i].stride = ( d->chunk->stride > 0 ) ? (u32)d->chunk->stride : pwsdata->format.info.raw.size.width;
+        planes[i].size = d->chunk->size;
+        nplanes++;
+    }
+
+    if( 1 != nplanes )
+        return nplanes;
+
+    stride = planes[0].stride;
+    luma = stride * height;
+
+    if( ( SPA_VIDEO_FORMAT_NV12 == pwsdata->format.info.raw.format ) && ( planes[0].size >= luma + luma / 2 ) )
+    {
+        planes[1].data = planes[0].data + luma;
+        planes[1].offset = planes[0].offset + luma;
+        planes[1].stride = stride;
+        planes[1].size = luma / 2;
+        planes[0].size = luma;
+        nplanes = 2;
+    }
+    else if( ( SPA_VIDEO_FORMAT_I420 == pwsdata->format.info.raw.format ) && ( planes[0].size >= luma + luma / 2 ) )
+    {
+        for( i = 1; i < 3; i++ )
+        {
+            planes[i].data = planes[0].data + luma + ( i - 1 ) * ( luma / 4 );
+            planes[i].offset = planes[0].offset + luma + ( i - 1 ) * ( luma / 4 );
+            planes[i].stride = stride / 2;
+            planes[i].size = luma / 4;
+        }
+        planes[0].size = luma;
+        nplanes = 3;
+    }
+
+    return nplanes;
+}
+/* }}} */
+
+/** @description: Copy planes back to back into dst, strides unchanged
+ *  @param[in]: source planes, plane count, destination
+ *  @param[out]: out - the planes as placed in dst
+ *  @return: Bytes copied
+ */
+/* {{{ pws_GatherPlanes() */
+static u32 pws_GatherPlanes( const pws_framePlane *src, u32 nplanes, u8 *dst, pws_framePlane *out )
+{
+    u32 pos = 0;
+    u32 i = 0;
+
+    for( i = 0; i < nplanes; i++ )
+    {
+        memcpy( dst + pos, src[i].data, src[i].size );
+
+        out[i] = src[i];
+        out[i].data = dst + pos;
+
+        pos += src[i].size;
+    }
+
+    return pos;
+}
+/* }}} */
+
+/** @description: Dequeue one buffer and queue its frame in the ring
+ *  @param[in]: pwsdata, time the process callback started
+ *  @return: None
+ */
+/* {{{ pws_ProcessBuffer() */
+static void pws_ProcessBuffer( struct pws_data *pwsdata, u64 receive_ts_ns )
+{
+    struct pw_buffer *b;
+    struct spa_buffer *buf;
+    struct pws_ring_slot *slot = NULL;
+    pws_framePlane planes[PWS_MAX_PLANES];
+    bool audio = ( SPA_MEDIA_TYPE_audio == pwsdata->format.media_type );
+    bool evicted = false;
+    bool syncpoint = true;
+    u32 ringflags = 0;
+    u8 *frame_data = NULL;
+    u32 frame_size = 0;
+    u32 nplanes = 0;
+    u32 i = 0;
+
+    /* Counted, not logged: logging could block the PipeWire thread */
+    if ((b = pw_stream_dequeue_buffer(pwsdata->stream)) == NULL)
+    {
+        pws_StatsAdd( &pwsdata->stats->dequeue_failures, 1 );
+        return;
+    }
+
+    buf = b->buffer;
+
+    if( ( buf->datas[0].data == NULL ) || ( false == pws_IsSupportedFormat( &pwsdata->format ) ) )
+    {
+        pw_stream_queue_buffer(pwsdata->stream, b);
+        return;
+    }
+
+    if( ( false == audio ) && ( SPA_MEDIA_SUBTYPE_raw == pwsdata->format.media_subtype ) )
+    {
+        nplanes = pws_GetRawPlanes( pwsdata, buf, planes );
+
+        if( 0 == nplanes )
+        {
+            pw_stream_queue_buffer(pwsdata->stream, b);
+            return;
+        }
+    }
+
+    pws_StatsAdd( &pwsdata->stats->frames_received, 1 );
+
+    if( PWS_STREAM_STREAMING != __atomic_load_n( &pwsdata->state, __ATOMIC_RELAXED ) )
+        pws_FirstFrame( pwsdata, receive_ts_ns );
+
+    pwsdata->lastreceive_ns = receive_ts_ns;
+
+    frame_data = (u8*)buf->datas[0].data + buf->datas[0].chunk->offset;
+    frame_size = buf->datas[0].chunk->size;
+
+    if( 0 != nplanes )
+    {
+        frame_size = 0;
+
+        for( i = 0; i < nplanes; i++ )
+            frame_size += planes[i].size;
+    }
+
+    /* Unwanted frames go straight back, before a slot or a copy */
+    if( false == pws_PassDecimation( pwsdata, buf, frame_data, frame_size,
+                                     ( true == audio ) || ( 0 != nplanes ), receive_ts_ns ) )
+    {
+        pws_StatsAdd( &pwsdata->stats->frames_filtered, 1 );
+        pw_stream_queue_buffer(pwsdata->stream, b);
+        return;
+    }
+
+    if( NULL != pwsdata->dispatch )
+    {
+        pws_CallbackFrame( pwsdata, b, frame_data, frame_size, planes, nplanes, audio, receive_ts_ns );
+        return;
+    }
+
+    if( NULL != pwsdata->fanout )
+    {
+        pws_PublishFrame( pwsdata, b, frame_data, frame_size, planes, nplanes, audio, receive_ts_ns );
+        return;
+    }
+
+    if( NULL != pwsdata->latest )
+    {
+        pws_LatestFrame( pwsdata, b, frame_data, frame_size, planes, nplanes, audio, receive_ts_ns );
+        return;
+    }
+
+    /* A zero-copy frame is lent through its buffer's mapping record */
+    if( ( true == pwsdata->streamprop.zerocopy ) && ( NULL == b->user_data ) )
+    {
+        pws_StatsAdd( &pwsdata->stats->frames_dropped, 1 );
+        pw_stream_queue_buffer(pwsdata->stream, b);
+        return;
+    }
+
+    /* The GOP policy needs to know what depends on what before it picks
+     * a slot; a raw or audio frame always stands alone */
+    if( ( PWS_OVERFLOW_DROP_GOP == pwsdata->streamprop.enoverflowpolicy ) &&
+        ( false == audio ) && ( 0 == nplanes ) )
+    {
+        pws_DmaBufSync( buf, DMA_BUF_SYNC_START );
+        syncpoint = pws_H264IsKeyframe( frame_data, frame_size );
+        pws_DmaBufSync( buf, DMA_BUF_SYNC_END );
+    }
+
+    /* Updating frame details in the next free ring slot. In copy mode the
+     * slot comes with room for the frame: once the oldest frame has been
+     * evicted nothing may stop the new one from being committed, or the
+     * notification count would stay a frame ahead of the ring */
+    slot = pws_RingProducerAcquire( pwsdata->framering, syncpoint,
+                                    ( true == pwsdata->streamprop.zerocopy ) ? 0 : frame_size, &ringflags );
+
+    evicted = ( 0 != ( ringflags & PWS_RING_EVICTED ) );
+
+    if( 0 != ( ringflags & PWS_RING_GOP_SKIPPED ) )
+        pws_StatsAdd( &pwsdata->stats->frames_gop_skipped, 1 );
+
+    if( 0 != ( ringflags & PWS_RING_GOP_STARTED ) )
+        pws_StatsAdd( &pwsdata->stats->gops_skipped, 1 );
+
+    if( NULL == slot )
+    {
+        if( 0 != ( ringflags & PWS_RING_NO_MEMORY ) )
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+
+        pws_StatsAdd( &pwsdata->stats->frames_dropped, 1 );
+        pw_stream_queue_buffer(pwsdata->stream, b);
+        return;
+    }
+
+    if( true == evicted )
+        pws_StatsAdd( &pwsdata->stats->frames_overwritten, 1 );
+
+    /* An evicted zero-copy frame still owns its PipeWire buffer */
+    if( NULL != slot->lentbuf )
+    {
+        pws_RequeueBuffer( pwsdata, slot->lentbuf );
+        slot->lentbuf = NULL;
+    }
+
+    slot->meta.nplanes = nplanes;
+    slot->meta.nfds = 0;
+
+    pws_DmaBufSync( buf, DMA_BUF_SYNC_START );
+
+    if( true == pwsdata->streamprop.zerocopy )
+    {
+        slot->info.frame_ptr = ( 0 != nplanes ) ? planes[0].data : frame_data;
+        slot->lentbuf = (struct pws_bufmap *)b->user_data;
+        slot->lentbuf->lent = true;
+        memcpy( slot->meta.plane, planes, nplanes * sizeof(pws_framePlane) );
+
+        /* Only a lent buffer can be imported by the reader */
+        slot->meta.nfds = pws_GetFrameFds( buf, slot->meta.fd );
+    }
+    else
+    {
+        /* The slot buffer only grows, a size class at a time, so once the
+         * largest frame has been seen ingest copies without allocating */
+        if( 0 != nplanes )
+            pws_GatherPlanes( planes, nplanes, slot->info.frame_ptr, slot->meta.plane );
+        else
+	    memcpy(slot->info.frame_ptr, frame_data, frame_size);
+
+        pws_StatsAdd( &pwsdata->stats->bytes_copied, frame_size );
+    }
+
+    slot->info.frame_size = frame_size;
+
+    pws_DescribeFrame( pwsdata, buf, audio, receive_ts_ns, &slot->info, &slot->meta );
+
+    if( NULL != pwsdata->history )
+        pws_HistoryAppend( pwsdata->history, &slot->info, slot->meta.capture_ts_ns,
+                           pws_IsSyncPoint( &slot->info, &slot->meta ) );
+
+    if( NULL != pwsdata->shmexport )
+        pws_ShmExportPublish( pwsdata->shmexport, &slot->info, &slot->meta, pws_IsSyncPoint( &slot->info, &slot->meta ) );
+
+    if( NULL != pwsdata->recorder )
+        pws_RecorderPublish( pwsdata->recorder, &slot->info, &slot->meta, pws_IsSyncPoint( &slot->info, &slot->meta ) );
+
+    pws_DmaBufSync( buf, DMA_BUF_SYNC_END );
+
+    /* An evicted frame was already counted. Level mode counts the frame
+     * before publishing it, so a reader never takes more than the counter */
+    if( ( false == evicted ) && ( PWS_NOTIFY_EDGE != pwsdata->streamprop.ennotifymode ) )
+        pws_SignalNotify( pwsdata );
+
+    pws_RingProducerCommit( pwsdata->framering );
+
+    if( ( false == evicted ) && ( PWS_NOTIFY_EDGE == pwsdata->streamprop.ennotifymode ) )
+        pws_SignalNotify( pwsdata );
+
+    pws_WakeReaders( pwsdata );
+
+    if( false == pwsdata->streamprop.zerocopy )
+        pw_stream_queue_buffer(pwsdata->stream, b);
+}
+/* }}} */
+
+/** @description: Fill in the frame details and ingest metadata of a frame
+ *                already copied or mapped. frame_ptr, frame_size and
+ *                meta->nplanes must be set
+ *  @param[in]: pwsdata, PipeWire buffer, audio stream, receive time
+ *  @param[out]: pstframeinfo, meta
+ *  @return: None
+ */
+/* {{{ pws_DescribeFrame() */
+static void pws_DescribeFrame( struct pws_data *pwsdata, struct spa_buffer *buf, bool audio, u64 receive_ts_ns,
+                               pws_frameInfo *pstframeinfo, struct pws_framemeta *meta )
+{
+    struct timeb timer_msec;
+    struct spa_meta_header *header = NULL;
+
+    if (!ftime(&timer_msec))
+    {
+       pstframeinfo->frame_timestamp = ((long long int) timer_msec.time) * 1000ll +
+                                            			(long long int) timer_msec.millitm;
+    }
+
+    meta->receive_ts_ns = receive_ts_ns;
+
+    header = (struct spa_meta_header *)spa_buffer_find_meta_data( buf, SPA_META_Header, sizeof(*header) );
+
+    if( ( NULL != header ) && ( header->pts >= 0 ) )
+    {
+        meta->capture_ts_ns = (u64)header->pts;
+        meta->tsflags = PWS_FRAME_TS_FROM_PRODUCER;
+    }
+    else
+    {
+        meta->capture_ts_ns = receive_ts_ns;
+        meta->tsflags = 0;
+    }
+
+    pstframeinfo->stream_type = PWS_STREAM_TYPE_VIDEO;
+
+    pstframeinfo->width = pwsdata->streamprop.width;
+    pstframeinfo->height = pwsdata->streamprop.height;
+
+    meta->nsamples = 0;
+
+    if( true == audio )
+    {
+        /* Every audio frame decodes on its own, like a raw video frame */
+        pstframeinfo->stream_type = PWS_STREAM_TYPE_AUDIO;
+        pstframeinfo->width = 0;
+        pstframeinfo->height = 0;
+        pstframeinfo->pic_type = PWS_PIC_TYPE_I_FRAME;
+        meta->nalindex.count = 0;
+        meta->nsamples = pws_GetAudioSamples( pwsdata, pstframeinfo->frame_size );
+    }
+    else if( 0 != meta->nplanes )
+    {
+        /* Every raw frame stands alone */
+        pstframeinfo->width = pwsdata->format.info.raw.size.width;
+        pstframeinfo->height = pwsdata->format.info.raw.size.height;
+        pstframeinfo->pic_type = PWS_PIC_TYPE_I_FRAME;
+        meta->nalindex.count = 0;
+    }
+    else
+    {
+        pstframeinfo->pic_type = pws_H264IndexFrame( pstframeinfo->frame_ptr, pstframeinfo->frame_size, &meta->nalindex );
+
+        pws_H264UpdateParamCache( pwsdata->paramcache, pstframeinfo->frame_ptr, &meta->nalindex );
+    }
+}
+/* }}} */
+
+/** @description: Copy a frame once into shared storage and hand it to every
+ *                reader handle. The PipeWire buffer goes straight back
+ *  @param[in]: pwsdata, PipeWire buffer, frame data and size, raw planes,
+ *              audio stream, receive time
+ *  @return: None
+ */
+/* {{{ pws_PublishFrame() */
+static void pws_PublishFrame( struct pws_data *pwsdata, struct pw_buffer *b, const u8 *data, u32 size,
+                              const pws_framePlane *planes, u32 nplanes, bool audio, u64 receive_ts_ns )
+{
+    struct pws_sharedframe *frame = NULL;
+    u32 lost = 0;
+
+    frame = pws_FanoutFrameCreate( pwsdata->fanout, size );
+
+    if( NULL == frame )
+    {
+	RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+        pws_StatsAdd( &pwsdata->stats->frames_dropped, 1 );
+        pw_stream_queue_buffer(pwsdata->stream, b);
+        return;
+    }
+
+    pws_DmaBufSync( b->buffer, DMA_BUF_SYNC_START );
+
+    if( 0 != nplanes )
+        pws_GatherPlanes( planes, nplanes, frame->info.frame_ptr, frame->meta.plane );
+    else
+        memcpy( frame->info.frame_ptr, data, size );
+
+    pws_DmaBufSync( b->buffer, DMA_BUF_SYNC_END );
+
+    pw_stream_queue_buffer(pwsdata->stream, b);
+
+    pws_StatsAdd( &pwsdata->stats->bytes_copied, size );
+
+    frame->meta.nplanes = nplanes;
+
+    pws_DescribeFrame( pwsdata, b->buffer, audio, receive_ts_ns, &frame->info, &frame->meta );
+
+    frame->syncpoint = pws_IsSyncPoint( &frame->info, &frame->meta );
+
+    if( NULL != pwsdata->history )
+        pws_HistoryAppend( pwsdata->history, &frame->info, frame->meta.capture_ts_ns, frame->syncpoint );
+
+    if( NULL != pwsdata->shmexport )
+        pws_ShmExportPublish( pwsdata->shmexport, &frame->info, &frame->meta, frame->syncpoint );
+
+    if( NULL != pwsdata->recorder )
+        pws_RecorderPublish( pwsdata->recorder, &frame->info, &frame->meta, frame->syncpoint );
+
+    lost = pws_FanoutPublish( pwsdata->fanout, frame );
+
+    if( 0 != lost )
+        pws_StatsAdd( &pwsdata->stats->frames_overwritten, lost );
+}
+/* }}} */
+
+/** @description: Copy a frame into the latest-frame handoff, replacing one
+ *                not taken yet. Never blocks or allocates; the history is
+ *                only trylocked. A frame larger than the slots is dropped
+ *                and counted
+ *  @param[in]: pwsdata, PipeWire buffer, frame data and size, raw planes,
+ *              audio stream, receive time
+ *  @return: None
+ */
+/* {{{ pws_LatestFrame() */
+static void pws_LatestFrame( struct pws_data *pwsdata, struct pw_buffer *b, const u8 *data, u32 size,
+                             const pws_framePlane *planes, u32 nplanes, bool audio, u64 receive_ts_ns )
+{
+    struct pws_ring_slot *slot = pws_TripleProducerSlot( pwsdata->latest );
+    bool syncpoint = false;
+
+    if( size > slot->capacity )
+    {
+        pws_StatsAdd( &pwsdata->stats->frames_dropped, 1 );
+        pw_stream_queue_buffer(pwsdata->stream, b);
+        return;
+    }
+
+    pws_DmaBufSync( b->buffer, DMA_BUF_SYNC_START );
+
+    if( 0 != nplanes )
+        pws_GatherPlanes( planes, nplanes, slot->info.frame_ptr, slot->meta.plane );
+    else
+        memcpy( slot->info.frame_ptr, data, size );
+
+    pws_DmaBufSync( b->buffer, DMA_BUF_SYNC_END );
+
+    pw_stream_queue_buffer(pwsdata->stream, b);
+
+    pws_StatsAdd( &pwsdata->stats->bytes_copied, size );
+
+    slot->info.frame_size = size;
+    slot->meta.nplanes = nplanes;
+    slot->meta.nfds = 0;
+
+    pws_DescribeFrame( pwsdata, b->buffer, audio, receive_ts_ns, &slot->info, &slot->meta );
+
+    syncpoint = pws_IsSyncPoint( &slot->info, &slot->meta );
+
+    /* The history only ever tries its lock from here */
+    if( NULL != pwsdata->history )
+        pws_HistoryAppend( pwsdata->history, &slot->info, slot->meta.capture_ts_ns, syncpoint );
+
+    if( NULL != pwsdata->shmexport )
+        pws_ShmExportPublish( pwsdata->shmexport, &slot->info, &slot->meta, syncpoint );
+
+    if( NULL != pwsdata->recorder )
+        pws_RecorderPublish( pwsdata->recorder, &slot->info, &slot->meta, syncpoint );
+
+    if( true == pws_TriplePublish( pwsdata->latest ) )
+        pws_StatsAdd( &pwsdata->stats->frames_overwritten, 1 );
+
+    pws_SignalNotify( pwsdata );
+    pws_WakeReaders( pwsdata );
+}
+/* }}} */
+
+/** @description: Hand a frame to the registered frame callback instead of
+ *                the ring. Inline, the callback sees the PipeWire buffer
+ *                itself, which goes back once it returns; for workers the
+ *                frame is copied once and the buffer goes straight back
+ *  @param[in]: pwsdata, PipeWire buffer, frame data and size, raw planes,
+ *              audio stream, receive time
+ *  @return: None
+ */
+/* {{{ pws_CallbackFrame() */
+static void pws_CallbackFrame( struct pws_data *pwsdata, struct pw_buffer *b, u8 *data, u32 size,
+                               const pws_framePlane *planes, u32 nplanes, bool audio, u64 receive_ts_ns )
+{
+    struct pws_dispatch *dispatch = pwsdata->dispatch;
+    struct pws_dispatchjob *job = NULL;
+    struct pws_framemeta meta;
+    pws_frameInfo info;
+    pws_frameInfoExt ext;
+    bool syncpoint = false;
+
+    meta.nplanes = nplanes;
+    meta.nfds = 0;
+
+    if( PWS_CALLBACK_INLINE == dispatch->enmode )
+    {
+        memset( &info, 0, sizeof(info) );
+
+        pws_DmaBufSync( b->buffer, DMA_BUF_SYNC_START );
+
+        info.frame_ptr = ( 0 != nplanes ) ? planes[0].data : data;
+        info.frame_size = size;
+        memcpy( meta.plane, planes, nplanes * sizeof(pws_framePlane) );
+        meta.nfds = pws_GetFrameFds( b->buffer, meta.fd );
+
+        pws_DescribeFrame( pwsdata, b->buffer, audio, receive_ts_ns, &info, &meta );
+
+        syncpoint = pws_IsSyncPoint( &info, &meta );
+
+        if( NULL != pwsdata->history )
+            pws_HistoryAppend( pwsdata->history, &info, meta.capture_ts_ns, syncpoint );
+
+        if( NULL != pwsdata->shmexport )
+            pws_ShmExportPublish( pwsdata->shmexport, &info, &meta, syncpoint );
+
+        if( NULL != pwsdata->recorder )
+            pws_RecorderPublish( pwsdata->recorder, &info, &meta, syncpoint );
+
+        pws_FillFrameInfoExt( pwsdata, &meta, &ext );
+        pws_CountDelivery( pwsdata, &meta, 0 );
+
+        dispatch->callback( &info, &ext, dispatch->userdata );
+
+        pws_DmaBufSync( b->buffer, DMA_BUF_SYNC_END );
+
+        pw_stream_queue_buffer(pwsdata->stream, b);
+        return;
+    }
+
+    job = pws_DispatchJobCreate( dispatch, size );
+
+    if( NULL == job )
+    {
+	RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+        pws_StatsAdd( &pwsdata->stats->frames_dropped, 1 );
+        pw_stream_queue_buffer(pwsdata->stream, b);
+        return;
+    }
+
+    pws_DmaBufSync( b->buffer, DMA_BUF_SYNC_START );
+
+    if( 0 != nplanes )
+        pws_GatherPlanes( planes, nplanes, job->info.frame_ptr, meta.plane );
+    else
+        memcpy( job->info.frame_ptr, data, size );
+
+    pws_DmaBufSync( b->buffer, DMA_BUF_SYNC_END );
+
+    pw_stream_queue_buffer(pwsdata->stream, b);
+
+    pws_StatsAdd( &pwsdata->stats->bytes_copied, size );
+
+    pws_DescribeFrame( pwsdata, b->buffer, audio, receive_ts_ns, &job->info, &meta );
+
+    syncpoint = pws_IsSyncPoint( &job->info, &meta );
+
+    if( NULL != pwsdata->history )
+        pws_HistoryAppend( pwsdata->history, &job->info, meta.capture_ts_ns, syncpoint );
+
+    if( NULL != pwsdata->shmexport )
+        pws_ShmExportPublish( pwsdata->shmexport, &job->info, &meta, syncpoint );
+
+    if( NULL != pwsdata->recorder )
+        pws_RecorderPublish( pwsdata->recorder, &job->info, &meta, syncpoint );
+
+    pws_FillFrameInfoExt( pwsdata, &meta, &job->ext );
+
+    if( PWS_SUCCESS != pws_DispatchQueue( dispatch, job ) )
+        pws_StatsAdd( &pwsdata->stats->frames_dropped, 1 );
+}
+/* }}} */
+
+/** @description: Take back a lent buffer on the loop thread. It is queued
+ *                to the stream again, or, if PipeWire removed it while it
+ *                was out, unmapped. That only happens to buffers of a
+ *                stream that is gone, never in steady state
+ *  @param[in]: pwsdata, buffer mapping record
+ *  @return: None
+ */
+/* {{{ pws_RequeueBuffer() */
+static void pws_RequeueBuffer( struct pws_data *pwsdata, struct pws_bufmap *map )
+{
+    map->lent = false;
+
+    if( NULL == map->pwbuf )
+    {
+        pws_UnmapBuffer( map );
+        return;
+    }
+
+    /* A buffer PipeWire still has belongs to the current stream */
+    if( NULL != pwsdata->stream )
+        pw_stream_queue_buffer(pwsdata->stream, map->pwbuf);
+}
+/* }}} */
+
+/** @description: Queue a zero-copy buffer back to its stream on the loop thread
+ *  @param[in]: loop, async, seq, buffer mapping record pointer, size, pwsdata
+ *  @return: 0
+ */
+/* {{{ pws_DoReturnBuffer() */
+static int pws_DoReturnBuffer( struct spa_loop *loop, bool async, uint32_t seq,
+                               const void *data, size_t size, void *user_data )
+{
+    struct pws_data *pwsdata = (struct pws_data *)user_data;
+    struct pws_bufmap *map = *(struct pws_bufmap * const *)data;
+
+    pws_RequeueBuffer( pwsdata, map );
+
+    return 0;
+}
+/* }}} */
+
+/** @description: No-op run on the loop thread to drain earlier invokes
+ *  @param[in]: loop, async, seq, data, size, pwsdata
+ *  @return: 0
+ */
+/* {{{ pws_DoFlush() */
+static int pws_DoFlush( struct spa_loop *loop, bool async, uint32_t seq,
+                        const void *data, size_t size, void *user_data )
+{
+    return 0;
+}
+/* }}} */
+
+/** @description: Give a zero-copy buffer back to PipeWire. The queue call is
+ *                marshalled onto the loop thread so it never races with
+ *                pws_OnProcess
+ *  @param[in]: pwsdata and buffer mapping record
+ *  @return: None
+ */
+/* {{{ pws_ReturnBuffer() */
+static void pws_ReturnBuffer( struct pws_data *pwsdata, struct pws_bufmap *map )
+{
+    pw_loop_invoke(pw_thread_loop_get_loop(pwsdata->loop), pws_DoReturnBuffer,
+                   0, &map, sizeof(map), false, pwsdata);
+}
+/* }}} */
+
+/** @description: Unmap buffers still lent out when the stream closes; the
+ *                stream they came from is already destroyed
+ *  @param[in]: pwsdata
+ *  @return: None
+ */
+/* {{{ pws_FreeLentBuffers() */
+static void pws_FreeLentBuffers( struct pws_data *pwsdata )
+{
+    u32 i = 0;
+
+    for( i = 0; ( NULL != pwsdata->framering ) && ( i < pwsdata->framering->depth ); i++ )
+    {
+        if( NULL != pwsdata->framering->slots[i].lentbuf )
+        {
+            pws_UnmapBuffer( pwsdata->framering->slots[i].lentbuf );
+            pwsdata->framering->slots[i].lentbuf = NULL;
+        }
+    }
+
+    for( i = 0; ( NULL != pwsdata->heldframes ) && ( i < pwsdata->streamprop.maxheldbuffers ); i++ )
+    {
+        if( NULL != pwsdata->heldframes[i].lentbuf )
+        {
+            pws_UnmapBuffer( pwsdata->heldframes[i].lentbuf );
+            pwsdata->heldframes[i].lentbuf = NULL;
+            pwsdata->heldframes[i].frame_ptr = NULL;
+        }
+    }
+
+    pwsdata->heldcount = 0;
+}
+/* }}} */
+
+/** @description: Notify the reader of a newly queued frame
+ *  @param[in]: pwsdata
+ *  @return: None
+ */
+/* {{{ pws_SignalNotify() */
+static void pws_SignalNotify( struct pws_data *pwsdata )
+{
+    u64 count = 1;
+
+    if( -1 == pwsdata->notifyfd )
+        return;
+
+    /* Edge mode: one write per batch, until the reader drains the ring */
+    if( ( PWS_NOTIFY_EDGE == pwsdata->streamprop.ennotifymode ) &&
+        ( 0 != __atomic_exchange_n( &pwsdata->notifysignaled, 1, __ATOMIC_ACQ_REL ) ) )
+        return;
+
+    write( pwsdata->notifyfd, &count, sizeof(count) );
+}
+/* }}} */
+
+/** @description: Consume the notification of frames taken from the ring
+ *  @param[in]: pwsdata, number of frames taken
+ *  @return: None
+ */
+/* {{{ pws_ConsumeNotify() */
+static void pws_ConsumeNotify( struct pws_data *pwsdata, u32 nframes )
+{
+    u64 count = 0;
+
+    if( -1 == pwsdata->notifyfd )
+        return;
+
+    if( PWS_NOTIFY_EDGE != pwsdata->streamprop.ennotifymode )
+    {
+        /* The read takes the whole counter, which is at least nframes; put
+         * back the frames still queued. Frames counted in between add up. */
+        if( ( sizeof(count) == read( pwsdata->notifyfd, &count, sizeof(count) ) ) && ( count > nframes ) )
+        {
+            count -= nframes;
+            write( pwsdata->notifyfd, &count, sizeof(count) );
+        }
+        return;
+    }
+
+    if( true == pws_FramesPending( pwsdata ) )
+        return;
+
+    /* Re-arm before draining; a frame queued after the drain signals again,
+     * one queued before it is caught by the recheck */
+    __atomic_store_n( &pwsdata->notifysignaled, 0, __ATOMIC_SEQ_CST );
+    read( pwsdata->notifyfd, &count, sizeof(count) );
+
+    if( true == pws_FramesPending( pwsdata ) )
+        pws_SignalNotify( pwsdata );
+}
+/* }}} */
+
+/** @description: Whether the reader has a frame to take
+ *  @param[in]: pwsdata
+ *  @return: true if a read would find a frame
+ */
+/* {{{ pws_FramesPending() */
+static bool pws_FramesPending( struct pws_data *pwsdata )
+{
+    if( NULL != pwsdata->latest )
+        return pws_TripleHasFresh( pwsdata->latest );
+
+    return ( 0 != pws_RingCount( pwsdata->framering ) );
+}
+/* }}} */
+
+/** @description: Account a frame handed to the reader
+ *  @param[in]: pwsdata, frame metadata, bytes copied for the reader
+ *  @return: None
+ */
+/* {{{ pws_CountDelivery() */
+static void pws_CountDelivery( struct pws_data *pwsdata, const struct pws_framemeta *meta, u32 copied )
+{
+    pws_StatsAdd( &pwsdata->stats->frames_delivered, 1 );
+
+    if( 0 != copied )
+        pws_StatsAdd( &pwsdata->stats->bytes_copied, copied );
+
+    pws_StatsRecord( &pwsdata->stats->latency_ns, pws_MonotonicNs() - meta->receive_ts_ns );
+}
+/* }}} */
+
+/** @description: Whether a reader can start decoding at this frame
+ *  @param[in]: frame info and metadata
+ *  @return: true for IDR, raw and audio frames
+ */
+/* {{{ pws_IsSyncPoint() */
+static bool pws_IsSyncPoint( const pws_frameInfo *pstframeinfo, const struct pws_framemeta *meta )
+{
+    return ( PWS_PIC_TYPE_IDR_FRAME == pstframeinfo->pic_type ) || ( 0 != meta->nplanes ) ||
+           ( PWS_STREAM_TYPE_AUDIO == pstframeinfo->stream_type );
+}
+/* }}} */
+
+/** @description: Skip to the next sync point when a PWS_OVERFLOW_DROP_GOP
+ *                eviction may have broken the frames queued behind it.
+ *                Called after every claim
+ *  @param[in]: pwsdata
+ *  @return: None
+ */
+/* {{{ pws_CheckResync() */
+static void pws_CheckResync( struct pws_data *pwsdata )
+{
+    if( true == pws_RingTakeResync( pwsdata->framering ) )
+    {
+        pwsdata->keyframepending = true;
+        pwsdata->gopresync = true;
+    }
+}
+/* }}} */
+
+/** @description: Claim the oldest queued frame. While a keyframe start is
+ *                pending, frames ahead of the next IDR are discarded since
+ *                the reader could not decode them
+ *  @param[in]: pwsdata
+ *  @param[out]: pslot - claimed slot, release with pws_RingConsumerDone
+ *               psyncframe - set for the IDR that ends a keyframe start
+ *  @return: true if a frame was claimed
+ */
+/* {{{ pws_ClaimFrame() */
+static bool pws_ClaimFrame( struct pws_data *pwsdata, struct pws_ring_slot **pslot, bool *psyncframe )
+{
+    struct pws_ring_slot *slot = NULL;
+
+    *psyncframe = false;
+
+    while( 0 != pws_RingConsumerClaim( pwsdata->framering, &slot, 1 ) )
+    {
+        pws_CheckResync( pwsdata );
+
+        if( ( false == pwsdata->keyframepending ) || ( true == pws_IsSyncPoint( &slot->info, &slot->meta ) ) )
+        {
+            *psyncframe = pwsdata->keyframepending;
+            pwsdata->keyframepending = false;
+            pwsdata->gopresync = false;
+            *pslot = slot;
+            return true;
+        }
+
+        if( true == pwsdata->gopresync )
+            pws_StatsAdd( &pwsdata->stats->frames_gop_skipped, 1 );
+
+        if( NULL != slot->lentbuf )
+        {
+            pws_ReturnBuffer( pwsdata, slot->lentbuf );
+            slot->lentbuf = NULL;
+        }
+
+        pws_RingConsumerDone( pwsdata->framering );
+        pws_ConsumeNotify( pwsdata, 1 );
+    }
+
+    return false;
+}
+/* }}} */
+
+/** @description: Work out which cached parameter sets an IDR lacks and fix
+ *                up its NAL index for them being prepended
+ *  @param[in]: pwsdata
+ *  @param[out]: pstparamsets - parameter set snapshot, sizes zeroed for
+ *               sets the frame already carries
+ *  @param[in,out]: pstnalindex - frame NAL index, shifted past the prefix
+ *  @return: Prefix size in bytes
+ */
+/* {{{ pws_GetKeyframePrefix() */
+static u32 pws_GetKeyframePrefix( struct pws_data *pwsdata, pws_paramSets *pstparamsets, pws_nalIndex *pstnalindex )
+{
+    pws_nalIndex frameindex = *pstnalindex;
+    u32 prefix_size = 0;
+    u32 i = 0;
+
+    pws_H264ReadParamCache( pwsdata->paramcache, pstparamsets );
+
+    if( true == pws_H264HasNal( &frameindex, PWS_NAL_TYPE_SPS ) )
+        pstparamsets->sps_size = 0;
+
+    if( true == pws_H264HasNal( &frameindex, PWS_NAL_TYPE_PPS ) )
+        pstparamsets->pps_size = 0;
+
+    pstnalindex->count = 0;
+
+    if( 0 != pstparamsets->sps_size )
+    {
+        pstnalindex->nal[pstnalindex->count].offset = PWS_PARAM_SET_PREFIX_LEN;
+        pstnalindex->nal[pstnalindex->count].length = pstparamsets->sps_size - PWS_PARAM_SET_PREFIX_LEN;
+        pstnalindex->nal[pstnalindex->count].type = PWS_NAL_TYPE_SPS;
+        pstnalindex->count++;
+        prefix_size += pstparamsets->sps_size;
+    }
+
+    if( 0 != pstparamsets->pps_size )
+    {
+        pstnalindex->nal[pstnalindex->count].offset = prefix_size + PWS_PARAM_SET_PREFIX_LEN;
+        pstnalindex->nal[pstnalindex->count].length = pstparamsets->pps_size - PWS_PARAM_SET_PREFIX_LEN;
+        pstnalindex->nal[pstnalindex->count].type = PWS_NAL_TYPE_PPS;
+        pstnalindex->count++;
+        prefix_size += pstparamsets->pps_size;
+    }
+
+    for( i = 0; ( i < frameindex.count ) && ( pstnalindex->count < PWS_MAX_NAL_UNITS ); i++ )
+    {
+        pstnalindex->nal[pstnalindex->count] = frameindex.nal[i];
+        pstnalindex->nal[pstnalindex->count].offset += prefix_size;
+        pstnalindex->count++;
+    }
+
+    return prefix_size;
+}
+/* }}} */
+
+/** @description: Write the parameter sets chosen by pws_GetKeyframePrefix
+ *  @param[in]: parameter sets, destination
+ *  @return: None
+ */
+/* {{{ pws_CopyKeyframePrefix() */
+static void pws_CopyKeyframePrefix( const pws_paramSets *pstparamsets, u8 *dst )
+{
+    memcpy( dst, pstparamsets->sps, pstparamsets->sps_size );
+    memcpy( dst + pstparamsets->sps_size, pstparamsets->pps, pstparamsets->pps_size );
+}
+/* }}} */
+
+/** @description: Expected size of the largest frame, for sizing the pool
+ *                before the first frame arrives
+ *  @param[in]: pwsdata
+ *  @return: Size in bytes
+ */
+/* {{{ pws_EstimateFrameSize() */
+static u32 pws_EstimateFrameSize( struct pws_data *pwsdata )
+{
+    u32 rawsize = pwsdata->streamprop.width * pwsdata->streamprop.height * 3 / 2;
+    u32 size = 0;
+
+    if( PWS_MEDIA_TYPE_FORMAT_AUDIO == pwsdata->streamprop.enMtypeformat )
+    {
+        if( PWS_MEDIA_SUBTYPE_FORMAT_AAC == pwsdata->streamprop.enMsubtypeformat )
+            return pwsdata->streamprop.channels * PWS_AAC_MAX_CHANNEL_BYTES + PWS_ADTS_HEADER_SIZE;
+
+        /* Sized for the widest sample format */
+        return pwsdata->streamprop.samplerate / PWS_AUDIO_FRAMES_PER_SEC * pwsdata->streamprop.channels * sizeof(u32);
+    }
+
+    /* I420 and NV12 both carry 12 bits per pixel */
+    if( PWS_MEDIA_SUBTYPE_FORMAT_RAW == pwsdata->streamprop.enMsubtypeformat )
+        return rawsize;
+
+    /* Without a bitrate assume a keyframe of about 2 bits per pixel */
+    if( 0 == pwsdata->streamprop.bitrate )
+        return rawsize / 6;
+
+    size = pwsdata->streamprop.bitrate / 8 / pwsdata->streamprop.framerate * PWS_POOL_KEYFRAME_FACTOR;
+
+    return ( size < rawsize ) ? size : rawsize;
+}
+/* }}} */
+
+/** @description: Make sure an application frame buffer holds size bytes.
+ *                With poolframebuffers it is a pool block that only grows,
+ *                otherwise it is realloc'd as before. Contents are not kept
+ *  @param[in]: pwsdata, application frame info, size
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_ReserveFrameBuffer() */
+static int pws_ReserveFrameBuffer( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo, u32 size )
+{
+    u8 *frame_ptr = NULL;
+
+    if( true == pwsdata->streamprop.poolframebuffers )
+    {
+        if( pws_PoolCapacity( pstframeinfo->frame_ptr ) >= size )
+            return PWS_SUCCESS;
+
+        frame_ptr = (u8*)pws_PoolAlloc( pwsdata->pool, size );
+
+        if( NULL == frame_ptr )
+            return PWS_FAILURE;
+
+        pws_PoolFree( pwsdata->pool, pstframeinfo->frame_ptr );
+    }
+    else
+    {
+        frame_ptr = (u8*)realloc( pstframeinfo->frame_ptr, size );
+
+        if( NULL == frame_ptr )
+            return PWS_FAILURE;
+    }
+
+    pstframeinfo->frame_ptr = frame_ptr;
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Copy a claimed frame out to the application, prefixed
+ *                with the cached SPS/PPS when it ends a keyframe start
+ *  @param[in]: pwsdata, claimed slot, syncframe and application frame info
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_CopySlot() */
+static int pws_CopySlot( struct pws_data *pwsdata, struct pws_ring_slot *slot, bool syncframe, pws_frameInfo *pstframeinfo )
+{
+    pws_paramSets paramsets;
+    u8 *frame_ptr = NULL;
+    u32 prefix_size = 0;
+
+    pwsdata->lastframe->meta = slot->meta;
+    pwsdata->lastframe->meta.nfds = 0;
+
+    /* A reader joining mid-stream gets the SPS/PPS it would otherwise miss */
+    if( ( true == syncframe ) && ( 0 == slot->meta.nplanes ) && ( PWS_STREAM_TYPE_VIDEO == slot->info.stream_type ) )
+        prefix_size = pws_GetKeyframePrefix( pwsdata, &paramsets, &pwsdata->lastframe->meta.nalindex );
+
+    pstframeinfo->stream_id = slot->info.stream_id;
+
+    pstframeinfo->stream_type = slot->info.stream_type;
+
+    pstframeinfo->pic_type = slot->info.pic_type;
+
+    pstframeinfo->width = slot->info.width;
+
+    pstframeinfo->height = slot->info.height;
+
+    pstframeinfo->frame_size = prefix_size + slot->info.frame_size;
+
+    pstframeinfo->frame_timestamp = slot->info.frame_timestamp;
+
+    if( PWS_SUCCESS != pws_ReserveFrameBuffer( pwsdata, pstframeinfo, pstframeinfo->frame_size ) )
+        return PWS_FAILURE;
+
+    frame_ptr = pstframeinfo->frame_ptr;
+
+    if( 0 != prefix_size )
+    {
+        pws_CopyKeyframePrefix( &paramsets, frame_ptr );
+    }
+
+    /* Zero-copy planes may sit in separate blocks; gather them */
+    if( 0 != slot->meta.nplanes )
+        pws_GatherPlanes( slot->meta.plane, slot->meta.nplanes, frame_ptr, pwsdata->lastframe->meta.plane );
+    else
+        memcpy( pstframeinfo->frame_ptr + prefix_size,
+                slot->info.frame_ptr,
+                slot->info.frame_size);
+
+    pwsdata->lastframe->frame_ptr = pstframeinfo->frame_ptr;
+
+    pws_CountDelivery( pwsdata, &slot->meta, pstframeinfo->frame_size );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Copy out the newest frame in latest-frame mode. Frames
+ *                published since the last read and never taken are gone;
+ *                on H.264 the reader then waits for the next IDR
+ *  @param[in]: pwsdata
+ *  @param[out]: pstframeinfo
+ *  @return: Macro - Success/Failure/Frame Not Ready
+ */
+/* {{{ pws_CopyLatest() */
+static int pws_CopyLatest( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo )
+{
+    struct pws_ring_slot *slot = NULL;
+    bool syncframe = false;
+    u64 missed = 0;
+    int ret = PWS_SUCCESS;
+
+    slot = pws_TripleTake( pwsdata->latest, &missed );
+
+    if( NULL == slot )
+        return PWS_FRAME_NOT_READY;
+
+    /* An encoded frame whose references were replaced cannot be decoded */
+    if( ( 0 != missed ) && ( 0 == slot->meta.nplanes ) && ( PWS_STREAM_TYPE_VIDEO == slot->info.stream_type ) )
+        pwsdata->keyframepending = true;
+
+    if( ( true == pwsdata->keyframepending ) && ( false == pws_IsSyncPoint( &slot->info, &slot->meta ) ) )
+    {
+        pws_ConsumeNotify( pwsdata, 1 );
+        return PWS_FRAME_NOT_READY;
+    }
+
+    syncframe = pwsdata->keyframepending;
+    pwsdata->keyframepending = false;
+
+    /* The slot is the reader's until the next take; no lock needed */
+    ret = pws_CopySlot( pwsdata, slot, syncframe, pstframeinfo );
+
+    pws_ConsumeNotify( pwsdata, 1 );
+
+    return ret;
+}
+/* }}} */
+
+/** @description: Copy the oldest queued frame out to the application
+ *  @param[in]: pwsdata and application frame info
+ *  @return: Macro - Success/Failure/Frame Not Ready
+ */
+/* {{{ pws_CopyFrame() */
+static int pws_CopyFrame( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo)
+{
+    struct pws_ring_slot *slot = NULL;
+    bool syncframe = false;
+    int ret = PWS_SUCCESS;
+
+    if( ( NULL == pwsdata ) || ( NULL == pstframeinfo ) || ( NULL == pwsdata->framering ) )
+        return PWS_FAILURE;
+
+    /* With reader handles every frame goes to the readers */
+    if( NULL != pwsdata->fanout )
+        return PWS_OPERATION_NOT_SUPPORTED;
+
+    if( NULL != pwsdata->latest )
+        return pws_CopyLatest( pwsdata, pstframeinfo );
+
+    /* Borrowed frames still hold the consumer side of the ring */
+    if( 0 != pwsdata->borrowedcount )
+        return PWS_BUFFER_LIMIT_REACHED;
+
+    if( false == pws_ClaimFrame( pwsdata, &slot, &syncframe ) )
+	return PWS_FRAME_NOT_READY;
+
+    ret = pws_CopySlot( pwsdata, slot, syncframe, pstframeinfo );
+
+    if( NULL != slot->lentbuf )
+    {
+        pws_ReturnBuffer( pwsdata, slot->lentbuf );
+        slot->lentbuf = NULL;
+    }
+
+    pws_RingConsumerDone( pwsdata->framering );
+
+    pws_ConsumeNotify( pwsdata, 1 );
+
+    if( PWS_SUCCESS != ret )
+    {
+	RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+    }
+
+    return ret;
+}
+/* }}} */
+
+/** @description: Get video frame from pwstream instance
+ *  @param[in]: pwsdata and application frame info
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_ReadFrame() */
+int pws_ReadFrame( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo)
+{
+    int ret = pws_CopyFrame( pwsdata, pstframeinfo );
+
+    if( PWS_FRAME_NOT_READY == ret )
+        RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) Frame Not Ready \n",__FILE__, __LINE__);
+
+    return ret;
+}
+/* }}} */
+
+/** @description: pws_ReadFrame for polling readers: does not log when no
+ *                frame is queued
+ *  @param[in]: pwsdata and application frame info
+ *  @return: Macro - Success/Failure/Frame Not Ready
+ */
+/* {{{ pws_TryReadFrame() */
+int pws_TryReadFrame( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo )
+{
+    return pws_CopyFrame( pwsdata, pstframeinfo );
+}
+/* }}} */
+
+/** @description: Hand a batch of claimed slots back to the producer
+ *  @param[in]: pwsdata, number of slots claimed
+ *  @return: None
+ */
+/* {{{ pws_FinishBatch() */
+static void pws_FinishBatch( struct pws_data *pwsdata, u32 nclaimed )
+{
+    u32 i = 0;
+
+    for( i = 0; i < nclaimed; i++ )
+    {
+        if( NULL != pwsdata->batchslots[i]->lentbuf )
+        {
+            pws_ReturnBuffer( pwsdata, pwsdata->batchslots[i]->lentbuf );
+            pwsdata->batchslots[i]->lentbuf = NULL;
+        }
+    }
+
+    pws_RingConsumerDone( pwsdata->framering );
+
+    pws_ConsumeNotify( pwsdata, nclaimed );
+}
+/* }}} */
+
+/** @description: Drain up to maxframes queued frames with one ring claim and
+ *                one notification read. Without flags each frame is copied
+ *                as by pws_ReadFrame. With PWS_READ_FLAG_BORROW frame_ptr
+ *                points at pwstream's own storage and nothing is copied;
+ *                the batch stays valid until pws_ReleaseFrames, and no other
+ *                frame can be read until then
+ *  @param[in]: pwsdata, maxframes, flags
+ *  @param[out]: pstframes - frames oldest first
+ *               iov - optional, maxframes entries set to the frame payloads
+ *                     for writev/sendmsg
+ *               pnframes - number of frames returned
+ *  @return: Macro - Success/Failure/Frame Not Ready/Buffer Limit Reached.
+ *           A copy that runs out of memory ends the batch early: the
+ *           frames copied so far come back with Success, and the rest are
+ *           dropped. Failure only when no frame could be copied
+ */
+/* {{{ pws_ReadFrames() */
+int pws_ReadFrames( struct pws_data *pwsdata, pws_frameInfo *pstframes, u32 maxframes, u32 flags,
+                    struct iovec *iov, u32 *pnframes )
+{
+    u32 nclaimed = 0;
+    u32 first = 0;
+    u32 i = 0;
+    int ret = PWS_SUCCESS;
+
+    if( ( NULL == pwsdata ) || ( NULL == pstframes ) || ( NULL == pnframes ) ||
+        ( NULL == pwsdata->framering ) || ( NULL == pwsdata->batchslots ) )
+        return PWS_FAILURE;
+
+    *pnframes = 0;
+
+    if( ( NULL != pwsdata->fanout ) || ( NULL != pwsdata->latest ) )
+        return PWS_OPERATION_NOT_SUPPORTED;
+
+    if( 0 != pwsdata->borrowedcount )
+        return PWS_BUFFER_LIMIT_REACHED;
+
+    if( maxframes > pwsdata->framering->depth )
+        maxframes = pwsdata->framering->depth;
+
+    nclaimed = pws_RingConsumerClaim( pwsdata->framering, pwsdata->batchslots, maxframes );
+
+    if( 0 == nclaimed )
+        return PWS_FRAME_NOT_READY;
+
+    pws_CheckResync( pwsdata );
+
+    /* Frames ahead of the first IDR are discarded, as in pws_ClaimFrame() */
+    if( true == pwsdata->keyframepending )
+    {
+        while( ( first < nclaimed ) &&
+               ( false == pws_IsSyncPoint( &pwsdata->batchslots[first]->info, &pwsdata->batchslots[first]->meta ) ) )
+            first++;
+
+        if( true == pwsdata->gopresync )
+            pws_StatsAdd( &pwsdata->stats->frames_gop_skipped, first );
+
+        if( first == nclaimed )
+        {
+            pws_FinishBatch( pwsdata, nclaimed );
+            return PWS_FRAME_NOT_READY;
+        }
+
+        for( i = 0; i < first; i++ )
+        {
+            if( NULL != pwsdata->batchslots[i]->lentbuf )
+            {
+                pws_ReturnBuffer( pwsdata, pwsdata->batchslots[i]->lentbuf );
+                pwsdata->batchslots[i]->lentbuf = NULL;
+            }
+        }
+    }
+
+    for( i = first; i < nclaimed; i++ )
+    {
+        if( 0 != ( flags & PWS_READ_FLAG_BORROW ) )
+        {
+            /* Lent as is: a zero-copy frame cannot be prefixed */
+            pstframes[i - first] = pwsdata->batchslots[i]->info;
+            pws_CountDelivery( pwsdata, &pwsdata->batchslots[i]->meta, 0 );
+        }
+        else if( PWS_SUCCESS != pws_CopySlot( pwsdata, pwsdata->batchslots[i],
+                                              ( i == first ) && pwsdata->keyframepending,
+                                              &pstframes[i - first] ) )
+        {
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+
+            /* The claim cannot be undone; the frames left are lost */
+            pws_StatsAdd( &pwsdata->stats->frames_dropped, nclaimed - i );
+
+            if( 0 == *pnframes )
+                ret = PWS_FAILURE;
+
+            break;
+        }
+
+        if( NULL != iov )
+        {
+            iov[i - first].iov_base = pstframes[i - first].frame_ptr;
+            iov[i - first].iov_len = pstframes[i - first].frame_size;
+        }
+
+        (*pnframes)++;
+    }
+
+    pwsdata->keyframepending = false;
+    pwsdata->gopresync = false;
+
+    if( ( 0 != ( flags & PWS_READ_FLAG_BORROW ) ) && ( PWS_SUCCESS == ret ) )
+    {
+        pwsdata->borrowedcount = nclaimed;
+        return PWS_SUCCESS;
+    }
+
+    pws_FinishBatch( pwsdata, nclaimed );
+
+    return ret;
+}
+/* }}} */
+
+/** @description: Release a batch borrowed with PWS_READ_FLAG_BORROW
+ *  @param[in]: pwsdata
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_ReleaseFrames() */
+int pws_ReleaseFrames( struct pws_data *pwsdata )
+{
+    if( ( NULL == pwsdata ) || ( NULL == pwsdata->framering ) )
+        return PWS_FAILURE;
+
+    if( 0 == pwsdata->borrowedcount )
+        return PWS_SUCCESS;
+
+    pws_FinishBatch( pwsdata, pwsdata->borrowedcount );
+
+    pwsdata->borrowedcount = 0;
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Wake readers sleeping in pws_ReadFrameTimeout
+ *  @param[in]: pwsdata
+ *  @return: None
+ */
+/* {{{ pws_WakeReaders() */
+static void pws_WakeReaders( struct pws_data *pwsdata )
+{
+    __atomic_fetch_add( &pwsdata->framesequence, 1, __ATOMIC_SEQ_CST );
+
+    /* Skip the syscall when nobody waits, which is the common case */
+    if( 0 != __atomic_load_n( &pwsdata->framewaiters, __ATOMIC_SEQ_CST ) )
+        syscall( SYS_futex, &pwsdata->framesequence, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0 );
+}
+/* }}} */
+
+/** @description: CLOCK_MONOTONIC deadline for a futex wait
+ *  @param[in]: timeout in nanoseconds
+ *  @param[out]: deadline
+ *  @return: deadline, or NULL for PWS_TIMEOUT_INFINITE
+ */
+/* {{{ pws_MakeDeadline() */
+static struct timespec *pws_MakeDeadline( u64 timeout_ns, struct timespec *deadline )
+{
+    if( PWS_TIMEOUT_INFINITE == timeout_ns )
+        return NULL;
+
+    clock_gettime( CLOCK_MONOTONIC, deadline );
+    deadline->tv_sec += timeout_ns / 1000000000ull;
+    deadline->tv_nsec += timeout_ns % 1000000000ull;
+
+    if( deadline->tv_nsec >= 1000000000L )
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+
+    return deadline;
+}
+/* }}} */
+
+/** @description: Read a frame, sleeping until one is queued or the timeout
+ *                expires. A timeout of 0 behaves like pws_TryReadFrame and
+ *                PWS_TIMEOUT_INFINITE waits for as long as it takes
+ *  @param[in]: pwsdata, application frame info, timeout in nanoseconds
+ *  @return: Macro - Success/Failure/Frame Not Ready on timeout
+ */
+/* {{{ pws_ReadFrameTimeout() */
+int pws_ReadFrameTimeout( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo, u64 timeout_ns )
+{
+    struct timespec deadline;
+    struct timespec *pdeadline = NULL;
+    u64 wait_start_ns = 0;
+    u32 sequence = 0;
+    int ret = PWS_FRAME_NOT_READY;
+
+    if( ( NULL == pwsdata ) || ( NULL == pstframeinfo ) )
+        return PWS_FAILURE;
+
+    pdeadline = pws_MakeDeadline( timeout_ns, &deadline );
+
+    for( ;; )
+    {
+        /* Sample before trying so a frame queued in between changes the
+         * word and the wait below returns at once */
+        sequence = __atomic_load_n( &pwsdata->framesequence, __ATOMIC_SEQ_CST );
+
+        ret = pws_CopyFrame( pwsdata, pstframeinfo );
+
+        if( ( PWS_FRAME_NOT_READY != ret ) || ( 0 == timeout_ns ) )
+            return ret;
+
+        __atomic_fetch_add( &pwsdata->framewaiters, 1, __ATOMIC_SEQ_CST );
+
+        wait_start_ns = pws_MonotonicNs();
+
+        if( ( -1 == syscall( SYS_futex, &pwsdata->framesequence, FUTEX_WAIT_BITSET_PRIVATE, sequence,
+                             pdeadline, NULL, FUTEX_BITSET_MATCH_ANY ) ) && ( ETIMEDOUT == errno ) )
+        {
+            __atomic_fetch_sub( &pwsdata->framewaiters, 1, __ATOMIC_SEQ_CST );
+            pws_StatsRecord( &pwsdata->stats->wait_ns, pws_MonotonicNs() - wait_start_ns );
+
+            /* A frame may have landed right at the deadline */
+            return pws_CopyFrame( pwsdata, pstframeinfo );
+        }
+
+        __atomic_fetch_sub( &pwsdata->framewaiters, 1, __ATOMIC_SEQ_CST );
+        pws_StatsRecord( &pwsdata->stats->wait_ns, pws_MonotonicNs() - wait_start_ns );
+    }
+}
+/* }}} */
+
+/** @description: Number of frames dropped because the ring was full
+ *  @param[in]: pwsdata
+ *  @param[out]: pdropped - dropped frame count
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_GetDroppedFrames() */
+int pws_GetDroppedFrames( struct pws_data *pwsdata, u64 *pdropped )
+{
+    if( ( NULL == pwsdata ) || ( NULL == pdropped ) || ( NULL == pwsdata->framering ) )
+        return PWS_FAILURE;
+
+    *pdropped = pws_RingDropped( pwsdata->framering );
+
+    if( NULL != pwsdata->latest )
+        *pdropped += pws_TripleOverwritten( pwsdata->latest );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Capture timestamp of the oldest queued frame, without
+ *                taking it. Audio and video streams share the clock, so a
+ *                muxer reads whichever stream is older first
+ *  @param[in]: pwsdata
+ *  @param[out]: pcapture_ts_ns - as pws_frameInfoExt.capture_ts_ns
+ *  @return: Macro - Success/Failure/Frame Not Ready
+ */
+/* {{{ pws_PeekFrameTimestamp() */
+int pws_PeekFrameTimestamp( struct pws_data *pwsdata, u64 *pcapture_ts_ns )
+{
+    if( ( NULL == pwsdata ) || ( NULL == pcapture_ts_ns ) || ( NULL == pwsdata->framering ) )
+        return PWS_FAILURE;
+
+    if( false == pws_RingPeekTimestamp( pwsdata->framering, pcapture_ts_ns ) )
+        return PWS_FRAME_NOT_READY;
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Change the decimation mode of a running stream. Takes
+ *                effect from the next frame PipeWire delivers
+ *  @param[in]: pwsdata, mode, N for EVERY_NTH or fps for MAX_FPS
+ *  @return: Macro - Success/Failure/Invalid Param
+ */
+/* {{{ pws_SetDecimation() */
+int pws_SetDecimation( struct pws_data *pwsdata, PWS_DECIMATE_MODE enmode, u32 decimation )
+{
+    if( NULL == pwsdata )
+        return PWS_FAILURE;
+
+    if( enmode > PWS_DECIMATE_MAX_FPS )
+        return PWS_INVALID_PARAM;
+
+    __atomic_store_n( &pwsdata->streamprop.decimation, decimation, __ATOMIC_RELAXED );
+    __atomic_store_n( &pwsdata->streamprop.endecimatemode, enmode, __ATOMIC_RELAXED );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Copy out the frame buffer pool usage
+ *  @param[in]: pwsdata
+ *  @param[out]: pststats
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_GetPoolStats() */
+int pws_GetPoolStats( struct pws_data *pwsdata, pws_poolStats *pststats )
+{
+    if( ( NULL == pwsdata ) || ( NULL == pststats ) || ( NULL == pwsdata->pool ) )
+        return PWS_FAILURE;
+
+    pws_PoolGetStats( pwsdata->pool, pststats );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Free a frame_ptr filled in by pws_ReadFrame,
+ *                pws_ReadFrames or pws_ReadFramesSince. Required instead of
+ *                free() when poolframebuffers is set
+ *  @param[in]: pwsdata, application frame info
+ *  @return: Macro - Success/Failure/Invalid Param
+ */
+/* {{{ pws_FreeFrameBuffer() */
+int pws_FreeFrameBuffer( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo )
+{
+    const struct pws_framemeta *meta = NULL;
+
+    if( ( NULL == pwsdata ) || ( NULL == pstframeinfo ) )
+        return PWS_FAILURE;
+
+    meta = pws_FindFrameMeta( pwsdata, pstframeinfo->frame_ptr );
+
+    /* Borrowed frames go back with pws_ReleaseFrame(s) or pws_ReaderRelease */
+    if( ( NULL != meta ) && ( meta != &pwsdata->lastframe->meta ) )
+        return PWS_INVALID_PARAM;
+
+    if( NULL != meta )
+        pwsdata->lastframe->frame_ptr = NULL;
+
+    if( true == pwsdata->streamprop.poolframebuffers )
+        pws_PoolFree( pwsdata->pool, pstframeinfo->frame_ptr );
+    else
+        free( pstframeinfo->frame_ptr );
+
+    pstframeinfo->frame_ptr = NULL;
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Copy out the stream counters and histograms. Lock-free;
+ *                counters are read one at a time while frames keep flowing
+ *  @param[in]: pwsdata
+ *  @param[out]: pststats
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_GetStats() */
+int pws_GetStats( struct pws_data *pwsdata, pws_streamStats *pststats )
+{
+    if( ( NULL == pwsdata ) || ( NULL == pststats ) || ( NULL == pwsdata->stats ) )
+        return PWS_FAILURE;
+
+    pws_StatsRead( pwsdata->stats, pststats );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Zero the stream counters and histograms
+ *  @param[in]: pwsdata
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_ResetStats() */
+int pws_ResetStats( struct pws_data *pwsdata )
+{
+    if( ( NULL == pwsdata ) || ( NULL == pwsdata->stats ) )
+        return PWS_FAILURE;
+
+    pws_StatsReset( pwsdata->stats );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Look up a frame the consumer currently has by its data
+ *  @param[in]: pwsdata and frame data pointer
+ *  @return: Held or last read frame, or NULL
+ */
+/* {{{ pws_FindFrame() */
+static struct pws_heldframe *pws_FindFrame( struct pws_data *pwsdata, const u8 *frame_ptr )
+{
+    u32 i = 0;
+
+    if( NULL == frame_ptr )
+        return NULL;
+
+    for( i = 0; ( NULL != pwsdata->heldframes ) && ( i < pwsdata->streamprop.maxheldbuffers ); i++ )
+    {
+        if( ( NULL != pwsdata->heldframes[i].lentbuf ) && ( frame_ptr == pwsdata->heldframes[i].frame_ptr ) )
+            return &pwsdata->heldframes[i];
+    }
+
+    if( ( NULL != pwsdata->lastframe ) && ( frame_ptr == pwsdata->lastframe->frame_ptr ) )
+        return pwsdata->lastframe;
+
+    return NULL;
+}
+/* }}} */
+
+/** @description: Look up the ingest metadata of a frame the consumer has:
+ *                held, last read, part of a borrowed batch or held by a
+ *                reader handle
+ *  @param[in]: pwsdata and frame data pointer
+ *  @return: Frame metadata, or NULL
+ */
+/* {{{ pws_FindFrameMeta() */
+static const struct pws_framemeta *pws_FindFrameMeta( struct pws_data *pwsdata, const u8 *frame_ptr )
+{
+    struct pws_heldframe *frame = pws_FindFrame( pwsdata, frame_ptr );
+    u32 i = 0;
+
+    if( NULL != frame )
+        return &frame->meta;
+
+    for( i = 0; ( NULL != frame_ptr ) && ( i < pwsdata->borrowedcount ); i++ )
+    {
+        if( frame_ptr == pwsdata->batchslots[i]->info.frame_ptr )
+            return &pwsdata->batchslots[i]->meta;
+    }
+
+    if( ( NULL != frame_ptr ) && ( NULL != pwsdata->fanout ) )
+        return pws_FanoutFindMeta( pwsdata->fanout, frame_ptr );
+
+    return NULL;
+}
+/* }}} */
+
+/** @description: Borrow the next video frame without copying it. frame_ptr
+ *                points into the PipeWire buffer, which is not given back
+ *                to the producer until pws_ReleaseFrame
+ *  @param[in]: pwsdata and application frame info
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_AcquireFrame() */
+int pws_AcquireFrame( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo )
+{
+    struct pws_ring_slot *slot = NULL;
+    bool syncframe = false;
+    u32 i = 0;
+
+    if( ( NULL == pwsdata ) || ( NULL == pstframeinfo ) || ( NULL == pwsdata->framering ) )
+        return PWS_FAILURE;
+
+    if( ( false == pwsdata->streamprop.zerocopy ) || ( NULL == pwsdata->heldframes ) )
+        return PWS_OPERATION_NOT_SUPPORTED;
+
+    if( ( pwsdata->heldcount >= pwsdata->streamprop.maxheldbuffers ) || ( 0 != pwsdata->borrowedcount ) )
+        return PWS_BUFFER_LIMIT_REACHED;
+
+    /* A zero-copy frame cannot be prefixed; a reader starting on an IDR
+     * takes the parameter sets from pws_GetParameterSets */
+    if( false == pws_ClaimFrame( pwsdata, &slot, &syncframe ) )
+	return PWS_FRAME_NOT_READY;
+
+    *pstframeinfo = slot->info;
+
+    pws_CountDelivery( pwsdata, &slot->meta, 0 );
+
+    for( i = 0; i < pwsdata->streamprop.maxheldbuffers; i++ )
+    {
+        if( NULL == pwsdata->heldframes[i].lentbuf )
+        {
+            pwsdata->heldframes[i].lentbuf = slot->lentbuf;
+            pwsdata->heldframes[i].frame_ptr = slot->info.frame_ptr;
+            pwsdata->heldframes[i].meta = slot->meta;
+            pwsdata->heldcount++;
+            break;
+        }
+    }
+
+    slot->lentbuf = NULL;
+
+    pws_RingConsumerDone( pwsdata->framering );
+
+    pws_ConsumeNotify( pwsdata, 1 );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Give a frame borrowed with pws_AcquireFrame back to PipeWire
+ *  @param[in]: pwsdata and application frame info
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_ReleaseFrame() */
+int pws_ReleaseFrame( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo )
+{
+    u32 i = 0;
+
+    if( ( NULL == pwsdata ) || ( NULL == pstframeinfo ) || ( NULL == pwsdata->heldframes ) )
+        return PWS_FAILURE;
+
+    for( i = 0; i < pwsdata->streamprop.maxheldbuffers; i++ )
+    {
+        if( ( NULL != pwsdata->heldframes[i].lentbuf ) &&
+            ( pstframeinfo->frame_ptr == pwsdata->heldframes[i].frame_ptr ) )
+        {
+            pws_ReturnBuffer( pwsdata, pwsdata->heldframes[i].lentbuf );
+
+            pwsdata->heldframes[i].lentbuf = NULL;
+            pwsdata->heldframes[i].frame_ptr = NULL;
+            pwsdata->heldcount--;
+
+            pstframeinfo->frame_ptr = NULL;
+
+            return PWS_SUCCESS;
+        }
+    }
+
+    return PWS_INVALID_PARAM;
+}
+/* }}} */
+
+/** @description: NAL index of a frame returned by pws_ReadFrame or
+ *                pws_AcquireFrame, computed once when the frame arrived
  *  @param[in]: pwsdata and application frame info
+ *  @param[out]: pstnalindex - NAL units, offsets relative to frame_ptr
  *  @return: Macro - Success/Failure
  */
-/* {{{ pws_ReadFrame() */
-int pws_ReadFrame( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo)
+/* {{{ pws_GetFrameNalIndex() */
+int pws_GetFrameNalIndex( struct pws_data *pwsdata, const pws_frameInfo *pstframeinfo, pws_nalIndex *pstnalindex )
+{
+    const struct pws_framemeta *meta = NULL;
+
+    if( ( NULL == pwsdata ) || ( NULL == pstframeinfo ) || ( NULL == pstnalindex ) )
+        return PWS_FAILURE;
+
+    meta = pws_FindFrameMeta( pwsdata, pstframeinfo->frame_ptr );
+
+    if( NULL == meta )
+        return PWS_INVALID_PARAM;
+
+    *pstnalindex = meta->nalindex;
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Fill a whole current-version pws_frameInfoExt from the
+ *                ingest metadata of a frame
+ *  @param[in]: pwsdata, meta
+ *  @param[out]: pstframeinfoext
+ *  @return: None
+ */
+/* {{{ pws_FillFrameInfoExt() */
+static void pws_FillFrameInfoExt( struct pws_data *pwsdata, const struct pws_framemeta *meta, pws_frameInfoExt *pstframeinfoext )
 {
-    if( ( NULL == pwsdata ) || ( NULL == pstframeinfo ) )
-        return PWS_FAILURE;
+    memset( pstframeinfoext, 0, sizeof(pws_frameInfoExt) );
+
+    pstframeinfoext->version = PWS_FRAME_INFO_EXT_VERSION;
+    pstframeinfoext->size = sizeof(pws_frameInfoExt);
+    pstframeinfoext->capture_ts_ns = meta->capture_ts_ns;
+    pstframeinfoext->receive_ts_ns = meta->receive_ts_ns;
+    pstframeinfoext->flags = meta->tsflags;
+    pstframeinfoext->nplanes = meta->nplanes;
+    memcpy( pstframeinfoext->plane, meta->plane, meta->nplanes * sizeof(pws_framePlane) );
+    pstframeinfoext->nfds = meta->nfds;
+    memcpy( pstframeinfoext->fd, meta->fd, meta->nfds * sizeof(pws_frameFd) );
 
-    if( !pwsdata->isH264FrameReady )
+    if( SPA_MEDIA_TYPE_audio == pwsdata->format.media_type )
     {
-        RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) Frame Not Ready \n",__FILE__, __LINE__);
-	return PWS_FRAME_NOT_READY;
+        pstframeinfoext->samplerate = pwsdata->audioformat.rate;
+        pstframeinfoext->channels = pwsdata->audioformat.channels;
+        pstframeinfoext->nsamples = meta->nsamples;
+    }
+    else if( SPA_MEDIA_SUBTYPE_raw == pwsdata->format.media_subtype )
+    {
+        pstframeinfoext->framerate_num = pwsdata->format.info.raw.framerate.num;
+        pstframeinfoext->framerate_denom = pwsdata->format.info.raw.framerate.denom;
     }
+    else
+    {
+        pstframeinfoext->framerate_num = pwsdata->format.info.h264.framerate.num;
+        pstframeinfoext->framerate_denom = pwsdata->format.info.h264.framerate.denom;
+    }
+}
+/* }}} */
+
+/** @description: Extended information for a frame the consumer currently
+ *                has. The caller sets pstframeinfoext->size to the size of
+ *                its structure; fields beyond it are left untouched and
+ *                version reports the layout pwstream filled
+ *  @param[in]: pwsdata, frame returned by a read
+ *  @param[in,out]: pstframeinfoext
+ *  @return: Macro - Success/Failure/Invalid Param for an unknown frame
+ */
+/* {{{ pws_GetFrameInfoExt() */
+int pws_GetFrameInfoExt( struct pws_data *pwsdata, const pws_frameInfo *pstframeinfo, pws_frameInfoExt *pstframeinfoext )
+{
+    const struct pws_framemeta *meta = NULL;
+    pws_frameInfoExt ext;
+    u32 size = 0;
+
+    if( ( NULL == pwsdata ) || ( NULL == pstframeinfo ) || ( NULL == pstframeinfoext ) )
+        return PWS_FAILURE;
+
+    if( pstframeinfoext->size < PWS_FRAME_INFO_EXT_V1_SIZE )
+        return PWS_INVALID_PARAM;
+
+    meta = pws_FindFrameMeta( pwsdata, pstframeinfo->frame_ptr );
+
+    if( NULL == meta )
+        return PWS_INVALID_PARAM;
+
+    pws_FillFrameInfoExt( pwsdata, meta, &ext );
+
+    size = ( pstframeinfoext->size < sizeof(ext) ) ? pstframeinfoext->size : sizeof(ext);
+    ext.size = size;
+
+    memcpy( pstframeinfoext, &ext, size );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
 
-    if ( pthread_mutex_lock( &pws_videoframelock ) != 0 )
+/** @description: Latest SPS/PPS seen on the stream, without copying a frame
+ *  @param[in]: pwsdata
+ *  @param[out]: pstparamsets - Annex-B parameter sets, sizes 0 until seen
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_GetParameterSets() */
+int pws_GetParameterSets( struct pws_data *pwsdata, pws_paramSets *pstparamsets )
+{
+    if( ( NULL == pwsdata ) || ( NULL == pstparamsets ) || ( NULL == pwsdata->paramcache ) )
         return PWS_FAILURE;
 
-    pstframeinfo->stream_id = pwsdata->intermediateFrameInfoH264->stream_id;
+    pws_H264ReadParamCache( pwsdata->paramcache, pstparamsets );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Make the next read start at an IDR, as for a new reader.
+ *                Queued frames ahead of it are discarded, and pws_ReadFrame
+ *                prepends the cached SPS/PPS the IDR does not carry
+ *  @param[in]: pwsdata
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_SyncToKeyframe() */
+int pws_SyncToKeyframe( struct pws_data *pwsdata )
+{
+    if( NULL == pwsdata )
+        return PWS_FAILURE;
 
-    pstframeinfo->stream_type = pwsdata->intermediateFrameInfoH264->stream_type;
+    pwsdata->keyframepending = true;
 
-    pstframeinfo->pic_type = pwsdata->intermediateFrameInfoH264->pic_type;
+    return PWS_SUCCESS;
+}
+/* }}} */
 
-    pstframeinfo->width = pwsdata->intermediateFrameInfoH264->width;
+/* Output of a pws_ReadFramesSince walk */
+struct pws_historycopy
+{
+    struct pws_data *pwsdata;
+    pws_frameInfo *frames;
+    u32 maxframes;
+    u32 nframes;
+    bool failed;
+};
 
-    pstframeinfo->height = pwsdata->intermediateFrameInfoH264->height;
+/** @description: History walk callback copying each frame out for
+ *                pws_ReadFramesSince
+ *  @param[in]: frame, pws_historycopy
+ *  @return: 0 to continue, 1 when the output is full or out of memory
+ */
+/* {{{ pws_CopyHistoryFrame() */
+static int pws_CopyHistoryFrame( const pws_frameInfo *pstframeinfo, void *userdata )
+{
+    struct pws_historycopy *copy = (struct pws_historycopy *)userdata;
+    pws_frameInfo *out = NULL;
+    u8 *frame_ptr = NULL;
 
-    pstframeinfo->frame_size = pwsdata->intermediateFrameInfoH264->frame_size;
+    if( copy->nframes == copy->maxframes )
+        return 1;
 
-    pstframeinfo->frame_timestamp = pwsdata->intermediateFrameInfoH264->frame_timestamp;
+    out = &copy->frames[copy->nframes];
 
-    if( NULL == pstframeinfo->frame_ptr )
+    if( PWS_SUCCESS != pws_ReserveFrameBuffer( copy->pwsdata, out, pstframeinfo->frame_size ) )
     {
-       pstframeinfo->frame_ptr  = (u8*)malloc(pstframeinfo->frame_size);
+        copy->failed = true;
+        return 1;
     }
-    else
+
+    frame_ptr = out->frame_ptr;
+
+    memcpy( frame_ptr, pstframeinfo->frame_ptr, pstframeinfo->frame_size );
+
+    *out = *pstframeinfo;
+    out->frame_ptr = frame_ptr;
+
+    copy->nframes++;
+
+    return 0;
+}
+/* }}} */
+
+/** @description: Copy out the pre-roll history from the IDR captured at or
+ *                before capture_ts_ns up to the newest frame. Like
+ *                pws_ReadFrame, each frame_ptr is (re)allocated and owned by
+ *                the caller
+ *  @param[in]: pwsdata, capture_ts_ns (as in pws_frameInfoExt, so a wall
+ *              clock step cannot reorder the history), maxframes
+ *  @param[out]: pstframes - frames oldest first, pnframes - count written
+ *  @return: Macro - Success/Failure/Frame Not Ready/Not Supported
+ */
+/* {{{ pws_ReadFramesSince() */
+int pws_ReadFramesSince( struct pws_data *pwsdata, u64 capture_ts_ns, pws_frameInfo *pstframes, u32 maxframes, u32 *pnframes )
+{
+    struct pws_historycopy copy = { pwsdata, pstframes, maxframes, 0, false };
+    int ret = PWS_SUCCESS;
+
+    if( ( NULL == pwsdata ) || ( NULL == pstframes ) || ( NULL == pnframes ) )
+        return PWS_FAILURE;
+
+    *pnframes = 0;
+
+    if( NULL == pwsdata->history )
+        return PWS_OPERATION_NOT_SUPPORTED;
+
+    ret = pws_HistoryIterate( pwsdata->history, capture_ts_ns, pws_CopyHistoryFrame, &copy );
+
+    *pnframes = copy.nframes;
+
+    if( true == copy.failed )
     {
-        pstframeinfo->frame_ptr  = (u8*)realloc( pstframeinfo->frame_ptr, pstframeinfo->frame_size);
+	RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to allocate memory \n",__FILE__, __LINE__);
+        return PWS_FAILURE;
     }
 
-    memset( pstframeinfo->frame_ptr,0,pstframeinfo->frame_size);
+    return ret;
+}
+/* }}} */
+
+/** @description: Walk the pre-roll history from the IDR captured at or
+ *                before capture_ts_ns without copying. Ingest keeps running
+ *                but stops storing history until the next IDR once the walk
+ *                overlaps a frame, so keep the callback short
+ *  @param[in]: pwsdata, capture_ts_ns (as in pws_frameInfoExt), callback, userdata
+ *  @return: Macro - Success/Failure/Frame Not Ready/Not Supported
+ */
+/* {{{ pws_IterateFramesSince() */
+int pws_IterateFramesSince( struct pws_data *pwsdata, u64 capture_ts_ns, pws_historyCallback callback, void *userdata )
+{
+    if( ( NULL == pwsdata ) || ( NULL == callback ) )
+        return PWS_FAILURE;
+
+    if( NULL == pwsdata->history )
+        return PWS_OPERATION_NOT_SUPPORTED;
+
+    return pws_HistoryIterate( pwsdata->history, capture_ts_ns, callback, userdata );
+}
+/* }}} */
+
+/** @description: Open a reader handle on a stream started with maxreaders
+ *                set. Each reader sees every frame from the time it opens,
+ *                independently of the others, unless it falls readerlag
+ *                frames behind
+ *  @param[in]: pwsdata
+ *  @return: Reader handle, or NULL when maxreaders are already open
+ */
+/* {{{ pws_ReaderOpen() */
+struct pws_reader *pws_ReaderOpen( struct pws_data *pwsdata )
+{
+    struct pws_reader *reader = NULL;
 
-    memcpy( pstframeinfo->frame_ptr,
-            pwsdata->intermediateFrameInfoH264->frame_ptr,
-	    pstframeinfo->frame_size);
+    if( ( NULL == pwsdata ) || ( NULL == pwsdata->fanout ) )
+        return NULL;
 
+    reader = pws_FanoutAddReader( pwsdata->fanout, pwsdata->streamprop.keyframestart,
+                                  pwsdata->streamprop.maxheldbuffers );
 
-    // read one byte from pipe
-    if (pwsdata->pws_fd[0] != -1)
+    if( NULL == reader )
     {
-        char rbuf[1] ={0};
-        read(pwsdata->pws_fd[0], rbuf, 1);
+	RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to open reader on %s \n",__FILE__, __LINE__, pwsdata->streamprop.stream_name);
+        return NULL;
     }
 
-    pwsdata->isH264FrameReady = false;
+    reader->pwsdata = pwsdata;
+
+    return reader;
+}
+/* }}} */
+
+/** @description: eventfd of a reader, readable while it has frames to read.
+ *                Edge triggered: read until PWS_FRAME_NOT_READY
+ *  @param[in]: reader
+ *  @return: File Descriptor, or PWS_FAILURE
+ */
+/* {{{ pws_ReaderGetFd() */
+int pws_ReaderGetFd( struct pws_reader *reader )
+{
+    if( NULL == reader )
+        return PWS_FAILURE;
+
+    return reader->notifyfd;
+}
+/* }}} */
+
+/** @description: Borrow the reader's next frame. frame_ptr points into
+ *                storage shared with the other readers; do not write to it.
+ *                It stays valid until pws_ReaderRelease, at most
+ *                maxheldbuffers at a time
+ *  @param[in]: reader
+ *  @param[out]: pstframeinfo
+ *  @return: Macro - Success/Failure/Frame Not Ready/Buffer Limit Reached
+ */
+/* {{{ pws_ReaderRead() */
+int pws_ReaderRead( struct pws_reader *reader, pws_frameInfo *pstframeinfo )
+{
+    struct pws_sharedframe *frame = NULL;
+    int ret = PWS_SUCCESS;
+
+    if( ( NULL == reader ) || ( NULL == pstframeinfo ) )
+        return PWS_FAILURE;
+
+    ret = pws_FanoutRead( reader, &frame );
 
-    pthread_mutex_unlock( &pws_videoframelock );
+    if( PWS_SUCCESS != ret )
+        return ret;
+
+    *pstframeinfo = frame->info;
+
+    pws_CountDelivery( reader->pwsdata, &frame->meta, 0 );
 
     return PWS_SUCCESS;
 }
 /* }}} */
 
-/** @description: To release Frame buffer
- *  @param[in]: pwsdata and application frame info
+/** @description: Give back a frame from pws_ReaderRead
+ *  @param[in]: reader, frame info
+ *  @return: Macro - Success/Failure/Invalid Param
+ */
+/* {{{ pws_ReaderRelease() */
+int pws_ReaderRelease( struct pws_reader *reader, pws_frameInfo *pstframeinfo )
+{
+    int ret = PWS_SUCCESS;
+
+    if( ( NULL == reader ) || ( NULL == pstframeinfo ) )
+        return PWS_FAILURE;
+
+    ret = pws_FanoutRelease( reader, pstframeinfo->frame_ptr );
+
+    if( PWS_SUCCESS == ret )
+        pstframeinfo->frame_ptr = NULL;
+
+    return ret;
+}
+/* }}} */
+
+/** @description: Frames this reader missed by falling more than readerlag
+ *                frames behind
+ *  @param[in]: reader
+ *  @param[out]: pdropped
  *  @return: Macro - Success/Failure
  */
-/* {{{ pws_StreamClose() */
-int pws_StreamClose( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo )
+/* {{{ pws_ReaderGetDropped() */
+int pws_ReaderGetDropped( struct pws_reader *reader, u64 *pdropped )
+{
+    if( ( NULL == reader ) || ( NULL == pdropped ) )
+        return PWS_FAILURE;
+
+    pthread_mutex_lock( &reader->fanout->lock );
+    *pdropped = reader->dropped;
+    pthread_mutex_unlock( &reader->fanout->lock );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Close a reader handle and release the frames it holds.
+ *                Handles still open at pws_StreamClose are closed there and
+ *                must not be used afterwards
+ *  @param[in]: reader
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_ReaderClose() */
+int pws_ReaderClose( struct pws_reader *reader )
+{
+    if( NULL == reader )
+        return PWS_FAILURE;
+
+    pws_FanoutRemoveReader( reader );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Push frames to a callback instead of queueing them for
+ *                pws_ReadFrame and reader handles; history and shared
+ *                memory export still see every frame. Call after
+ *                pws_StreamInit, never from inside the callback.
+ *
+ *                PWS_CALLBACK_INLINE runs the callback on the PipeWire
+ *                thread during the process callback, on the producer's
+ *                buffer, with no copy and no wakeup. Frames arrive one at
+ *                a time in stream order. The PipeWire thread is shared by
+ *                every stream in the process, so a slow callback stalls all
+ *                of them; keep it short and non-blocking.
+ *
+ *                PWS_CALLBACK_WORKERS copies each frame once and hands it to
+ *                nworkers threads. Frames are taken in stream order, but
+ *                with more than one worker callbacks run concurrently and
+ *                may finish out of order; use one worker, or capture_ts_ns,
+ *                where order matters. At most ringdepth frames wait for a
+ *                worker; further frames are dropped and counted in
+ *                frames_dropped.
+ *  @param[in]: pwsdata, callback (NULL to unregister), userdata,
+ *              enmode, nworkers (workers mode, 1 to PWS_MAX_CALLBACK_WORKERS)
+ *  @return: Macro - Success/Failure/Invalid Param
+ */
+/* {{{ pws_SetFrameCallback() */
+int pws_SetFrameCallback( struct pws_data *pwsdata, pws_frameCallback callback, void *userdata,
+                          PWS_CALLBACK_MODE enmode, u32 nworkers )
 {
-    if ( pthread_mutex_lock( &pws_videoframelock ) != 0 )
+    struct pws_dispatch *dispatch = NULL;
+    struct pws_dispatch *previous = NULL;
+
+    if( NULL == pwsdata )
+        return PWS_FAILURE;
+
+    if( ( NULL != callback ) && ( NULL == pwsdata->loop ) )
         return PWS_FAILURE;
 
-    if( NULL != pwsdata->intermediateFrameInfoH264 )
+    if( ( NULL != callback ) && ( PWS_CALLBACK_WORKERS == enmode ) &&
+        ( ( 0 == nworkers ) || ( nworkers > PWS_MAX_CALLBACK_WORKERS ) ) )
+        return PWS_INVALID_PARAM;
+
+    if( ( PWS_CALLBACK_INLINE != enmode ) && ( PWS_CALLBACK_WORKERS != enmode ) )
+        return PWS_INVALID_PARAM;
+
+    if( NULL != callback )
     {
-        if( NULL != pwsdata->intermediateFrameInfoH264->frame_ptr )
-	{
-	    free( pwsdata->intermediateFrameInfoH264->frame_ptr );
-	    pwsdata->intermediateFrameInfoH264->frame_ptr = NULL;
-	}
+        dispatch = pws_DispatchCreate( callback, userdata, enmode, nworkers, pwsdata->streamprop.ringdepth,
+                                       pwsdata->stats, pwsdata->pool );
 
-	free( pwsdata->intermediateFrameInfoH264 );
-        pwsdata->intermediateFrameInfoH264 = NULL;
+        if( ( NULL == dispatch ) ||
+            ( PWS_SUCCESS != pws_DispatchPrealloc( dispatch, pws_EstimateFrameSize( pwsdata ) ) ) )
+        {
+	    RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to set up frame callback \n",__FILE__, __LINE__);
+            pws_DispatchDestroy( dispatch );
+            return PWS_FAILURE;
+        }
     }
 
+    /* The process callback runs under the loop lock, so once the swap is
+     * done the previous dispatch gets no more frames */
+    if( NULL != pwsdata->loop )
+        pw_thread_loop_lock(pwsdata->loop);
 
-    if( NULL != pstframeinfo )
+    previous = pwsdata->dispatch;
+    pwsdata->dispatch = dispatch;
+
+    if( NULL != pwsdata->loop )
+        pw_thread_loop_unlock(pwsdata->loop);
+
+    /* Waits for callbacks still running on its workers */
+    pws_DispatchDestroy( previous );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Start writing the stream's H.264 frames to segment files.
+ *                Frames are taken at ingest, whatever the consumer reads,
+ *                and written by the recorder's own thread
+ *  @param[in]: pwsdata, pstconfig
+ *  @return: Macro - Success/Failure, Operation Not Supported on raw video
+ *           and audio streams
+ */
+/* {{{ pws_RecordStart() */
+int pws_RecordStart( struct pws_data *pwsdata, const pws_recordConfig *pstconfig )
+{
+    struct pws_recorder *rec = NULL;
+    bool started = false;
+
+    if( ( NULL == pwsdata ) || ( NULL == pwsdata->loop ) )
+        return PWS_FAILURE;
+
+    if( ( NULL == pstconfig ) || ( NULL == pstconfig->directory ) )
+        return PWS_INVALID_PARAM;
+
+    if( ( PWS_MEDIA_TYPE_FORMAT_VIDEO != pwsdata->streamprop.enMtypeformat ) ||
+        ( PWS_MEDIA_SUBTYPE_FORMAT_H264 != pwsdata->streamprop.enMsubtypeformat ) )
+        return PWS_OPERATION_NOT_SUPPORTED;
+
+    rec = pws_RecorderCreate( pstconfig, pwsdata->streamprop.framerate, pwsdata->stats, pwsdata->paramcache );
+
+    if( NULL == rec )
     {
-	free(pstframeinfo->frame_ptr);
-	pstframeinfo->frame_ptr = NULL;
+	RDK_LOG(RDK_LOG_ERROR,"LOG.RDK.PWSTREAM","%s(%d) : Failed to start recording \n",__FILE__, __LINE__);
+        return PWS_FAILURE;
+    }
+
+    /* Frames reach the recorder on the loop thread, see pws_SetFrameCallback */
+    pw_thread_loop_lock(pwsdata->loop);
+
+    if( NULL == pwsdata->recorder )
+    {
+        pwsdata->recorder = rec;
+        started = true;
     }
 
-    if( ( true == pwsdata->isH264FrameReady ) && ( pwsdata->pws_fd[0] != -1 ) ) 
+    pw_thread_loop_unlock(pwsdata->loop);
+
+    if( false == started )
     {
-	char rbuf[1]={0};
-	read(pwsdata->pws_fd[0], rbuf, 1);
-	pwsdata->isH264FrameReady = false;
+        pws_RecorderDestroy( rec );
+        return PWS_FAILURE;
     }
 
-    // cleanup the pipe fd
-    close( pwsdata->pws_fd[0] );
-    pwsdata->pws_fd[0] =-1;
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Stop recording. Returns once every frame taken so far is
+ *                written and the last segment is closed
+ *  @param[in]: pwsdata
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_RecordStop() */
+int pws_RecordStop( struct pws_data *pwsdata )
+{
+    struct pws_recorder *rec = NULL;
+
+    if( NULL == pwsdata )
+        return PWS_FAILURE;
+
+    if( NULL != pwsdata->loop )
+        pw_thread_loop_lock(pwsdata->loop);
+
+    rec = pwsdata->recorder;
+    pwsdata->recorder = NULL;
+
+    if( NULL != pwsdata->loop )
+        pw_thread_loop_unlock(pwsdata->loop);
+
+    pws_RecorderDestroy( rec );
+
+    return PWS_SUCCESS;
+}
+/* }}} */
+
+/** @description: Where the stream is: connecting, negotiated, streaming or
+ *                reconnecting
+ *  @param[in]: pwsdata
+ *  @return: PWS_STREAM_STATE
+ */
+/* {{{ pws_GetStreamState() */
+PWS_STREAM_STATE pws_GetStreamState( struct pws_data *pwsdata )
+{
+    if( NULL == pwsdata )
+        return PWS_STREAM_CLOSED;
+
+    return (PWS_STREAM_STATE)__atomic_load_n( &pwsdata->state, __ATOMIC_SEQ_CST );
+}
+/* }}} */
+
+/** @description: Wait until frames are arriving. pws_StreamInit returns
+ *                before the stream is connected; this is its readiness
+ *                signal, and after a reconnect tells when frames are back.
+ *                A timeout of 0 only checks and PWS_TIMEOUT_INFINITE waits
+ *                for as long as it takes
+ *  @param[in]: pwsdata, timeout in nanoseconds
+ *  @return: Macro - Success once streaming, Frame Not Ready on timeout,
+ *           Failure if the stream is closed
+ */
+/* {{{ pws_WaitReady() */
+int pws_WaitReady( struct pws_data *pwsdata, u64 timeout_ns )
+{
+    struct timespec deadline;
+    struct timespec *pdeadline = NULL;
+    u32 state = PWS_STREAM_CLOSED;
+
+    if( NULL == pwsdata )
+        return PWS_FAILURE;
+
+    pdeadline = pws_MakeDeadline( timeout_ns, &deadline );
+
+    for( ;; )
+    {
+        state = __atomic_load_n( &pwsdata->state, __ATOMIC_SEQ_CST );
+
+        if( PWS_STREAM_STREAMING == state )
+            return PWS_SUCCESS;
+
+        if( PWS_STREAM_CLOSED == state )
+            return PWS_FAILURE;
+
+        if( 0 == timeout_ns )
+            return PWS_FRAME_NOT_READY;
+
+        __atomic_fetch_add( &pwsdata->statewaiters, 1, __ATOMIC_SEQ_CST );
 
-    close( pwsdata->pws_fd[1] );
-    pwsdata->pws_fd[1] =-1;
+        if( ( -1 == syscall( SYS_futex, &pwsdata->state, FUTEX_WAIT_BITSET_PRIVATE, state,
+                             pdeadline, NULL, FUTEX_BITSET_MATCH_ANY ) ) && ( ETIMEDOUT == errno ) )
+        {
+            /* One last look: the state may have changed right at the deadline */
+            timeout_ns = 0;
+        }
 
-    pw_main_loop_quit(pwsdata->loop);
+        __atomic_fetch_sub( &pwsdata->statewaiters, 1, __ATOMIC_SEQ_CST );
+    }
+}
+/* }}} */
 
-    pw_stream_destroy(pwsdata->stream);
-    pw_main_loop_destroy(pwsdata->loop);
-    pw_deinit();
+/** @description: How long the stream took to connect, negotiate and get
+ *                its first frame, for cold start measurements. Reconnects
+ *                are counted in the stats instead
+ *  @param[in]: pwsdata
+ *  @param[out]: pststartup
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_GetStartupTimes() */
+int pws_GetStartupTimes( struct pws_data *pwsdata, pws_startupTimes *pststartup )
+{
+    if( ( NULL == pwsdata ) || ( NULL == pststartup ) )
+        return PWS_FAILURE;
 
-    pthread_mutex_unlock( &pws_videoframelock );
+    pststartup->connected_ns = __atomic_load_n( &pwsdata->startup.connected_ns, __ATOMIC_RELAXED );
+    pststartup->negotiated_ns = __atomic_load_n( &pwsdata->startup.negotiated_ns, __ATOMIC_RELAXED );
+    pststartup->first_frame_ns = __atomic_load_n( &pwsdata->startup.first_frame_ns, __ATOMIC_RELAXED );
 
     return PWS_SUCCESS;
 }
 /* }}} */
 
-/** @description: Fetch Picture Type from frame data
- *  @param[in]: Frame data
- *  @return: Enum - Picture Type
+/** @description: To release Frame buffer
+ *  @param[in]: pwsdata and application frame info
+ *  @return: Macro - Success/Failure
  */
-/* {{{ pws_GetH264PictureType() */
-static u32 pws_GetH264PictureType( u8 *Framedata )
+/* {{{ pws_StreamClose() */
+int pws_StreamClose( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo )
 {
-    PWS_PIC_TYPE enPicType = PWS_PIC_TYPE_INVALID;
+    u32 i = 0;
+
+    if( NULL == pwsdata )
+        return PWS_FAILURE;
+
+    /* First: a worker callback may still be using the API */
+    pws_SetFrameCallback( pwsdata, NULL, NULL, PWS_CALLBACK_INLINE, 0 );
+
+    /* Before the stats it counts into go away */
+    pws_RecordStop( pwsdata );
 
-    if( NULL != Framedata )
+    /* Destroying the stream under the loop lock guarantees pws_OnProcess is
+     * not running for it; the loop itself keeps serving other streams. */
+    if( NULL != pwsdata->loop )
     {
-#ifdef PLATFORM_RPI
-        if( ( 0X27 == Framedata[4] ) || ( 0X28 == Framedata[4] ) )
-	    enPicType = PWS_PIC_TYPE_IDR_FRAME;
-	else if( 0X25 == Framedata[4] )
-            enPicType = PWS_PIC_TYPE_I_FRAME;
-        else if( 0X21 == Framedata[4] )
-	    enPicType = PWS_PIC_TYPE_P_FRAME;
-#endif
+        pw_thread_loop_lock(pwsdata->loop);
+
+        /* Off the core's list first, so the retry timer leaves it alone */
+        spa_list_remove( &pwsdata->corelink );
+
+        pws_DestroyStream( pwsdata );
+
+        /* Its sockets are served by the loop */
+        pws_ShmExportDestroy( pwsdata->shmexport );
+        pwsdata->shmexport = NULL;
+
+        pw_thread_loop_unlock(pwsdata->loop);
+
+        /* Run any buffer returns still queued for this stream before its
+         * state goes away */
+        pw_loop_invoke(pw_thread_loop_get_loop(pwsdata->loop), pws_DoFlush,
+                       0, NULL, 0, true, pwsdata);
+
+        pwsdata->loop = NULL;
+
+        pws_CoreRelease();
+    }
+
+    pws_SetState( pwsdata, PWS_STREAM_CLOSED );
+
+    if( NULL != pstframeinfo )
+    {
+        /* A frame still borrowed with pws_AcquireFrame is not ours to free */
+        for( i = 0; ( NULL != pwsdata->heldframes ) && ( i < pwsdata->streamprop.maxheldbuffers ); i++ )
+        {
+            if( pstframeinfo->frame_ptr == pwsdata->heldframes[i].frame_ptr )
+                pstframeinfo->frame_ptr = NULL;
+        }
+
+        /* Before the ring goes, so a borrowed batch frame is recognised */
+        pws_FreeFrameBuffer( pwsdata, pstframeinfo );
     }
-    
-    return enPicType;
+
+    /* After the frame above was told apart from the lent ones */
+    pws_FreeLentBuffers( pwsdata );
+
+    pws_FreeStreamData( pwsdata );
+
+    return PWS_SUCCESS;
 }
 /* }}} */
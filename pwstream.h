@@ -29,7 +29,13 @@ extern "C" {
 #include "spa/debug/types.h"
 #include "spa/param/video/type-info.h"
 #include "spa/param/video/format.h"
+#include "spa/param/audio/format-utils.h"
+#include "spa/param/audio/type-info.h"
+#include "spa/utils/hook.h"
 #include <sys/timeb.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <stddef.h>
 
 /***** MACROS *****/
 typedef unsigned char           u8;     /**< UNSIGNED  8-bit data type */
@@ -43,6 +49,7 @@ typedef signed long long        s64;    /**<   SIGNED 64-bit data type */
 
 #define PWS_DEF_STREAM_NAME 		"FRAME_RENDER"
 #define PWS_DEF_MEDIA_TYPE 		"Video"
+#define PWS_DEF_AUDIO_MEDIA_TYPE	"Audio"
 #define PWS_DEF_MEDIA_CATEGORY 		"Capture"
 #define PWS_DEF_MEDIA_ROLE 		"Camera"
 #define PWS_DEF_MEDIA_TYPE_FORMAT	PWS_MEDIA_TYPE_FORMAT_VIDEO
@@ -51,6 +58,51 @@ typedef signed long long        s64;    /**<   SIGNED 64-bit data type */
 #define PWS_DEF_FRAME_WIDTH		640
 #define PWS_DEF_FRAME_HEIGHT 		480
 #define PWS_DEF_FRAMERATE 		25
+#define PWS_DEF_AUDIO_SUBTYPE_FORMAT	PWS_MEDIA_SUBTYPE_FORMAT_RAW
+#define PWS_DEF_AUDIO_FORMAT		PWS_AUDIO_FORMAT_S16
+#define PWS_DEF_SAMPLE_RATE		48000
+#define PWS_DEF_CHANNELS		1
+#define PWS_DEF_RAW_VIDEO_FORMAT	PWS_VIDEO_FORMAT_NV12
+#define PWS_MAX_FORMAT_PREFS		8
+#define PWS_DEF_RING_DEPTH		4
+#define PWS_MAX_RING_DEPTH		64
+#define PWS_DEF_MAX_HELD_BUFFERS	2
+#define PWS_MAX_NAL_UNITS		16
+#define PWS_MAX_PARAM_SET_SIZE		256
+#define PWS_MAX_HELD_BUFFERS		16
+#define PWS_DEF_HISTORY_FRAMES		512
+#define PWS_MAX_READERS			16
+#define PWS_DEF_RECORD_PREFIX		"pws"
+#define PWS_DEF_RECORD_BUDGET		(4 * 1024 * 1024)
+#define PWS_DEF_RECORD_FLUSH_MS		500
+#define PWS_TIMEOUT_INFINITE		(~0ULL)
+
+/* H.264 nal_unit_type values reported in pws_nalUnit.type */
+#define PWS_NAL_TYPE_SLICE		1
+#define PWS_NAL_TYPE_IDR		5
+#define PWS_NAL_TYPE_SEI		6
+#define PWS_NAL_TYPE_SPS		7
+#define PWS_NAL_TYPE_PPS		8
+#define PWS_NAL_TYPE_AUD		9
+
+#define PWS_FRAME_INFO_EXT_VERSION	5
+#define PWS_MAX_PLANES			4
+
+#define PWS_STATS_HIST_BUCKETS		32
+
+/* pws_frameInfo stream_type values */
+#define PWS_STREAM_TYPE_VIDEO		0
+#define PWS_STREAM_TYPE_AUDIO		1
+
+/* pws_frameFd types */
+#define PWS_FD_TYPE_MEMFD		1
+#define PWS_FD_TYPE_DMABUF		2
+
+/* pws_frameInfoExt flags */
+#define PWS_FRAME_TS_FROM_PRODUCER	0x1	// capture_ts_ns is the producer's spa_meta_header PTS
+
+/* pws_ReadFrames flags */
+#define PWS_READ_FLAG_BORROW		0x1	// lend frames until pws_ReleaseFrames instead of copying
 
 #define FRAME_SIZE   10
 
@@ -63,6 +115,7 @@ typedef enum pws_error
     PWS_INVALID_PARAM ,
     PWS_OPERATION_NOT_SUPPORTED ,
     PWS_UNKNOWN ,    
+    PWS_BUFFER_LIMIT_REACHED ,
 }PWS_ERROR;
 
 typedef enum pws_format
@@ -71,6 +124,7 @@ typedef enum pws_format
     PWS_FORMAT_MEDIA_TYPE ,
     PWS_FORMAT_MEDIA_SUBTYPE ,
     PWS_FORMAT_VIDEO ,
+    PWS_FORMAT_AUDIO ,
 }PWS_FORMAT;
 
 typedef enum pws_media_type_format
@@ -86,6 +140,7 @@ typedef enum pws_media_subtype_format
     PWS_MEDIA_SUBTYPE_FORMAT_START ,
     PWS_MEDIA_SUBTYPE_FORMAT_RAW ,
     PWS_MEDIA_SUBTYPE_FORMAT_H264 ,
+    PWS_MEDIA_SUBTYPE_FORMAT_AAC ,
     PWS_MEDIA_SUBTYPE_FORMAT_END ,
 }PWS_MEDIA_SUBTYPE_FORMAT;
 
@@ -93,9 +148,21 @@ typedef enum pws_video_format
 {
     PWS_VIDEO_FORMAT_START ,
     PWS_VIDEO_FORMAT_ENCODED ,
+    PWS_VIDEO_FORMAT_I420 ,
+    PWS_VIDEO_FORMAT_NV12 ,
     PWS_VIDEO_FORMAT_END ,
 }PWS_VIDEO_FORMAT;
 
+/* Interleaved PCM sample formats, native endian */
+typedef enum pws_audio_format
+{
+    PWS_AUDIO_FORMAT_START ,
+    PWS_AUDIO_FORMAT_S16 ,
+    PWS_AUDIO_FORMAT_S32 ,
+    PWS_AUDIO_FORMAT_F32 ,
+    PWS_AUDIO_FORMAT_END ,
+}PWS_AUDIO_FORMAT;
+
 typedef enum pws_pic_type
 {
     PWS_PIC_TYPE_INVALID ,
@@ -104,8 +171,70 @@ typedef enum pws_pic_type
     PWS_PIC_TYPE_P_FRAME
 }PWS_PIC_TYPE;
 
+typedef enum pws_overflow_policy
+{
+    PWS_OVERFLOW_DROP_OLDEST ,		// overwrite the oldest unread frame (default)
+    PWS_OVERFLOW_DROP_NEWEST ,		// keep queued frames, drop the incoming one
+    PWS_OVERFLOW_DROP_GOP ,		// drop the rest of the GOP, resume at the next IDR
+}PWS_OVERFLOW_POLICY;
+
+typedef enum pws_notify_mode
+{
+    PWS_NOTIFY_LEVEL ,			// eventfd counter equals the queued frames (default)
+    PWS_NOTIFY_EDGE ,			// one wakeup per batch, for EPOLLET; read until PWS_FRAME_NOT_READY
+}PWS_NOTIFY_MODE;
+
+/* Frames not wanted are handed back to PipeWire before any copy. An H.264
+ * frame can only be skipped with everything up to the next IDR, so on H.264
+ * streams EVERY_NTH and MAX_FPS pass the first IDR once a frame is due; raw
+ * video and audio pass any frame. */
+typedef enum pws_decimate_mode
+{
+    PWS_DECIMATE_NONE ,			// every frame (default)
+    PWS_DECIMATE_KEYFRAMES ,		// IDRs only
+    PWS_DECIMATE_EVERY_NTH ,		// one frame in decimation
+    PWS_DECIMATE_MAX_FPS ,		// at most decimation frames per second
+}PWS_DECIMATE_MODE;
+
+/* Where a pws_SetFrameCallback callback runs */
+typedef enum pws_callback_mode
+{
+    PWS_CALLBACK_INLINE ,		// on the PipeWire thread, on the producer's buffer
+    PWS_CALLBACK_WORKERS ,		// on a pool of worker threads, on a copy
+}PWS_CALLBACK_MODE;
+
+/* Segment container written by pws_RecordStart */
+typedef enum pws_record_format
+{
+    PWS_RECORD_ANNEXB ,			// H.264 elementary stream, .h264
+    PWS_RECORD_FMP4 ,			// fragmented MP4, .mp4
+}PWS_RECORD_FORMAT;
+
+/* Where a stream is, see pws_GetStreamState and pws_WaitReady. A stream that
+ * fails, or loses the PipeWire daemon, goes to RECONNECTING and is created
+ * again; the eventfd, queued frames and reader handles stay as they are */
+typedef enum pws_stream_state
+{
+    PWS_STREAM_CLOSED ,			// not opened yet, or closed
+    PWS_STREAM_CONNECTING ,		// waiting for the daemon or a producer
+    PWS_STREAM_NEGOTIATED ,		// format agreed, no frame yet
+    PWS_STREAM_STREAMING ,		// frames arriving
+    PWS_STREAM_RECONNECTING ,		// stream or daemon lost, retrying
+}PWS_STREAM_STATE;
+
 /***** Structure Declaration *****/
 
+/* One video format to offer, most preferred first. Zero fields take the
+ * matching streamprop value; framerate also caps what the producer may pick */
+typedef struct pws_formatPref
+{
+    PWS_MEDIA_SUBTYPE_FORMAT enMsubtypeformat;
+    PWS_VIDEO_FORMAT envideoformat;	// raw subtype only, 0 = PWS_DEF_RAW_VIDEO_FORMAT
+    u32 width;
+    u32 height;
+    u32 framerate;
+}pws_formatPref;
+
 struct pws_prioperties
 {
     const char *stream_name;
@@ -115,15 +244,41 @@ struct pws_prioperties
     PWS_MEDIA_TYPE_FORMAT enMtypeformat;
     PWS_MEDIA_SUBTYPE_FORMAT enMsubtypeformat;
     PWS_VIDEO_FORMAT envideoformat;
-    u32 width;
-    u32 height;    
+    u32 width;				// video size and rate are updated to the
+    u32 height;    			// format the producer picked
     u32 framerate;
+    u32 ringdepth;			// queued frames, 0 = PWS_DEF_RING_DEPTH
+    PWS_OVERFLOW_POLICY enoverflowpolicy;
+    bool zerocopy;			// lend PipeWire buffers through pws_AcquireFrame
+    u32 maxheldbuffers;			// zero-copy frames a consumer may hold, 0 = default
+    bool keyframestart;			// first read skips to an IDR with SPS/PPS prepended
+    u32 historybytes;			// pre-roll history budget, 0 = no history
+    u32 historyframes;			// frames the history may index, 0 = default
+    PWS_NOTIFY_MODE ennotifymode;
+    u32 bitrate;			// bits per second, sizes the buffer pool, 0 = estimate from resolution
+    bool poolframebuffers;		// reader frame_ptr comes from the stream pool, see pws_FreeFrameBuffer
+    PWS_AUDIO_FORMAT enaudioformat;	// PCM sample format for PWS_MEDIA_TYPE_FORMAT_AUDIO with RAW
+    u32 samplerate;			// audio, 0 = PWS_DEF_SAMPLE_RATE
+    u32 channels;			// audio, 0 = PWS_DEF_CHANNELS
+    const pws_formatPref *formatprefs;	// video formats in preference order, NULL = the fields above
+    u32 nformatprefs;			// at most PWS_MAX_FORMAT_PREFS are offered
+    PWS_DECIMATE_MODE endecimatemode;	// see pws_SetDecimation to change it while running
+    u32 decimation;			// N for EVERY_NTH, fps for MAX_FPS
+    u32 maxreaders;			// reader handles, see pws_ReaderOpen; 0 = single reader API
+    u32 readerlag;			// frames a reader may fall behind before skipping ahead, 0 = ringdepth
+    const char *shmsocket;		// Unix socket to export frames to other processes on, NULL = no export
+    u32 shmslots;			// frames in the shared ring, 0 = ringdepth
+    u32 shmslotsize;			// largest frame exported, 0 = estimate from the format
+    bool latestframe;			// keep only the newest frame, handed over without locks, see pws_ReadFrame
+    u32 latestframesize;		// largest frame latestframe mode carries, 0 = estimate from the format
+    u32 rtpriority;			// SCHED_FIFO priority of the PipeWire thread, 0 = leave it as is
+    u64 cpuaffinity;			// CPUs the PipeWire thread may run on, bit n = CPU n, 0 = any
 };
 
 typedef struct pws_frameInfo
 {
     s16 stream_id;              // buffer id (0~3)
-    u16 stream_type;            // 0 = Video H264 frame, 1 = Audio frame
+    u16 stream_type;            // PWS_STREAM_TYPE_VIDEO (0) or PWS_STREAM_TYPE_AUDIO (1)
     u32 pic_type;		// 1 = IDR Frame 2 = I Frame 3 = P Frame
     u8 *frame_ptr;             // same as guint8 *y_addr
     u32 width;                  // Buffer Width
@@ -132,23 +287,254 @@ typedef struct pws_frameInfo
     u32 frame_timestamp;        // Time stamp 8 bytes from GST
 }pws_frameInfo;
 
+typedef struct pws_nalUnit
+{
+    u32 offset;                 // offset of the NAL header byte from frame_ptr
+    u32 length;                 // NAL size without start code
+    u8 type;                    // nal_unit_type, see PWS_NAL_TYPE_*
+}pws_nalUnit;
+
+typedef struct pws_nalIndex
+{
+    u32 count;                  // NAL units in nal[], at most PWS_MAX_NAL_UNITS
+    pws_nalUnit nal[PWS_MAX_NAL_UNITS];
+}pws_nalIndex;
+
+typedef struct pws_paramSets
+{
+    u8 sps[PWS_MAX_PARAM_SET_SIZE];     // latest SPS, Annex-B start code included
+    u32 sps_size;
+    u8 pps[PWS_MAX_PARAM_SET_SIZE];     // latest PPS, Annex-B start code included
+    u32 pps_size;
+    u32 generation;                     // changes whenever either set changes
+}pws_paramSets;
+
+/* Called for each frame of a history walk, oldest first. frame_ptr is only
+ * valid during the call. Return non-zero to stop the walk. */
+typedef int (*pws_historyCallback)( const pws_frameInfo *pstframeinfo, void *userdata );
+
+/* One plane of a raw video frame, laid out as the producer sent it */
+typedef struct pws_framePlane
+{
+    u8 *data;                   // first byte of the plane
+    u32 offset;                 // plane offset in the producer's buffer
+    u32 stride;                 // bytes per line
+    u32 size;                   // bytes in the plane
+}pws_framePlane;
+
+/* Shareable memory behind a zero-copy frame, for importing it elsewhere
+ * (mmap, EGL/V4L2 dma-buf import, SCM_RIGHTS). The fd belongs to pwstream
+ * and stays valid until the frame is released; dup() it to keep it. */
+typedef struct pws_frameFd
+{
+    s32 fd;
+    u32 type;                   // PWS_FD_TYPE_*
+    u32 offset;                 // offset of the frame data in the fd
+    u32 size;                   // bytes of frame data
+}pws_frameFd;
+
+/* Extension of pws_frameInfo, fetched with pws_GetFrameInfoExt. Set size to
+ * sizeof(pws_frameInfoExt) before the call; new fields are only ever added
+ * at the end, with a new version. */
+typedef struct pws_frameInfoExt
+{
+    u32 version;                // layout filled, PWS_FRAME_INFO_EXT_VERSION
+    u32 size;                   // in: caller's struct size, out: bytes filled
+    u64 capture_ts_ns;          // producer PTS, else receive_ts_ns
+    u64 receive_ts_ns;          // CLOCK_MONOTONIC when pwstream got the frame
+    u32 flags;                  // PWS_FRAME_TS_* flags
+    /* version 2 */
+    u32 nplanes;                // raw video planes, 0 for encoded frames
+    pws_framePlane plane[PWS_MAX_PLANES];
+    /* version 3 */
+    u32 nfds;                   // fd-backed data blocks, zero-copy frames only
+    pws_frameFd fd[PWS_MAX_PLANES];
+    /* version 4 */
+    u32 samplerate;             // audio frames only, else 0
+    u32 channels;
+    u32 nsamples;               // PCM samples per channel in the frame, 0 if unknown
+    /* version 5 */
+    u32 framerate_num;          // negotiated video framerate, 0/0 if unknown
+    u32 framerate_denom;
+}pws_frameInfoExt;
+
+#define PWS_FRAME_INFO_EXT_V1_SIZE	( offsetof(pws_frameInfoExt, flags) + sizeof(u32) )
+
+/* Called for each frame instead of queueing it for pws_ReadFrame, see
+ * pws_SetFrameCallback. Both structures and the frame data are only valid
+ * during the call and must not be written to. pstframeinfoext is always the
+ * current version; it has no fds for worker frames. */
+typedef void (*pws_frameCallback)( const pws_frameInfo *pstframeinfo, const pws_frameInfoExt *pstframeinfoext,
+                                   void *userdata );
+
+/* Recording set up by pws_RecordStart. Each segment starts on an IDR and is
+ * closed at the first IDR after it reached either limit. Frames wait in
+ * memory for at most flushms before the writer thread writes them in one
+ * batch; when budgetbytes are already waiting, frames are dropped up to the
+ * next IDR. */
+typedef struct pws_recordConfig
+{
+    const char *directory;		// existing directory for the segment files
+    const char *prefix;			// segment file names are <prefix>-<start ms>.<ext>, NULL = PWS_DEF_RECORD_PREFIX
+    PWS_RECORD_FORMAT enformat;
+    u32 segmentms;			// segment length to rotate at, 0 = no time limit
+    u64 segmentbytes;			// segment size to rotate at, 0 = no size limit
+    u32 budgetbytes;			// frame data waiting to be written, 0 = PWS_DEF_RECORD_BUDGET
+    u32 flushms;			// longest a frame waits for its write, 0 = PWS_DEF_RECORD_FLUSH_MS
+}pws_recordConfig;
+
+/* log2 histogram: bucket[i] counts durations in [2^i, 2^(i+1)) ns */
+typedef struct pws_histogram
+{
+    u64 count;
+    u64 sum_ns;
+    u64 max_ns;
+    u64 bucket[PWS_STATS_HIST_BUCKETS];
+}pws_histogram;
+
+/* Counters since pws_StreamInit or the last pws_ResetStats. Only u64 fields. */
+typedef struct pws_streamStats
+{
+    u64 frames_received;        // buffers dequeued with data
+    u64 frames_delivered;       // frames handed to a reader
+    u64 frames_dropped;         // incoming frames dropped, ring full
+    u64 frames_overwritten;     // queued frames evicted unread, ring full
+    u64 bytes_copied;           // ingest and reader copies
+    u64 dequeue_failures;       // process callbacks that found no buffer
+    u64 frames_filtered;        // skipped by the decimation mode, never copied
+    u64 frames_gop_skipped;     // dropped with the rest of their GOP, PWS_OVERFLOW_DROP_GOP
+    u64 gops_skipped;           // GOPs cut short, PWS_OVERFLOW_DROP_GOP
+    u64 record_frames;          // frames written to segments
+    u64 record_bytes;           // bytes written to segments, container included
+    u64 record_frames_dropped;  // frames not recorded: over budget, waiting for an IDR, or a write failed
+    u64 record_segments;        // segments finished
+    u64 record_write_errors;    // failed segment opens and writes, each cuts the segment
+    u64 reconnects;             // streams created again after they or the daemon were lost
+    pws_histogram process_ns;   // process callback duration
+    pws_histogram latency_ns;   // frame arrival to delivery to the reader
+    pws_histogram wait_ns;      // time readers slept in pws_ReadFrameTimeout
+    pws_histogram record_write_ns;  // one batched segment write
+    pws_histogram reconnect_gap_ns; // last frame before a loss to the first frame after it
+}pws_streamStats;
+
+/* How long the stream took to come up, nanoseconds from the start of
+ * pws_StreamInit; 0 until that point is reached. Not reset by a reconnect */
+typedef struct pws_startupTimes
+{
+    u64 connected_ns;           // stream connected to the daemon
+    u64 negotiated_ns;          // format agreed with the producer
+    u64 first_frame_ns;         // first frame received
+}pws_startupTimes;
+
+/* Frame buffer pool usage since pws_StreamInit */
+typedef struct pws_poolStats
+{
+    u64 bytes_in_use;           // buffers handed out, rounded to their size class
+    u64 bytes_peak;             // highest bytes_in_use
+    u64 bytes_cached;           // free buffers kept for reuse
+    u64 system_allocs;          // buffers taken from the system allocator
+    u64 reuses;                 // buffers served from the free lists
+}pws_poolStats;
+
+struct pws_ring;
+struct pws_ring_slot;
+struct pws_heldframe;
+struct pws_paramcache;
+struct pws_history;
+struct pws_pool;
+struct pws_fanout;
+struct pws_reader;
+struct pws_shmexport;
+struct pws_dispatch;
+struct pws_triple;
+struct pws_recorder;
+
 struct pws_data {
-    struct pw_main_loop *loop;
+    struct pw_thread_loop *loop;	// shared by every stream in the process
     struct pw_stream *stream;
+    struct spa_hook stream_listener;
     struct spa_video_info format;
+    struct spa_audio_info_raw audioformat;	// negotiated rate and channels for audio streams
 
     struct pws_prioperties streamprop;
 
-    s32 pws_fd[2];
+    s32 notifyfd;			// eventfd returned by pws_StreamInit
+    u32 notifysignaled;
+    u32 framesequence;			// futex word, bumped for every queued frame
+    u32 framewaiters;
+
+    struct pws_ring *framering;
+    struct pws_ring_slot **batchslots;
+    u32 borrowedcount;
+
+    struct pws_heldframe *heldframes;
+    u32 heldcount;
+    struct pws_heldframe *lastframe;
+
+    struct pws_paramcache *paramcache;
+    bool keyframepending;
+    bool gopresync;			// skipping frames orphaned by a PWS_OVERFLOW_DROP_GOP eviction
+
+    struct pws_history *history;
+
+    pws_streamStats *stats;
+    struct pws_pool *pool;
+    struct pws_fanout *fanout;		// shared frames for reader handles, maxreaders != 0
+    struct pws_shmexport *shmexport;	// shared memory ring, shmsocket != NULL
+    struct pws_dispatch *dispatch;	// frame callback, see pws_SetFrameCallback
+    struct pws_triple *latest;		// newest frame handoff, latestframe set
+    struct pws_recorder *recorder;	// segment writer, see pws_RecordStart
+
+    u32 decimatecount;			// frames seen since the last one passed
+    u64 decimatenext_ns;		// MAX_FPS: earliest receive time of the next frame
 
-    pws_frameInfo *intermediateFrameInfoH264;
-    bool isH264FrameReady;
+    u32 state;				// PWS_STREAM_STATE, futex word for pws_WaitReady
+    u32 statewaiters;
+    struct spa_list corelink;		// in the shared core's stream list
+    bool streamlost;			// failed or disconnected, the retry timer creates it again
+    u64 init_ns;			// start of pws_StreamInit
+    pws_startupTimes startup;
+    u64 lastreceive_ns;			// newest frame, where a reconnect gap starts
+    u64 gapstart_ns;			// last frame before the stream was lost, 0 = no gap
 };
 
 /***** Prototype *****/
 int pws_StreamInit(struct pws_data *pwsdata);
 int pws_ReadFrame( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo);
+int pws_TryReadFrame( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo );
+int pws_ReadFrameTimeout( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo, u64 timeout_ns );
+int pws_ReadFrames( struct pws_data *pwsdata, pws_frameInfo *pstframes, u32 maxframes, u32 flags,
+                    struct iovec *iov, u32 *pnframes );
+int pws_ReleaseFrames( struct pws_data *pwsdata );
+int pws_GetStats( struct pws_data *pwsdata, pws_streamStats *pststats );
+int pws_ResetStats( struct pws_data *pwsdata );
+int pws_GetPoolStats( struct pws_data *pwsdata, pws_poolStats *pststats );
+int pws_FreeFrameBuffer( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo );
+int pws_GetFrameInfoExt( struct pws_data *pwsdata, const pws_frameInfo *pstframeinfo, pws_frameInfoExt *pstframeinfoext );
 int pws_StreamClose( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo );
+int pws_GetDroppedFrames( struct pws_data *pwsdata, u64 *pdropped );
+int pws_PeekFrameTimestamp( struct pws_data *pwsdata, u64 *pcapture_ts_ns );
+int pws_SetDecimation( struct pws_data *pwsdata, PWS_DECIMATE_MODE enmode, u32 decimation );
+int pws_AcquireFrame( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo );
+int pws_ReleaseFrame( struct pws_data *pwsdata, pws_frameInfo *pstframeinfo );
+int pws_GetFrameNalIndex( struct pws_data *pwsdata, const pws_frameInfo *pstframeinfo, pws_nalIndex *pstnalindex );
+int pws_GetParameterSets( struct pws_data *pwsdata, pws_paramSets *pstparamsets );
+int pws_SyncToKeyframe( struct pws_data *pwsdata );
+int pws_ReadFramesSince( struct pws_data *pwsdata, u64 capture_ts_ns, pws_frameInfo *pstframes, u32 maxframes, u32 *pnframes );
+int pws_IterateFramesSince( struct pws_data *pwsdata, u64 capture_ts_ns, pws_historyCallback callback, void *userdata );
+struct pws_reader *pws_ReaderOpen( struct pws_data *pwsdata );
+int pws_ReaderGetFd( struct pws_reader *reader );
+int pws_ReaderRead( struct pws_reader *reader, pws_frameInfo *pstframeinfo );
+int pws_ReaderRelease( struct pws_reader *reader, pws_frameInfo *pstframeinfo );
+int pws_ReaderGetDropped( struct pws_reader *reader, u64 *pdropped );
+int pws_ReaderClose( struct pws_reader *reader );
+int pws_SetFrameCallback( struct pws_data *pwsdata, pws_frameCallback callback, void *userdata,
+                          PWS_CALLBACK_MODE enmode, u32 nworkers );
+int pws_RecordStart( struct pws_data *pwsdata, const pws_recordConfig *pstconfig );
+int pws_RecordStop( struct pws_data *pwsdata );
+PWS_STREAM_STATE pws_GetStreamState( struct pws_data *pwsdata );
+int pws_WaitReady( struct pws_data *pwsdata, u64 timeout_ns );
+int pws_GetStartupTimes( struct pws_data *pwsdata, pws_startupTimes *pststartup );
 
 #ifdef __cplusplus
 } /* extern "C" */
@@ -0,0 +1,378 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/***** HEADER FILE *****/
+#include "pws_shmreader.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/***** Structure Declaration *****/
+
+struct pws_shmreader
+{
+    int sockfd;			// kept open: the exporter drops readers on hangup
+    int eventfd;
+
+    const uint8_t *map;
+    size_t mapsize;
+    const struct pws_shmheader *header;
+
+    uint64_t cursor;		// next frame to read
+    bool keyframestart;		// re-gate on a sync point after missed frames
+    bool keyframepending;
+    uint64_t dropped;
+};
+
+/***** Function Definition *****/
+
+/** @description: Receive the ring memfd and the reader's eventfd
+ *  @param[in]: connected socket
+ *  @param[out]: pmemfd, peventfd
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_ShmReaderRecvFds() */
+static int pws_ShmReaderRecvFds( int sockfd, int *pmemfd, int *peventfd )
+{
+    union
+    {
+        struct cmsghdr align;
+        uint8_t buf[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    struct msghdr msg;
+    struct cmsghdr *cmsg = NULL;
+    struct iovec iov;
+    ssize_t received = 0;
+    uint32_t version = 0;
+    size_t nfds = 0;
+    size_t i = 0;
+    int fds[2] = { -1, -1 };
+
+    memset( &msg, 0, sizeof(msg) );
+
+    iov.iov_base = &version;
+    iov.iov_len = sizeof(version);
+
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    received = recvmsg( sockfd, &msg, MSG_CMSG_CLOEXEC );
+
+    if( received < 0 )
+        return PWS_SHM_FAILURE;
+
+    cmsg = CMSG_FIRSTHDR( &msg );
+
+    /* Whatever fds arrived are ours now, also when the message is bad */
+    if( ( NULL != cmsg ) && ( SOL_SOCKET == cmsg->cmsg_level ) && ( SCM_RIGHTS == cmsg->cmsg_type ) &&
+        ( cmsg->cmsg_len > CMSG_LEN( 0 ) ) )
+        nfds = ( cmsg->cmsg_len - CMSG_LEN( 0 ) ) / sizeof(int);
+
+    for( i = 0; ( i < nfds ) && ( i < 2 ); i++ )
+        memcpy( &fds[i], CMSG_DATA( cmsg ) + i * sizeof(int), sizeof(int) );
+
+    if( ( (ssize_t)sizeof(version) != received ) || ( 2 != nfds ) || ( PWS_SHM_VERSION != version ) )
+    {
+        for( i = 0; i < 2; i++ )
+        {
+            if( -1 != fds[i] )
+                close( fds[i] );
+        }
+
+        return PWS_SHM_FAILURE;
+    }
+
+    *pmemfd = fds[0];
+    *peventfd = fds[1];
+
+    return PWS_SHM_SUCCESS;
+}
+/* }}} */
+
+/** @description: Map the ring read-only and check its geometry
+ *  @param[in]: reader, memfd
+ *  @return: Macro - Success/Failure
+ */
+/* {{{ pws_ShmReaderMap() */
+static int pws_ShmReaderMap( struct pws_shmreader *reader, int memfd )
+{
+    const struct pws_shmheader *header = NULL;
+    struct stat st;
+
+    if( ( 0 != fstat( memfd, &st ) ) || ( (size_t)st.st_size < sizeof(struct pws_shmheader) ) )
+        return PWS_SHM_FAILURE;
+
+    reader->mapsize = (size_t)st.st_size;
+    reader->map = (const uint8_t *)mmap( NULL, reader->mapsize, PROT_READ, MAP_SHARED, memfd, 0 );
+
+    if( MAP_FAILED == reader->map )
+    {
+        reader->map = NULL;
+        return PWS_SHM_FAILURE;
+    }
+
+    header = (const struct pws_shmheader *)reader->map;
+
+    if( ( PWS_SHM_MAGIC != header->magic ) || ( PWS_SHM_VERSION != header->version ) ||
+        ( 0 == header->nslots ) ||
+        ( header->slotstride < sizeof(struct pws_shmslot) + header->slotsize ) ||
+        ( header->headersize + (size_t)header->nslots * header->slotstride > reader->mapsize ) )
+        return PWS_SHM_FAILURE;
+
+    reader->header = header;
+
+    return PWS_SHM_SUCCESS;
+}
+/* }}} */
+
+/** @description: Connect to an exporting stream and map its ring. Reading
+ *                starts with the next frame published
+ *  @param[in]: path - the exporter's streamprop.shmsocket
+ *              keyframestart - skip to the next sync point first, and
+ *                              again after frames were missed
+ *  @return: Reader or NULL
+ */
+/* {{{ pws_ShmReaderOpen() */
+struct pws_shmreader *pws_ShmReaderOpen( const char *path, bool keyframestart )
+{
+    struct pws_shmreader *reader = NULL;
+    struct sockaddr_un addr;
+    int memfd = -1;
+
+    if( ( NULL == path ) || ( strlen( path ) >= sizeof(addr.sun_path) ) )
+        return NULL;
+
+    reader = (struct pws_shmreader *)calloc( 1, sizeof(struct pws_shmreader) );
+
+    if( NULL == reader )
+        return NULL;
+
+    reader->eventfd = -1;
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, path );
+
+    reader->sockfd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+
+    if( ( -1 == reader->sockfd ) ||
+        ( 0 != connect( reader->sockfd, (struct sockaddr *)&addr, sizeof(addr) ) ) ||
+        ( PWS_SHM_SUCCESS != pws_ShmReaderRecvFds( reader->sockfd, &memfd, &reader->eventfd ) ) )
+    {
+        pws_ShmReaderClose( reader );
+        return NULL;
+    }
+
+    /* The mapping keeps the memory; the fd is not needed any more */
+    if( PWS_SHM_SUCCESS != pws_ShmReaderMap( reader, memfd ) )
+    {
+        close( memfd );
+        pws_ShmReaderClose( reader );
+        return NULL;
+    }
+
+    close( memfd );
+
+    reader->cursor = __atomic_load_n( &reader->header->head, __ATOMIC_ACQUIRE );
+    reader->keyframestart = keyframestart;
+    reader->keyframepending = keyframestart;
+
+    return reader;
+}
+/* }}} */
+
+/** @description: eventfd that turns readable when frames are published.
+ *                Poll it, then read until PWS_SHM_FRAME_NOT_READY
+ *  @param[in]: reader
+ *  @return: File Descriptor
+ */
+/* {{{ pws_ShmReaderGetFd() */
+int pws_ShmReaderGetFd( struct pws_shmreader *reader )
+{
+    return reader->eventfd;
+}
+/* }}} */
+
+/** @description: Largest frame the ring carries, the buffer size that never
+ *                gets PWS_SHM_BUFFER_TOO_SMALL
+ *  @param[in]: reader
+ *  @return: Bytes
+ */
+/* {{{ pws_ShmReaderMaxFrameSize() */
+uint32_t pws_ShmReaderMaxFrameSize( struct pws_shmreader *reader )
+{
+    return reader->header->slotsize;
+}
+/* }}} */
+
+/** @description: Note frames the reader lost to the writer
+ *  @param[in]: reader, new cursor
+ *  @return: None
+ */
+/* {{{ pws_ShmReaderSkip() */
+static void pws_ShmReaderSkip( struct pws_shmreader *reader, uint64_t cursor )
+{
+    reader->dropped += cursor - reader->cursor;
+    reader->cursor = cursor;
+    reader->keyframepending = reader->keyframestart;
+}
+/* }}} */
+
+/** @description: Copy the next frame out of the ring without locking. A
+ *                reader that falls a full ring behind skips to the oldest
+ *                frame still there
+ *  @param[in]: reader, buffer and its size
+ *  @param[out]: pstframe
+ *  @return: Macro - Success, Frame Not Ready, Closed once the exporter is
+ *           gone and every frame was read, or Buffer Too Small with
+ *           pstframe->frame_size set and the frame left unread
+ */
+/* {{{ pws_ShmReaderRead() */
+int pws_ShmReaderRead( struct pws_shmreader *reader, pws_shmFrame *pstframe, uint8_t *buffer, uint32_t size )
+{
+    const struct pws_shmheader *header = reader->header;
+    const struct pws_shmslot *slot = NULL;
+    pws_shmFrame frame;
+    uint64_t head = 0;
+    uint64_t expected = 0;
+    uint64_t seq = 0;
+    uint64_t count = 0;
+
+    for( ;; )
+    {
+        head = __atomic_load_n( &header->head, __ATOMIC_ACQUIRE );
+
+        if( reader->cursor >= head )
+        {
+            if( 0 != __atomic_load_n( &header->closed, __ATOMIC_ACQUIRE ) )
+                return PWS_SHM_CLOSED;
+
+            /* Drain, then look again: a frame published in between has
+             * either moved head or left the eventfd readable */
+            read( reader->eventfd, &count, sizeof(count) );
+
+            if( ( reader->cursor >= __atomic_load_n( &header->head, __ATOMIC_ACQUIRE ) ) &&
+                ( 0 == __atomic_load_n( &header->closed, __ATOMIC_ACQUIRE ) ) )
+                return PWS_SHM_FRAME_NOT_READY;
+
+            continue;
+        }
+
+        if( head - reader->cursor > header->nslots )
+            pws_ShmReaderSkip( reader, head - header->nslots );
+
+        slot = (const struct pws_shmslot *)( reader->map + header->headersize +
+                                            ( reader->cursor % header->nslots ) * header->slotstride );
+        expected = 2 * reader->cursor + 2;
+
+        seq = __atomic_load_n( &slot->sequence, __ATOMIC_ACQUIRE );
+
+        if( seq != expected )
+        {
+            /* Overwritten since head was read */
+            pws_ShmReaderSkip( reader, reader->cursor + 1 );
+            continue;
+        }
+
+        frame.sequence = reader->cursor;
+        frame.capture_ts_ns = slot->capture_ts_ns;
+        frame.receive_ts_ns = slot->receive_ts_ns;
+        frame.frame_size = slot->frame_size;
+        frame.frame_timestamp = slot->frame_timestamp;
+        frame.pic_type = slot->pic_type;
+        frame.width = slot->width;
+        frame.height = slot->height;
+        frame.stream_type = slot->stream_type;
+        frame.flags = slot->flags;
+
+        if( ( false == reader->keyframepending ) || ( 0 != ( frame.flags & PWS_SHM_FLAG_SYNCPOINT ) ) )
+        {
+            if( ( frame.frame_size <= header->slotsize ) && ( frame.frame_size <= size ) )
+                memcpy( buffer, slot + 1, frame.frame_size );
+        }
+
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+
+        if( __atomic_load_n( &slot->sequence, __ATOMIC_RELAXED ) != expected )
+        {
+            pws_ShmReaderSkip( reader, reader->cursor + 1 );
+            continue;
+        }
+
+        /* Consistent from here on */
+        if( ( true == reader->keyframepending ) && ( 0 == ( frame.flags & PWS_SHM_FLAG_SYNCPOINT ) ) )
+        {
+            reader->cursor++;
+            continue;
+        }
+
+        if( frame.frame_size > size )
+        {
+            *pstframe = frame;
+            return PWS_SHM_BUFFER_TOO_SMALL;
+        }
+
+        reader->cursor++;
+        reader->keyframepending = false;
+        *pstframe = frame;
+
+        return PWS_SHM_SUCCESS;
+    }
+}
+/* }}} */
+
+/** @description: Frames this reader missed by falling behind the writer
+ *  @param[in]: reader
+ *  @return: Frame count
+ */
+/* {{{ pws_ShmReaderDropped() */
+uint64_t pws_ShmReaderDropped( struct pws_shmreader *reader )
+{
+    return reader->dropped;
+}
+/* }}} */
+
+/** @description: Unmap the ring and disconnect
+ *  @param[in]: reader
+ *  @return: None
+ */
+/* {{{ pws_ShmReaderClose() */
+void pws_ShmReaderClose( struct pws_shmreader *reader )
+{
+    if( NULL == reader )
+        return;
+
+    if( NULL != reader->map )
+        munmap( (void *)reader->map, reader->mapsize );
+
+    if( -1 != reader->eventfd )
+        close( reader->eventfd );
+
+    if( -1 != reader->sockfd )
+        close( reader->sockfd );
+
+    free( reader );
+}
+/* }}} */
@@ -0,0 +1,76 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the License);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PWS_SHMREADER_H
+#define PWS_SHMREADER_H
+
+/* Reader for frames a pwstream process exports with streamprop.shmsocket.
+ * Needs neither PipeWire nor libpwstream; one reader per thread. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/***** HEADER FILE *****/
+#include "pws_shm.h"
+#include <stdbool.h>
+
+/***** Enum Decclaration *****/
+
+/* Same values as the matching PWS_ERROR codes */
+typedef enum pws_shm_error
+{
+    PWS_SHM_FAILURE = -1 ,
+    PWS_SHM_SUCCESS = 0 ,
+    PWS_SHM_FRAME_NOT_READY = 1 ,
+    PWS_SHM_BUFFER_TOO_SMALL ,
+    PWS_SHM_CLOSED ,
+}PWS_SHM_ERROR;
+
+/***** Structure Declaration *****/
+
+typedef struct pws_shmFrame
+{
+    uint64_t sequence;          // frame number since the export started
+    uint64_t capture_ts_ns;     // as pws_frameInfoExt
+    uint64_t receive_ts_ns;
+    uint32_t frame_size;
+    uint32_t frame_timestamp;   // as pws_frameInfo
+    uint32_t pic_type;
+    uint32_t width;
+    uint32_t height;
+    uint16_t stream_type;
+    uint16_t flags;             // PWS_SHM_FLAG_*
+}pws_shmFrame;
+
+struct pws_shmreader;
+
+/***** Prototype *****/
+struct pws_shmreader *pws_ShmReaderOpen( const char *path, bool keyframestart );
+int pws_ShmReaderGetFd( struct pws_shmreader *reader );
+uint32_t pws_ShmReaderMaxFrameSize( struct pws_shmreader *reader );
+int pws_ShmReaderRead( struct pws_shmreader *reader, pws_shmFrame *pstframe, uint8_t *buffer, uint32_t size );
+uint64_t pws_ShmReaderDropped( struct pws_shmreader *reader );
+void pws_ShmReaderClose( struct pws_shmreader *reader );
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* PWS_SHMREADER_H */